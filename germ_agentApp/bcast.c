@@ -0,0 +1,146 @@
+/**
+ * File: bcast.c
+ *
+ * Functionality: Live packet broadcast through shared memory.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Packets published to a ring in POSIX shared memory for
+ *               local readers, without ever waiting for them.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "germ.h"
+#include "event.h"
+#include "bcast.h"
+#include "log.h"
+
+
+_Static_assert(BCAST_MAX_PACKET == MAX_PACKET_LENGTH, "broadcast slots must hold a packet");
+_Static_assert(sizeof(bcast_hdr_t) <= BCAST_HDR_SIZE, "broadcast header too large");
+_Static_assert(BCAST_PKT_SOF == PKT_SOF && BCAST_PKT_EOF == PKT_EOF, "packet flags");
+
+struct bcast
+{
+    char            name[BCAST_MAX_NAME + 1];
+    bcast_hdr_t   * hdr;
+    bcast_slot_t  * slots;
+    size_t          size;
+    uint64_t        head;       // next packet number
+};
+
+
+//========================================================================
+bcast_t* bcast_open(const char* name)
+{
+    bcast_t * bc;
+    int       fd;
+
+    bc = calloc(1, sizeof(bcast_t));
+    if (NULL == bc)
+    {
+        return NULL;
+    }
+    snprintf(bc->name, sizeof(bc->name), "%s%s", ('/' == name[0]) ? "" : "/", name);
+    bc->size = BCAST_HDR_SIZE + (size_t)BCAST_NUM_SLOTS * sizeof(bcast_slot_t);
+
+    // readers still on an older ring keep it until they detach
+    shm_unlink(bc->name);
+    fd = shm_open(bc->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        err("failed to create broadcast %s: %s\n", bc->name, strerror(errno));
+        free(bc);
+        return NULL;
+    }
+    if (0 != ftruncate(fd, bc->size))
+    {
+        err("failed to size broadcast %s: %s\n", bc->name, strerror(errno));
+        close(fd);
+        shm_unlink(bc->name);
+        free(bc);
+        return NULL;
+    }
+
+    bc->hdr = mmap(NULL, bc->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == bc->hdr)
+    {
+        err("failed to map broadcast %s: %s\n", bc->name, strerror(errno));
+        shm_unlink(bc->name);
+        free(bc);
+        return NULL;
+    }
+    bc->slots = (bcast_slot_t*)((uint8_t*)bc->hdr + BCAST_HDR_SIZE);
+
+    bc->hdr->magic     = BCAST_MAGIC;
+    bc->hdr->version   = BCAST_VERSION;
+    bc->hdr->num_slots = BCAST_NUM_SLOTS;
+    bc->hdr->slot_size = sizeof(bcast_slot_t);
+    bc->hdr->pid       = getpid();
+    atomic_store_explicit(&bc->hdr->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&bc->hdr->open, 1, memory_order_release);
+
+    info("broadcasting packets to %s (%u slots)\n", bc->name, BCAST_NUM_SLOTS);
+    return bc;
+}
+
+
+//========================================================================
+void bcast_close(bcast_t* bc)
+{
+    if (NULL == bc)
+    {
+        return;
+    }
+
+    atomic_store_explicit(&bc->hdr->open, 0, memory_order_release);
+    munmap(bc->hdr, bc->size);
+    shm_unlink(bc->name);
+    info("broadcast %s closed after %lu packets\n", bc->name, bc->head);
+    free(bc);
+}
+
+
+//========================================================================
+// Publish one packet, overwriting the oldest.
+//========================================================================
+void bcast_publish( bcast_t       * bc,
+                    const void    * packet,
+                    uint32_t        length,
+                    uint32_t        frame_num,
+                    uint32_t        flags )
+{
+    bcast_slot_t * slot = &bc->slots[bc->head % BCAST_NUM_SLOTS];
+
+    if (length > BCAST_MAX_PACKET)
+    {
+        length = BCAST_MAX_PACKET;
+    }
+
+    // odd while writing, and seen as such before any of the data
+    atomic_store_explicit(&slot->seq, 2 * bc->head + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->length    = length;
+    slot->frame_num = frame_num;
+    slot->flags     = flags;
+    memcpy(slot->data, packet, length);
+
+    atomic_store_explicit(&slot->seq, 2 * bc->head + 2, memory_order_release);
+    bc->head++;
+    atomic_store_explicit(&bc->hdr->head, bc->head, memory_order_release);
+}
@@ -0,0 +1,107 @@
+#ifndef _BCAST_H_
+#define _BCAST_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+//===========================================================
+// Live packet broadcast to local readers.
+//
+// With 'broadcast NAME' in OUTPUT_CFG_FILE, data_write_thread
+// publishes every packet it takes from the packet buffers,
+// as received, into a ring in POSIX shared memory /NAME.
+// Readers on the same host map it read-only (see
+// bcast_attach()) and follow with cursors of their own.
+//
+// The daemon never waits for readers: slot n % num_slots
+// is simply overwritten by packet n. Each slot carries a
+// sequence number, odd while the slot is being written and
+// 2n + 2 once packet n is in it. A reader copies a packet
+// and checks the number again, so a packet overwritten
+// meanwhile is detected and counted as lost, never returned
+// torn. A reader more than num_slots behind skips ahead to
+// the oldest packet still there.
+//
+// The ring is removed when broadcasting is turned off or
+// changed to another name; attached readers then see
+// 'open' cleared. A daemon restarted creates a new ring, to
+// be attached again.
+//
+// Layout: bcast_hdr_t in the first BCAST_HDR_SIZE bytes,
+// then num_slots bcast_slot_t. This file and
+// bcast_client.c don't depend on EPICS.
+//===========================================================
+
+#define BCAST_MAGIC         0x53434247   // "GBCS"
+#define BCAST_VERSION       1
+#define BCAST_HDR_SIZE      4096
+#define BCAST_NUM_SLOTS     8192         // 17 MB
+#define BCAST_MAX_PACKET    2048         // MAX_PACKET_LENGTH
+#define BCAST_MAX_NAME      64
+
+#define BCAST_PKT_SOF       0x01         // as PKT_SOF/PKT_EOF in event.h
+#define BCAST_PKT_EOF       0x02
+
+typedef struct
+{
+    uint32_t          magic;
+    uint32_t          version;
+    uint32_t          num_slots;
+    uint32_t          slot_size;
+    uint32_t          pid;              // of the daemon
+    _Atomic uint32_t  open;             // cleared when the ring is removed
+    _Alignas(64)
+    _Atomic uint64_t  head;             // packets published
+} bcast_hdr_t;
+
+typedef struct
+{
+    _Alignas(64)
+    _Atomic uint64_t  seq;              // 2n + 1 writing, 2n + 2 holds packet n
+    uint32_t          length;           // bytes
+    uint32_t          frame_num;
+    uint32_t          flags;            // BCAST_PKT_*
+    uint32_t          reserved;
+    uint8_t           data[BCAST_MAX_PACKET];
+} bcast_slot_t;
+
+//-----------------------------------------------------------
+// Daemon side, in bcast.c.
+//-----------------------------------------------------------
+typedef struct bcast bcast_t;
+
+bcast_t* bcast_open(const char* name);
+void     bcast_close(bcast_t* bc);
+void     bcast_publish( bcast_t       * bc,
+                        const void    * packet,
+                        uint32_t        length,
+                        uint32_t        frame_num,
+                        uint32_t        flags );
+
+//-----------------------------------------------------------
+// Readers, in bcast_client.c (libgermbcast).
+//-----------------------------------------------------------
+typedef struct bcast_reader bcast_reader_t;
+
+typedef struct
+{
+    uint64_t  seq;                      // packet number
+    uint32_t  frame_num;
+    uint32_t  flags;
+} bcast_info_t;
+
+// Attach to ring NAME, following from the newest packet, or from the
+// oldest still in the ring if 'from_oldest'. NULL if there is no such
+// ring or it isn't a broadcast of this version.
+bcast_reader_t* bcast_attach(const char* name, int from_oldest);
+void            bcast_detach(bcast_reader_t* r);
+
+// Copy the next packet to 'buf' (BCAST_MAX_PACKET bytes), waiting up to
+// 'timeout_ms' (-1 forever). Returns its length, 0 on timeout, or -1 once
+// the ring has been removed. 'info' may be NULL.
+int      bcast_next(bcast_reader_t* r, void* buf, int timeout_ms, bcast_info_t* info);
+
+// Packets overwritten before this reader got to them.
+uint64_t bcast_lost(const bcast_reader_t* r);
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * File: bcast_client.c
+ *
+ * Functionality: Reader side of the live packet broadcast.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Read-only attach and lapped-reader detection, for local
+ *               analysis processes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bcast.h"
+
+
+#define BCAST_POLL_NS   200000      // between looks at an idle ring
+
+struct bcast_reader
+{
+    const bcast_hdr_t  * hdr;
+    const bcast_slot_t * slots;
+    size_t               size;
+    uint64_t             cursor;    // next packet number to read
+    uint64_t             lost;
+};
+
+
+//========================================================================
+bcast_reader_t* bcast_attach(const char* name, int from_oldest)
+{
+    bcast_reader_t * r;
+    char             path[BCAST_MAX_NAME + 2];
+    int              fd;
+    struct stat      st;
+    uint64_t         head;
+
+    snprintf(path, sizeof(path), "%s%s", ('/' == name[0]) ? "" : "/", name);
+    fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (0 != fstat(fd, &st) || (size_t)st.st_size < BCAST_HDR_SIZE)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    r = calloc(1, sizeof(bcast_reader_t));
+    if (NULL == r)
+    {
+        close(fd);
+        return NULL;
+    }
+    r->size = st.st_size;
+    r->hdr  = mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == r->hdr)
+    {
+        free(r);
+        return NULL;
+    }
+
+    if ( BCAST_MAGIC != r->hdr->magic
+         || BCAST_VERSION != r->hdr->version
+         || sizeof(bcast_slot_t) != r->hdr->slot_size
+         || r->size < BCAST_HDR_SIZE + (size_t)r->hdr->num_slots * sizeof(bcast_slot_t) )
+    {
+        bcast_detach(r);
+        return NULL;
+    }
+    r->slots = (const bcast_slot_t*)((const uint8_t*)r->hdr + BCAST_HDR_SIZE);
+
+    head = atomic_load_explicit(&r->hdr->head, memory_order_acquire);
+    r->cursor = head;
+    if (from_oldest)
+    {
+        r->cursor = (head > r->hdr->num_slots) ? head - r->hdr->num_slots : 0;
+    }
+
+    return r;
+}
+
+
+//========================================================================
+void bcast_detach(bcast_reader_t* r)
+{
+    if (NULL == r)
+    {
+        return;
+    }
+    munmap((void*)r->hdr, r->size);
+    free(r);
+}
+
+
+//========================================================================
+uint64_t bcast_lost(const bcast_reader_t* r)
+{
+    return r->lost;
+}
+
+
+//========================================================================
+int bcast_next(bcast_reader_t* r, void* buf, int timeout_ms, bcast_info_t* info)
+{
+    const bcast_slot_t * slot;
+    struct timespec      poll = { 0, BCAST_POLL_NS };
+    uint64_t             num_slots = r->hdr->num_slots;
+    uint64_t             head;
+    uint64_t             seq;
+    uint32_t             length;
+    int64_t              waited_ns = 0;
+
+    while (1)
+    {
+        head = atomic_load_explicit(&r->hdr->head, memory_order_acquire);
+        if (r->cursor >= head)
+        {
+            if (!atomic_load_explicit(&r->hdr->open, memory_order_acquire))
+            {
+                return -1;
+            }
+            if (timeout_ms >= 0 && waited_ns >= (int64_t)timeout_ms * 1000000)
+            {
+                return 0;
+            }
+            nanosleep(&poll, NULL);
+            waited_ns += BCAST_POLL_NS;
+            continue;
+        }
+
+        // lapped: skip to the oldest packet still in the ring
+        if (head - r->cursor > num_slots)
+        {
+            r->lost   += head - num_slots - r->cursor;
+            r->cursor  = head - num_slots;
+        }
+
+        slot = &r->slots[r->cursor % num_slots];
+        seq  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != 2 * r->cursor + 2)
+        {
+            // being, or already, overwritten by a newer packet
+            r->lost++;
+            r->cursor++;
+            continue;
+        }
+
+        length = slot->length;
+        if (length > BCAST_MAX_PACKET)
+        {
+            length = BCAST_MAX_PACKET;
+        }
+        memcpy(buf, slot->data, length);
+        if (info)
+        {
+            info->seq       = r->cursor;
+            info->frame_num = slot->frame_num;
+            info->flags     = slot->flags;
+        }
+
+        // the copy is good only if the slot wasn't touched meanwhile
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != atomic_load_explicit(&slot->seq, memory_order_relaxed))
+        {
+            r->lost++;
+            r->cursor++;
+            continue;
+        }
+
+        r->cursor++;
+        return length;
+    }
+}
@@ -0,0 +1,306 @@
+/**
+ * File: calib.c
+ *
+ * Functionality: Per-channel energy calibration.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Calibration read from CALIB_CFG_FILE, reloaded when the file
+ *               changes and handed to data_proc_thread by pointer swap.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "calib.h"
+#include "log.h"
+
+
+_Atomic(calib_table_t*) calib_table_pending = ATOMIC_VAR_INIT(NULL);
+
+#define CAL_POLY   0
+#define CAL_LUT    1
+
+typedef struct
+{
+    uint8_t   type;
+    double    c[3];
+    double  * lut;       // shared by the channels of a lut line
+} chan_cal_t;
+
+
+//========================================================================
+// Read the energy of each pd value from a LUT file.
+//========================================================================
+static double* read_lut(const char* file)
+{
+    FILE   * fp;
+    double * lut;
+
+    fp = fopen(file, "r");
+    if (NULL == fp)
+    {
+        err("failed to open calibration LUT %s\n", file);
+        return NULL;
+    }
+
+    lut = malloc(NUM_MCA_COL * sizeof(double));
+    if (NULL == lut)
+    {
+        err("no memory for calibration LUT %s\n", file);
+        fclose(fp);
+        return NULL;
+    }
+    for (int i=0; i<NUM_MCA_COL; i++)
+    {
+        if (1 != fscanf(fp, "%lf", &lut[i]))
+        {
+            err("%s: expect %d values, got %d\n", file, NUM_MCA_COL, i);
+            free(lut);
+            fclose(fp);
+            return NULL;
+        }
+    }
+
+    fclose(fp);
+    return lut;
+}
+
+
+//========================================================================
+// Read CALIB_CFG_FILE and build the LUT. Returns NULL on error.
+//========================================================================
+static calib_table_t* calib_load(const char* file)
+{
+    FILE *          fp;
+    char            line[512];
+    char            chans[256], arg[256];
+    uint8_t         sel[NUM_CHANS];
+    double          c[3], e, bin;
+    double *        luts[NUM_CHANS];
+    int             num_luts = 0, line_num = 0, n;
+    calib_table_t * t = NULL;
+
+    static chan_cal_t cal[NUM_CHANS];
+
+    fp = fopen(file, "r");
+    if (NULL == fp)
+    {
+        err("failed to open %s\n", file);
+        return NULL;
+    }
+
+    t = malloc(sizeof(calib_table_t));
+    if (NULL == t)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    t->bin_width = 1.0;
+    t->offset    = 0.0;
+
+    for (int ch=0; ch<NUM_CHANS; ch++)
+    {
+        cal[ch].type = CAL_POLY;
+        cal[ch].c[0] = 0.0;
+        cal[ch].c[1] = 1.0;
+        cal[ch].c[2] = 0.0;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_num++;
+        *strchrnul(line, '#') = 0;
+
+        n = sscanf(line, "%255s %255s", chans, arg);
+        if (n <= 0)
+        {
+            continue;  // blank line or comment
+        }
+        if (2 != n)
+        {
+            goto bad_line;
+        }
+
+        if (0 == strcmp(chans, "bin_width"))
+        {
+            if (1 != sscanf(arg, "%lf", &t->bin_width) || t->bin_width <= 0)
+            {
+                goto bad_line;
+            }
+            continue;
+        }
+        if (0 == strcmp(chans, "offset"))
+        {
+            if (1 != sscanf(arg, "%lf", &t->offset))
+            {
+                goto bad_line;
+            }
+            continue;
+        }
+
+        if (0 != parse_chan_list(chans, sel))
+        {
+            goto bad_line;
+        }
+
+        if (0 == strcmp(arg, "lut"))
+        {
+            if (1 != sscanf(line, "%*s %*s %255s", arg) || num_luts == NUM_CHANS)
+            {
+                goto bad_line;
+            }
+            luts[num_luts] = read_lut(arg);
+            if (NULL == luts[num_luts])
+            {
+                goto fail;
+            }
+            for (int ch=0; ch<NUM_CHANS; ch++)
+            {
+                if (sel[ch])
+                {
+                    cal[ch].type = CAL_LUT;
+                    cal[ch].lut  = luts[num_luts];
+                }
+            }
+            num_luts++;
+            continue;
+        }
+
+        c[2] = 0.0;
+        if (sscanf(line, "%*s %lf %lf %lf", &c[0], &c[1], &c[2]) < 2)
+        {
+            goto bad_line;
+        }
+        for (int ch=0; ch<NUM_CHANS; ch++)
+        {
+            if (sel[ch])
+            {
+                cal[ch].type = CAL_POLY;
+                memcpy(cal[ch].c, c, sizeof(c));
+            }
+        }
+    }
+    fclose(fp);
+    fp = NULL;
+
+    //--------------------------------------------------
+    // Fold calibration and rebinning into the LUT.
+    for (int ch=0; ch<NUM_CHANS; ch++)
+    {
+        for (int pd=0; pd<NUM_MCA_COL; pd++)
+        {
+            if (CAL_LUT == cal[ch].type)
+            {
+                e = cal[ch].lut[pd];
+            }
+            else
+            {
+                e = cal[ch].c[0] + pd*(cal[ch].c[1] + pd*cal[ch].c[2]);
+            }
+
+            bin = floor((e - t->offset) / t->bin_width);
+            if (bin >= 0 && bin < NUM_CAL_COL)
+            {
+                t->idx[ch][pd] = ch*NUM_CAL_COL + (uint32_t)bin;
+            }
+            else
+            {
+                t->idx[ch][pd] = NUM_CAL_ROW*NUM_CAL_COL;
+            }
+        }
+    }
+
+    for (int i=0; i<num_luts; i++)
+    {
+        free(luts[i]);
+    }
+    return t;
+
+bad_line:
+    err("%s line %d: invalid calibration\n", file, line_num);
+fail:
+    for (int i=0; i<num_luts; i++)
+    {
+        free(luts[i]);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    free(t);
+    return NULL;
+}
+
+
+//========================================================================
+// Sum the calibrated spectra of all channels.
+//========================================================================
+void calib_sum(const uint32_t* cal_mca_p, uint32_t* cal_sum_p)
+{
+    memset(cal_sum_p, 0, NUM_CAL_COL*sizeof(uint32_t));
+
+    for (int ch=0; ch<NUM_CAL_ROW; ch++)
+    {
+        for (int b=0; b<NUM_CAL_COL; b++)
+        {
+            cal_sum_p[b] += cal_mca_p[ch*NUM_CAL_COL + b];
+        }
+    }
+}
+
+
+//========================================================================
+// Reload CALIB_CFG_FILE if it has changed, and hand the new table to the
+// processing thread. Removing the file turns the calibration off.
+//========================================================================
+void calib_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    calib_table_t * t = NULL;
+    calib_table_t * old;
+
+    switch (cfg_file_changed(CALIB_CFG_FILE, &last_mtime))
+    {
+        case CFG_UNCHANGED:
+            return;
+
+        case CFG_REMOVED:
+            info("%s removed. Calibration turned off.\n", CALIB_CFG_FILE);
+            break;
+
+        default:
+            t = calib_load(CALIB_CFG_FILE);
+            if (NULL == t)
+            {
+                err("calibration in %s ignored.\n", CALIB_CFG_FILE);
+                return;
+            }
+            info( "calibration loaded (%g keV/bin from %g keV), effective from the next frame.\n",
+                  t->bin_width, t->offset );
+    }
+
+    // A removal is passed on as an empty table (bin_width 0).
+    if (NULL == t)
+    {
+        t = calloc(1, sizeof(calib_table_t));
+        if (NULL == t)
+        {
+            return;
+        }
+        t->bin_width = 0;
+    }
+
+    old = atomic_exchange(&calib_table_pending, t);
+    free(old);
+}
@@ -0,0 +1,56 @@
+#ifndef _CALIB_H_
+#define _CALIB_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Per-channel energy calibration.
+//
+// CALIB_CFG_FILE defines the energy axis of the calibrated
+// spectra and the calibration of each channel:
+//
+//     bin_width <keV>                 (default 1)
+//     offset    <keV>                 (energy of bin 0, default 0)
+//     <channels> <c0> <c1> [<c2>]     E = c0 + c1*pd + c2*pd^2
+//     <channels> lut <file>           E of each of the 4096 pd
+//                                     values, whitespace separated
+//
+// <channels> is "all" or a list like 0-31,64. Later lines
+// override earlier ones; channels not listed keep E = pd.
+//
+// All of it is folded into one LUT from (channel, pd) to the
+// count to increment, so calibrating costs the same as the
+// raw histogramming.
+//===========================================================
+
+typedef struct
+{
+    double     bin_width;
+    double     offset;
+    uint32_t   idx[NUM_CHANS][NUM_MCA_COL];   // index into cal_mca
+} calib_table_t;
+
+// New table from calib_cfg_poll(), taken over by the processing thread.
+extern _Atomic(calib_table_t*) calib_table_pending;
+
+void calib_cfg_poll(void);
+void calib_sum(const uint32_t* cal_mca_p, uint32_t* cal_sum_p);
+
+//========================================================================
+// Accumulate the calibrated spectra of a batch.
+//========================================================================
+static inline void calib_fill( const calib_table_t * t,
+                               const evt_batch_t   * batch,
+                               uint32_t            * cal_mca_p )
+{
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        cal_mca_p[t->idx[batch->addr[i]][batch->pd[i]]]++;
+    }
+}
+
+#endif
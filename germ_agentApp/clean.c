@@ -0,0 +1,80 @@
+/**
+ * File: clean.c
+ *
+ * Functionality: Clean event stream.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Packets stripped down to valid event/timestamp pairs, with
+ *               a fixed header per segment.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "germ.h"
+#include "clean.h"
+#include "log.h"
+
+
+_Static_assert(64 == sizeof(clean_hdr_t), "clean header must be 64 bytes");
+
+
+//========================================================================
+void clean_hdr_init(clean_hdr_t* hdr, uint32_t frame_num, uint32_t segment)
+{
+    memset(hdr, 0, sizeof(clean_hdr_t));
+    hdr->magic     = CLEAN_MAGIC;
+    hdr->version   = CLEAN_VERSION;
+    hdr->frame_num = frame_num;
+    hdr->segment   = segment;
+}
+
+
+//========================================================================
+// Copy the valid event/timestamp pairs of a packet in host byte order.
+// Returns the number of words copied.
+//
+// Like the packet decoder, pairs are compacted without branching.
+//========================================================================
+uint16_t clean_packet( const uint32_t * packet,
+                       uint16_t         packet_length,
+                       uint32_t       * out,
+                       uint32_t       * num_bad )
+{
+    uint16_t first = 2;  // packet counter and header
+    uint16_t last  = packet_length;
+    uint16_t n     = 0;
+
+    if (packet_length >= 4)
+    {
+        if (ntohl(packet[2]) == SOF_MARKER)
+        {
+            first = 4;
+        }
+        if (ntohl(packet[packet_length-1]) == EOF_MARKER)
+        {
+            last -= 2;
+        }
+    }
+
+    for (uint16_t i=first; i+1<last; i+=2)
+    {
+        uint32_t evt = ntohl(packet[i]);
+        uint32_t ts  = ntohl(packet[i+1]);
+
+        out[n]   = evt;
+        out[n+1] = ts;
+        n += ((!(evt & TS_FLAG)) & (!!(ts & TS_FLAG)) & (EVT_ADDR(evt) < NUM_CHANS)) << 1;
+    }
+
+    *num_bad += ((last > first) ? (last-first)>>1 : 0) - (n>>1);
+
+    return n;
+}
@@ -0,0 +1,51 @@
+#ifndef _CLEAN_H_
+#define _CLEAN_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Clean event stream.
+//
+// A clean segment, filename.runno.segno.evt, holds only the
+// valid event/timestamp pairs of the packets in it, as 32-bit
+// words in host byte order, after a fixed 64-byte header.
+// Pairs start at offset 64 and the file can be mapped as an
+// array of (event, timestamp) with no parsing.
+//
+// The header is completed when the segment is closed, so an
+// unfinished segment shows num_packets 0.
+//===========================================================
+
+#define CLEAN_MAGIC        0x54564547   // "GEVT"
+#define CLEAN_VERSION      1
+
+#define CLEAN_FLAG_SOF     0x01         // frame starts in this segment
+#define CLEAN_FLAG_EOF     0x02         // frame ends in this segment
+
+typedef struct
+{
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  frame_num;
+    uint32_t  segment;
+    uint32_t  num_packets;
+    uint32_t  first_packet;     // packet counters
+    uint32_t  last_packet;
+    uint32_t  num_lost;         // lost events reported at EOF
+    uint64_t  num_events;
+    uint32_t  num_bad;          // pairs left out as invalid
+    uint32_t  flags;
+    uint32_t  reserved[4];
+} clean_hdr_t;
+
+void     clean_hdr_init(clean_hdr_t* hdr, uint32_t frame_num, uint32_t segment);
+uint16_t clean_packet( const uint32_t * packet,
+                       uint16_t         packet_length,
+                       uint32_t       * out,
+                       uint32_t       * num_bad );
+
+#endif
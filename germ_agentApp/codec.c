@@ -0,0 +1,726 @@
+/**
+ * File: codec.c
+ *
+ * Functionality: Lossless codec for segment files.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Event pairs split into bit-packed field streams with
+ *               timestamp deltas, everything else kept as literals.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include "codec.h"
+
+
+_Static_assert(48 == sizeof(gsc_hdr_t),   "codec file header must be 48 bytes");
+_Static_assert(20 == sizeof(gsc_block_t), "codec block header must be 20 bytes");
+
+// event word layout, as in event.h (kept here so the library needs no EPICS)
+#define GSC_TS_FLAG       0x80000000
+#define GSC_TS_MASK       0x7fffffff
+#define GSC_EOF_MARKER    0xdecafbad
+#define GSC_ADDR(e)       ((e) >> 22)
+#define GSC_TD(e)         (((e) >> 12) & 0x3ff)
+#define GSC_PD(e)         ((e) & 0xfff)
+
+#define PAD8(n)           (((n) + 7) & ~(size_t)7)
+#define STREAM_SIZE(n, w) (((uint64_t)(n) * (w) + 63) / 64 * 8)
+
+enum { F_ADDR, F_TD, F_PD, F_TS, NUM_FIELDS };
+
+
+//========================================================================
+// Bit streams, LSB first, 32 bits at a time.
+//========================================================================
+typedef struct
+{
+    uint8_t  * p;
+    uint8_t  * start;
+    uint64_t   acc;
+    uint32_t   n;
+} bitw_t;
+
+typedef struct
+{
+    const uint8_t * p;
+    uint64_t        acc;
+    uint32_t        n;
+} bitr_t;
+
+static inline void put_bits(bitw_t* w, uint32_t v, uint32_t width)
+{
+    w->acc |= (uint64_t)v << w->n;
+    w->n   += width;
+    if (w->n >= 32)
+    {
+        uint32_t lo = (uint32_t)w->acc;
+        memcpy(w->p, &lo, 4);
+        w->p   += 4;
+        w->acc >>= 32;
+        w->n   -= 32;
+    }
+}
+
+static uint8_t* flush_bits(bitw_t* w)
+{
+    uint32_t lo = (uint32_t)w->acc;
+
+    if (w->n)
+    {
+        memcpy(w->p, &lo, 4);
+        w->p += 4;
+    }
+    while ((w->p - w->start) & 7)
+    {
+        *w->p++ = 0;
+    }
+    return w->p;
+}
+
+static inline uint32_t get_bits(bitr_t* r, uint32_t width)
+{
+    uint32_t v;
+
+    if (r->n < width)
+    {
+        uint32_t lo;
+        memcpy(&lo, r->p, 4);
+        r->p   += 4;
+        r->acc |= (uint64_t)lo << r->n;
+        r->n   += 32;
+    }
+    v = (uint32_t)(r->acc & (((uint64_t)1 << width) - 1));
+    r->acc >>= width;
+    r->n   -= width;
+    return v;
+}
+
+
+//========================================================================
+static inline uint32_t bit_width(uint32_t v)
+{
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+static inline uint32_t is_event(uint32_t e, uint32_t t)
+{
+    return (!(e & GSC_TS_FLAG)) & (!!(t & GSC_TS_FLAG)) & (t != GSC_EOF_MARKER);
+}
+
+static inline uint32_t zigzag(uint32_t ts, uint32_t prev)
+{
+    int32_t d = (int32_t)(((ts - prev) & GSC_TS_MASK) << 1) >> 1;
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t z, uint32_t prev)
+{
+    int32_t d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+    return (prev + (uint32_t)d) & GSC_TS_MASK;
+}
+
+
+//========================================================================
+// Payload size for the given counts and widths.
+//========================================================================
+static size_t payload_size(uint32_t num_pairs, uint32_t num_literals, const uint8_t* width)
+{
+    size_t   size       = PAD8((num_pairs + 7) / 8) + 8 * (size_t)num_literals;
+    uint32_t num_events = num_pairs - num_literals;
+
+    for (int f=0; f<NUM_FIELDS; f++)
+    {
+        size += STREAM_SIZE(num_events, width[f]);
+    }
+    return size;
+}
+
+
+//========================================================================
+// Encode 'num_pairs' pairs of host order words. 'last_ts' is the last
+// timestamp of the previous block (0 for the first), and is updated.
+// 'out' must hold GSC_BLOCK_BOUND(num_pairs) bytes. Returns the bytes
+// written.
+//========================================================================
+size_t gsc_encode_block( const uint32_t * words,
+                         uint32_t         num_pairs,
+                         uint32_t       * last_ts,
+                         uint8_t        * out )
+{
+    gsc_block_t blk;
+    uint32_t    or[NUM_FIELDS] = { 0 };
+    uint32_t    prev, num_literals = 0;
+    uint8_t   * bitmap = out + sizeof(gsc_block_t);
+    uint8_t   * lit;
+    uint8_t   * p;
+    bitw_t      w;
+
+    //--------------------------------------------------
+    // Classify and size the fields.
+    memset(bitmap, 0, PAD8((num_pairs + 7) / 8));
+    prev = *last_ts;
+    for (uint32_t i=0; i<num_pairs; i++)
+    {
+        uint32_t e  = words[2*i];
+        uint32_t t  = words[2*i+1];
+        uint32_t ev = is_event(e, t);
+
+        bitmap[i >> 3] |= ev << (i & 7);
+        num_literals   += !ev;
+        if (ev)
+        {
+            or[F_ADDR] |= GSC_ADDR(e);
+            or[F_TD]   |= GSC_TD(e);
+            or[F_PD]   |= GSC_PD(e);
+            or[F_TS]   |= zigzag(t & GSC_TS_MASK, prev);
+            prev        = t & GSC_TS_MASK;
+        }
+    }
+
+    memset(&blk, 0, sizeof(blk));
+    blk.num_pairs    = num_pairs;
+    blk.num_literals = num_literals;
+    blk.ts_base      = *last_ts;
+    for (int f=0; f<NUM_FIELDS; f++)
+    {
+        blk.width[f] = bit_width(or[f]);
+    }
+    blk.size = payload_size(num_pairs, num_literals, blk.width);
+    memcpy(out, &blk, sizeof(blk));
+
+    //--------------------------------------------------
+    // Literals, then one stream per field.
+    lit = bitmap + PAD8((num_pairs + 7) / 8);
+    p   = lit;
+    for (uint32_t i=0; i<num_pairs; i++)
+    {
+        if (!(bitmap[i >> 3] & (1 << (i & 7))))
+        {
+            memcpy(p, &words[2*i], 8);
+            p += 8;
+        }
+    }
+
+    for (int f=0; f<NUM_FIELDS; f++)
+    {
+        w.p = w.start = p;
+        w.acc = 0;
+        w.n   = 0;
+        prev  = blk.ts_base;
+        for (uint32_t i=0; i<num_pairs; i++)
+        {
+            uint32_t e = words[2*i];
+            uint32_t t = words[2*i+1] & GSC_TS_MASK;
+            uint32_t v;
+
+            if (!(bitmap[i >> 3] & (1 << (i & 7))))
+            {
+                continue;
+            }
+            switch (f)
+            {
+                case F_ADDR: v = GSC_ADDR(e);        break;
+                case F_TD:   v = GSC_TD(e);          break;
+                case F_PD:   v = GSC_PD(e);          break;
+                default:     v = zigzag(t, prev);
+                             prev = t;               break;
+            }
+            put_bits(&w, v, blk.width[f]);
+        }
+        p = flush_bits(&w);
+    }
+    *last_ts = prev;
+
+    return sizeof(gsc_block_t) + blk.size;
+}
+
+
+//========================================================================
+// Decode one block from 'in' into host order words. Returns -1 if the
+// block is malformed or truncated.
+//========================================================================
+int gsc_decode_block( const uint8_t * in,
+                      size_t          avail,
+                      uint32_t      * words,
+                      uint32_t      * num_pairs,
+                      size_t        * used )
+{
+    gsc_block_t     blk;
+    const uint8_t * bitmap;
+    const uint8_t * lit;
+    const uint8_t * stream[NUM_FIELDS];
+    bitr_t          r[NUM_FIELDS];
+    uint32_t        prev;
+
+    if (avail < sizeof(gsc_block_t))
+    {
+        return -1;
+    }
+    memcpy(&blk, in, sizeof(blk));
+
+    if ( blk.num_literals > blk.num_pairs ||
+         blk.width[F_ADDR] > 9 || blk.width[F_TD] > 10 || blk.width[F_PD] > 12 || blk.width[F_TS] > 32 ||
+         blk.size != payload_size(blk.num_pairs, blk.num_literals, blk.width) ||
+         avail - sizeof(gsc_block_t) < blk.size )
+    {
+        return -1;
+    }
+
+    bitmap = in + sizeof(gsc_block_t);
+    lit    = bitmap + PAD8((blk.num_pairs + 7) / 8);
+    stream[0] = lit + 8 * (size_t)blk.num_literals;
+    for (int f=1; f<NUM_FIELDS; f++)
+    {
+        stream[f] = stream[f-1] + STREAM_SIZE(blk.num_pairs - blk.num_literals, blk.width[f-1]);
+    }
+    for (int f=0; f<NUM_FIELDS; f++)
+    {
+        r[f].p   = stream[f];
+        r[f].acc = 0;
+        r[f].n   = 0;
+    }
+
+    prev = blk.ts_base;
+    for (uint32_t i=0; i<blk.num_pairs; i++)
+    {
+        if (bitmap[i >> 3] & (1 << (i & 7)))
+        {
+            uint32_t addr = get_bits(&r[F_ADDR], blk.width[F_ADDR]);
+            uint32_t td   = get_bits(&r[F_TD],   blk.width[F_TD]);
+            uint32_t pd   = get_bits(&r[F_PD],   blk.width[F_PD]);
+
+            prev = unzigzag(get_bits(&r[F_TS], blk.width[F_TS]), prev);
+            words[2*i]   = (addr << 22) | (td << 12) | pd;
+            words[2*i+1] = GSC_TS_FLAG | prev;
+        }
+        else
+        {
+            memcpy(&words[2*i], lit, 8);
+            lit += 8;
+        }
+    }
+
+    *num_pairs = blk.num_pairs;
+    *used      = sizeof(gsc_block_t) + blk.size;
+    return 0;
+}
+
+
+//========================================================================
+static ssize_t read_full(int fd, void* buf, size_t len)
+{
+    size_t  done = 0;
+    ssize_t n;
+
+    while (done < len)
+    {
+        n = read(fd, (uint8_t*)buf + done, len - done);
+        if (n < 0)
+        {
+            return -1;
+        }
+        if (0 == n)
+        {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static int write_full(int fd, const void* buf, size_t len)
+{
+    size_t  done = 0;
+    ssize_t n;
+
+    while (done < len)
+    {
+        n = write(fd, (const uint8_t*)buf + done, len - done);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+static double thread_cpu_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+// Compress a segment file. 'yield' (may be NULL) is called between
+// blocks, for the caller to throttle.
+//========================================================================
+int gsc_compress_file( const char  * in_file,
+                       const char  * out_file,
+                       uint32_t      order,
+                       uint32_t      preamble,
+                       void        (*yield)(void),
+                       gsc_stats_t * stats )
+{
+    gsc_hdr_t   hdr;
+    uint32_t  * words = NULL;
+    uint8_t   * enc   = NULL;
+    uint8_t     pre[256];
+    int         in = -1, out = -1, ret = -1;
+    ssize_t     len;
+    size_t      size;
+    uint64_t    out_bytes;
+    uint32_t    last_ts = 0;
+    double      cpu0 = thread_cpu_sec();
+
+    if (preamble > sizeof(pre))
+    {
+        return -1;
+    }
+
+    words = malloc(8 * GSC_BLOCK_PAIRS);
+    enc   = malloc(GSC_BLOCK_BOUND(GSC_BLOCK_PAIRS));
+    in    = open(in_file, O_RDONLY);
+    out   = open(out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (NULL == words || NULL == enc || in < 0 || out < 0)
+    {
+        goto done;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic       = GSC_MAGIC;
+    hdr.version     = GSC_VERSION;
+    hdr.order       = order;
+    hdr.preamble    = preamble;
+    hdr.block_pairs = GSC_BLOCK_PAIRS;
+
+    if ( (ssize_t)preamble != read_full(in, pre, preamble) ||
+         0 != write_full(out, &hdr, sizeof(hdr))           ||
+         0 != write_full(out, pre, preamble) )
+    {
+        goto done;
+    }
+    hdr.orig_size = preamble;
+    out_bytes     = sizeof(hdr) + preamble;
+
+    while ((len = read_full(in, words, 8 * GSC_BLOCK_PAIRS)) > 0)
+    {
+        uint32_t n = len >> 3;
+
+        if (len & 7)
+        {
+            hdr.tail_len = len & 7;
+            memcpy(hdr.tail, (uint8_t*)words + 8*n, hdr.tail_len);
+        }
+        if (GSC_ORDER_NET == order)
+        {
+            for (uint32_t i=0; i<2*n; i++)
+            {
+                words[i] = ntohl(words[i]);
+            }
+        }
+
+        if (n)
+        {
+            size = gsc_encode_block(words, n, &last_ts, enc);
+            if (0 != write_full(out, enc, size))
+            {
+                goto done;
+            }
+            out_bytes += size;
+            hdr.num_blocks++;
+        }
+        hdr.orig_size += len;
+
+        if (len < 8 * GSC_BLOCK_PAIRS)
+        {
+            break;
+        }
+        if (yield)
+        {
+            yield();
+        }
+    }
+    if (len < 0 || pwrite(out, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+    {
+        goto done;
+    }
+
+    if (stats)
+    {
+        stats->in_bytes  = hdr.orig_size;
+        stats->out_bytes = out_bytes;
+        stats->cpu_sec   = thread_cpu_sec() - cpu0;
+    }
+    ret = 0;
+
+done:
+    if (in >= 0)
+    {
+        close(in);
+    }
+    if (out >= 0 && 0 != close(out))
+    {
+        ret = -1;
+    }
+    free(words);
+    free(enc);
+    return ret;
+}
+
+
+//========================================================================
+// Decode a whole file, handing the original bytes to 'sink' in order.
+//========================================================================
+typedef int (*gsc_sink_t)(void* ctx, const void* buf, size_t len);
+
+static int gsc_decode_file(const char* gsc_file, gsc_sink_t sink, void* ctx, gsc_stats_t* stats)
+{
+    gsc_hdr_t    hdr;
+    gsc_block_t  blk;
+    uint32_t   * words = NULL;
+    uint8_t    * enc   = NULL;
+    uint8_t      pre[256];
+    uint32_t     n;
+    uint64_t     total = 0;
+    size_t       used;
+    struct stat  st;
+    int          in, ret = -1;
+    double       cpu0 = thread_cpu_sec();
+
+    in = open(gsc_file, O_RDONLY);
+    if (in < 0)
+    {
+        return -1;
+    }
+
+    if ( sizeof(hdr) != read_full(in, &hdr, sizeof(hdr)) ||
+         GSC_MAGIC != hdr.magic || GSC_VERSION != hdr.version ||
+         hdr.preamble > sizeof(pre) || hdr.tail_len > 7 ||
+         0 == hdr.block_pairs || hdr.block_pairs > (1 << 24) )
+    {
+        goto done;
+    }
+
+    words = malloc(8 * (size_t)hdr.block_pairs);
+    enc   = malloc(GSC_BLOCK_BOUND(hdr.block_pairs));
+    if (NULL == words || NULL == enc)
+    {
+        goto done;
+    }
+
+    if ( (ssize_t)hdr.preamble != read_full(in, pre, hdr.preamble) ||
+         0 != sink(ctx, pre, hdr.preamble) )
+    {
+        goto done;
+    }
+    total = hdr.preamble;
+
+    for (uint32_t b=0; b<hdr.num_blocks; b++)
+    {
+        if (sizeof(blk) != read_full(in, &blk, sizeof(blk)))
+        {
+            goto done;
+        }
+        if ( blk.num_pairs > hdr.block_pairs ||
+             blk.size > GSC_BLOCK_BOUND(hdr.block_pairs) - sizeof(blk) )
+        {
+            goto done;
+        }
+        memcpy(enc, &blk, sizeof(blk));
+        if ( (ssize_t)blk.size != read_full(in, enc + sizeof(blk), blk.size) ||
+             0 != gsc_decode_block(enc, sizeof(blk) + blk.size, words, &n, &used) )
+        {
+            goto done;
+        }
+
+        if (GSC_ORDER_NET == hdr.order)
+        {
+            for (uint32_t i=0; i<2*n; i++)
+            {
+                words[i] = htonl(words[i]);
+            }
+        }
+        if (0 != sink(ctx, words, 8 * (size_t)n))
+        {
+            goto done;
+        }
+        total += 8 * (uint64_t)n;
+    }
+
+    if (0 != sink(ctx, hdr.tail, hdr.tail_len))
+    {
+        goto done;
+    }
+    total += hdr.tail_len;
+
+    if (total != hdr.orig_size)
+    {
+        goto done;
+    }
+
+    if (stats)
+    {
+        fstat(in, &st);
+        stats->in_bytes  = hdr.orig_size;
+        stats->out_bytes = st.st_size;
+        stats->cpu_sec   = thread_cpu_sec() - cpu0;
+    }
+    ret = 0;
+
+done:
+    close(in);
+    free(words);
+    free(enc);
+    return ret;
+}
+
+
+//========================================================================
+// Sinks
+//========================================================================
+static int sink_fd(void* ctx, const void* buf, size_t len)
+{
+    return write_full(*(int*)ctx, buf, len);
+}
+
+typedef struct
+{
+    int       fd;
+    uint8_t * buff;
+} cmp_ctx_t;
+
+static int sink_cmp(void* ctx, const void* buf, size_t len)
+{
+    cmp_ctx_t * c = (cmp_ctx_t*)ctx;
+
+    if (0 == len)
+    {
+        return 0;
+    }
+    if ((ssize_t)len != read_full(c->fd, c->buff, len))
+    {
+        return -1;
+    }
+    return memcmp(c->buff, buf, len) ? -1 : 0;
+}
+
+typedef struct
+{
+    uint8_t * data;
+    uint64_t  len;
+    uint64_t  cap;
+} mem_ctx_t;
+
+static int sink_mem(void* ctx, const void* buf, size_t len)
+{
+    mem_ctx_t * m = (mem_ctx_t*)ctx;
+
+    if (m->len + len > m->cap)
+    {
+        return -1;
+    }
+    memcpy(m->data + m->len, buf, len);
+    m->len += len;
+    return 0;
+}
+
+
+//========================================================================
+int gsc_decompress_file(const char* in_file, const char* out_file, gsc_stats_t* stats)
+{
+    int fd, ret;
+
+    fd = open(out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    ret = gsc_decode_file(in_file, sink_fd, &fd, stats);
+    if (0 != close(fd))
+    {
+        ret = -1;
+    }
+    return ret;
+}
+
+
+//========================================================================
+// Check that 'gsc_file' decodes to exactly the contents of 'orig_file'.
+//========================================================================
+int gsc_verify_file(const char* gsc_file, const char* orig_file)
+{
+    cmp_ctx_t   c;
+    struct stat st;
+    gsc_stats_t stats;
+    int         ret = -1;
+
+    c.fd   = open(orig_file, O_RDONLY);
+    c.buff = malloc(8 * GSC_BLOCK_PAIRS);
+    if (c.fd >= 0 && NULL != c.buff && 0 == fstat(c.fd, &st))
+    {
+        ret = gsc_decode_file(gsc_file, sink_cmp, &c, &stats);
+        if (0 == ret && stats.in_bytes != (uint64_t)st.st_size)
+        {
+            ret = -1;
+        }
+    }
+
+    if (c.fd >= 0)
+    {
+        close(c.fd);
+    }
+    free(c.buff);
+    return ret;
+}
+
+
+//========================================================================
+int64_t gsc_read(const char* gsc_file, uint8_t** data)
+{
+    gsc_hdr_t hdr;
+    mem_ctx_t m;
+    int       fd;
+
+    fd = open(gsc_file, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (sizeof(hdr) != read_full(fd, &hdr, sizeof(hdr)) || GSC_MAGIC != hdr.magic)
+    {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    m.data = malloc(hdr.orig_size ? hdr.orig_size : 1);
+    m.len  = 0;
+    m.cap  = hdr.orig_size;
+    if (NULL == m.data || 0 != gsc_decode_file(gsc_file, sink_mem, &m, NULL))
+    {
+        free(m.data);
+        return -1;
+    }
+
+    *data = m.data;
+    return m.len;
+}
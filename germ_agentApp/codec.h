@@ -0,0 +1,101 @@
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//===========================================================
+// Lossless codec for segment files.
+//
+// A segment is a sequence of 8-byte pairs. Pairs that look
+// like events (event word without, timestamp word with the
+// flag bit) are split into fields and stored per block as
+// bit-packed streams:
+//
+//     address (chip/chan)    max width in the block
+//     td, pd                 max width in the block
+//     timestamp              zigzag delta to the previous
+//                            event, max width in the block
+//
+// Anything else (packet counters, SOF/EOF, malformed pairs)
+// is kept as a literal. A bitmap tells the two apart, so the
+// original file is restored bit for bit.
+//
+// File format, in host byte order:
+//
+//     gsc_hdr_t
+//     preamble bytes   (e.g. the header of a clean segment)
+//     blocks:  gsc_block_t, then its payload:
+//              bitmap, literals, address, td, pd and
+//              timestamp streams, each padded to 8 bytes
+//
+// This file, codec.c and germ_codec.c don't depend on EPICS,
+// so they also build as the decoder library for readers.
+//===========================================================
+
+#define GSC_MAGIC          0x43534747   // "GGSC"
+#define GSC_VERSION        1
+#define GSC_EXT            ".gsc"
+
+#define GSC_BLOCK_PAIRS    8192
+
+// byte order of the words in the original file
+#define GSC_ORDER_NET      0            // raw segments
+#define GSC_ORDER_HOST     1            // clean segments
+
+typedef struct
+{
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  order;
+    uint32_t  preamble;         // bytes before the first pair
+    uint64_t  orig_size;
+    uint32_t  block_pairs;
+    uint32_t  num_blocks;
+    uint32_t  tail_len;         // bytes after the last whole pair
+    uint8_t   tail[8];
+    uint32_t  reserved;
+} gsc_hdr_t;
+
+typedef struct
+{
+    uint32_t  num_pairs;
+    uint32_t  num_literals;
+    uint32_t  ts_base;          // timestamp the first delta is from
+    uint8_t   width[4];         // address, td, pd, timestamp delta
+    uint32_t  size;             // payload bytes
+} gsc_block_t;
+
+typedef struct
+{
+    uint64_t  in_bytes;         // original size
+    uint64_t  out_bytes;        // compressed size
+    double    cpu_sec;          // CPU time of the calling thread
+} gsc_stats_t;
+
+// worst case size of an encoded block
+#define GSC_BLOCK_BOUND(n) (sizeof(gsc_block_t) + 6*8 + ((n)+7)/8 + 8*(size_t)(n))
+
+size_t gsc_encode_block( const uint32_t * words,
+                         uint32_t         num_pairs,
+                         uint32_t       * last_ts,
+                         uint8_t        * out );
+int    gsc_decode_block( const uint8_t * in,
+                         size_t          avail,
+                         uint32_t      * words,
+                         uint32_t      * num_pairs,
+                         size_t        * used );
+
+int gsc_compress_file( const char  * in_file,
+                       const char  * out_file,
+                       uint32_t      order,
+                       uint32_t      preamble,
+                       void        (*yield)(void),
+                       gsc_stats_t * stats );
+int gsc_decompress_file(const char* in_file, const char* out_file, gsc_stats_t* stats);
+int gsc_verify_file(const char* gsc_file, const char* orig_file);
+
+// Whole decompressed file in a malloc'ed buffer. Returns its size or -1.
+int64_t gsc_read(const char* gsc_file, uint8_t** data);
+
+#endif
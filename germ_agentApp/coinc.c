@@ -0,0 +1,335 @@
+/**
+ * File: coinc.c
+ *
+ * Functionality: Coincidences across channels.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Time wheel ordering the events of all channels, swept for
+ *               coincidences into multiplicity and channel pair histograms.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "coinc.h"
+#include "log.h"
+
+
+_Atomic(coinc_cfg_t*) coinc_cfg_pending = ATOMIC_VAR_INIT(NULL);
+
+
+//========================================================================
+coinc_t* coinc_create(const coinc_cfg_t* cfg, uint32_t* mult, uint32_t* pairs)
+{
+    coinc_t * c;
+
+    c = calloc(1, sizeof(coinc_t));
+    if (NULL == c)
+    {
+        return NULL;
+    }
+
+    c->cfg   = *cfg;
+    c->lag   = (cfg->delay + cfg->window - 1) / cfg->window;
+    c->mult  = mult;
+    c->pairs = pairs;
+
+    // the wheel holds the delay plus the bucket being filled
+    c->num_buckets = 1;
+    while (c->num_buckets <= c->lag)
+    {
+        c->num_buckets <<= 1;
+    }
+
+    c->evt  = malloc((size_t)c->num_buckets * cfg->depth * sizeof(coinc_evt_t));
+    c->fill = calloc(c->num_buckets, sizeof(uint32_t));
+    if (NULL == c->evt || NULL == c->fill)
+    {
+        coinc_free(c);
+        return NULL;
+    }
+
+    return c;
+}
+
+
+//========================================================================
+void coinc_free(coinc_t* c)
+{
+    if (NULL == c)
+    {
+        return;
+    }
+
+    free(c->evt);
+    free(c->fill);
+    free(c);
+}
+
+
+//========================================================================
+// Count the coincidence built so far.
+//========================================================================
+static void coinc_emit(coinc_t* c)
+{
+    uint16_t lo, hi;
+
+    if (0 == c->cl_n)
+    {
+        return;
+    }
+
+    c->mult[(c->cl_n < COINC_MAX_MULT) ? c->cl_n : COINC_MAX_MULT-1]++;
+
+    if (2 == c->cl_n)
+    {
+        lo = c->cl_addr[0];
+        hi = c->cl_addr[1];
+        if (lo > hi)
+        {
+            lo = c->cl_addr[1];
+            hi = c->cl_addr[0];
+        }
+        c->pairs[lo*NUM_CHANS + hi]++;
+    }
+
+    c->cl_n = 0;
+}
+
+
+//========================================================================
+// Sort a bucket by time and sweep it for coincidences.
+//========================================================================
+static void coinc_sweep(coinc_t* c, uint64_t k)
+{
+    uint32_t      slot = k & (c->num_buckets - 1);
+    uint32_t      n    = c->fill[slot];
+    coinc_evt_t * e    = &c->evt[(size_t)slot * c->cfg.depth];
+    coinc_evt_t   tmp;
+    uint32_t      i, j;
+
+    // insertion sort, events are nearly in order
+    for (i=1; i<n; i++)
+    {
+        tmp = e[i];
+        for (j=i; j>0 && e[j-1].t > tmp.t; j--)
+        {
+            e[j] = e[j-1];
+        }
+        e[j] = tmp;
+    }
+
+    for (i=0; i<n; i++)
+    {
+        if (c->cl_n && e[i].t - c->cl_t0 < c->cfg.window)
+        {
+            if (c->cl_n < 2)
+            {
+                c->cl_addr[c->cl_n] = e[i].addr;
+            }
+            c->cl_n++;
+        }
+        else
+        {
+            coinc_emit(c);
+            c->cl_n       = 1;
+            c->cl_t0      = e[i].t;
+            c->cl_addr[0] = e[i].addr;
+        }
+    }
+
+    c->fill[slot] = 0;
+}
+
+
+//========================================================================
+// Sweep the buckets before 'to'. Buckets are only ever swept in order.
+//========================================================================
+static void coinc_advance(coinc_t* c, uint64_t to)
+{
+    // after a long gap, no more than the whole wheel holds anything
+    if (to - c->drain > c->num_buckets)
+    {
+        for (uint64_t k=c->drain; k<c->drain+c->num_buckets; k++)
+        {
+            coinc_sweep(c, k);
+        }
+        c->drain = to;
+        return;
+    }
+
+    for (; c->drain<to; c->drain++)
+    {
+        coinc_sweep(c, c->drain);
+    }
+}
+
+
+//========================================================================
+// Start a run. The histograms are cleared.
+//========================================================================
+void coinc_start(coinc_t* c)
+{
+    memset(c->mult, 0, COINC_MAX_MULT*sizeof(uint32_t));
+    memset(c->pairs, 0, NUM_CHANS*NUM_CHANS*sizeof(uint32_t));
+    memset(c->fill, 0, c->num_buckets*sizeof(uint32_t));
+    memset(&c->unwrap, 0, sizeof(c->unwrap));
+
+    c->started      = 0;
+    c->cl_n         = 0;
+    c->num_late     = 0;
+    c->num_overflow = 0;
+}
+
+
+//========================================================================
+// Put the events of a batch on the wheel. O(1) per event, plus the sweep
+// of the buckets falling out of the delay.
+//========================================================================
+void coinc_fill(coinc_t* c, const evt_batch_t* batch)
+{
+    uint64_t  t, k;
+    uint32_t  slot;
+
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        t = ts_unwrap(&c->unwrap, batch->ts[i]);
+        k = t / c->cfg.window;
+
+        if (!c->started)
+        {
+            c->drain   = k;
+            c->latest  = k;
+            c->started = 1;
+        }
+
+        if (k < c->drain)
+        {
+            c->num_late++;
+            continue;
+        }
+
+        if (k > c->latest)
+        {
+            c->latest = k;
+            if (k - c->drain > c->lag)
+            {
+                coinc_advance(c, k - c->lag);
+            }
+        }
+
+        slot = k & (c->num_buckets - 1);
+        if (c->fill[slot] < c->cfg.depth)
+        {
+            c->evt[(size_t)slot*c->cfg.depth + c->fill[slot]].t    = t;
+            c->evt[(size_t)slot*c->cfg.depth + c->fill[slot]].addr = batch->addr[i];
+            c->fill[slot]++;
+        }
+        else
+        {
+            c->num_overflow++;
+        }
+    }
+}
+
+
+//========================================================================
+// End of run: sweep whatever is left on the wheel.
+//========================================================================
+void coinc_finish(coinc_t* c)
+{
+    if (c->started)
+    {
+        coinc_advance(c, c->latest + 1);
+        coinc_emit(c);
+        c->started = 0;
+    }
+
+    if (c->num_late)
+    {
+        warn("%lu events too late for coincidence\n", c->num_late);
+    }
+    if (c->num_overflow)
+    {
+        warn("%lu events over the coincidence depth of %u\n", c->num_overflow, c->cfg.depth);
+    }
+}
+
+
+//========================================================================
+// Reload COINC_CFG_FILE if it has changed. Removing the file, or a zero
+// window, turns coincidences off.
+//========================================================================
+void coinc_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    coinc_cfg_t * cfg;
+    coinc_cfg_t * old;
+    int           status;
+
+    status = cfg_file_changed(COINC_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        return;
+    }
+
+    cfg = calloc(1, sizeof(coinc_cfg_t));
+    if (NULL == cfg)
+    {
+        return;
+    }
+    cfg->depth = 1024;
+    cfg->delay = UINT64_MAX;    // until set
+
+    cfg_key_t keys[] =
+    {
+        { "window", CFG_U64, &cfg->window },
+        { "delay",  CFG_U64, &cfg->delay  },
+        { "depth",  CFG_U32, &cfg->depth  },
+    };
+
+    if (CFG_CHANGED == status)
+    {
+        if (0 != cfg_read(COINC_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0])))
+        {
+            free(cfg);
+            return;
+        }
+
+        if (UINT64_MAX == cfg->delay)
+        {
+            cfg->delay = 16 * cfg->window;
+        }
+
+        if ( 0 == cfg->depth || cfg->depth > (1u << 20) ||
+             (cfg->window && cfg->delay / cfg->window > 4096) )
+        {
+            err("invalid delay/depth in %s. Ignored.\n", COINC_CFG_FILE);
+            free(cfg);
+            return;
+        }
+    }
+
+    if (cfg->window)
+    {
+        info( "coincidence window of %lu ticks (delay %lu, depth %u), effective from the next frame.\n",
+              cfg->window, cfg->delay, cfg->depth );
+    }
+    else
+    {
+        info("coincidences turned off.\n");
+    }
+
+    old = atomic_exchange(&coinc_cfg_pending, cfg);
+    free(old);
+}
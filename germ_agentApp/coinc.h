@@ -0,0 +1,83 @@
+#ifndef _COINC_H_
+#define _COINC_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Coincidences across channels.
+//
+// Events of all channels are put in order of time on a time
+// wheel: a ring of buckets one coincidence window wide. The
+// wheel is held back by a delay to let late events in; a
+// bucket that falls out of the delay is sorted (it is small
+// and nearly in order already) and swept. A coincidence is a
+// run of events within one window of its first event.
+//
+// Each coincidence increments the multiplicity histogram, and
+// a two-fold one also increments the (lower, higher) channel
+// pair matrix, e.g. for charge-sharing correction.
+//
+// Buckets have a fixed depth, so memory is bounded; events
+// that don't fit, or arrive after their bucket was swept, are
+// only counted.
+//
+// COINC_CFG_FILE:
+//
+//     window  <ticks>    coincidence window in timestamp ticks
+//     delay   <ticks>    time to wait for late events
+//                        (default 16 windows)
+//     depth   <n>        events per window (default 1024)
+//===========================================================
+
+typedef struct
+{
+    uint64_t  window;
+    uint64_t  delay;
+    uint32_t  depth;
+} coinc_cfg_t;
+
+typedef struct
+{
+    uint64_t  t;
+    uint16_t  addr;
+} coinc_evt_t;
+
+typedef struct
+{
+    coinc_cfg_t    cfg;
+    uint32_t       num_buckets;      // power of 2
+    uint64_t       lag;              // delay in buckets
+    coinc_evt_t  * evt;              // num_buckets x depth
+    uint32_t     * fill;             // events in each bucket
+    uint8_t        started;
+    uint64_t       drain;            // oldest bucket not swept yet
+    uint64_t       latest;           // newest bucket seen
+    ts_unwrap_t    unwrap;
+
+    // coincidence being built by the sweep
+    uint32_t       cl_n;
+    uint64_t       cl_t0;
+    uint16_t       cl_addr[2];
+
+    uint64_t       num_late;
+    uint64_t       num_overflow;
+
+    uint32_t     * mult;             // COINC_MAX_MULT
+    uint32_t     * pairs;            // NUM_CHANS x NUM_CHANS
+} coinc_t;
+
+// New configuration from coinc_cfg_poll(), taken by the processing thread.
+extern _Atomic(coinc_cfg_t*) coinc_cfg_pending;
+
+void     coinc_cfg_poll(void);
+coinc_t* coinc_create(const coinc_cfg_t* cfg, uint32_t* mult, uint32_t* pairs);
+void     coinc_free(coinc_t* c);
+void     coinc_start(coinc_t* c);
+void     coinc_fill(coinc_t* c, const evt_batch_t* batch);
+void     coinc_finish(coinc_t* c);
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * File: columnar.c
+ *
+ * Functionality: Columnar events.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Closed segments converted to per-field arrays with 64-bit
+ *               unwrapped timestamps, as a segment pipeline stage;
+ *               Timestamps continued from the unwrap state posted with
+ *               each segment, whatever order segments come in.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include "germ.h"
+#include "columnar.h"
+#include "output.h"
+#include "clean.h"
+#include "log.h"
+
+
+_Static_assert(64 == sizeof(col_hdr_t), "columnar header must be 64 bytes");
+
+#define COL_CHUNK_PAIRS   (1 << 17)   // 1 MB of input at a time
+
+static const uint8_t col_size[NUM_COLS] = { 1, 1, 2, 2, 8 };
+
+typedef struct
+{
+    uint8_t   chip[COL_CHUNK_PAIRS];
+    uint8_t   chan[COL_CHUNK_PAIRS];
+    uint16_t  td[COL_CHUNK_PAIRS];
+    uint16_t  pd[COL_CHUNK_PAIRS];
+    uint32_t  ts[COL_CHUNK_PAIRS];
+    uint64_t  ts64[COL_CHUNK_PAIRS];
+} col_chunk_t;
+
+
+//========================================================================
+// Unpack the valid events of a chunk of pairs. Raw segments are in
+// network byte order and still carry the packet framing: counter/header
+// pairs have no timestamp flag, the SOF marker has the event flag, and
+// the EOF pair is recognized by its marker.
+//
+// Pairs are compacted without branching, like the packet decoder.
+//========================================================================
+static uint32_t col_unpack( const uint32_t * w,
+                            uint32_t         num_pairs,
+                            uint8_t          raw,
+                            col_chunk_t    * c )
+{
+    uint32_t n = 0;
+
+    for (uint32_t i=0; i<num_pairs; i++)
+    {
+        uint32_t evt = raw ? ntohl(w[2*i])   : w[2*i];
+        uint32_t ts  = raw ? ntohl(w[2*i+1]) : w[2*i+1];
+
+        c->chip[n] = EVT_CHIP(evt);
+        c->chan[n] = EVT_CHAN(evt);
+        c->td[n]   = EVT_TD(evt);
+        c->pd[n]   = EVT_PD(evt);
+        c->ts[n]   = ts & TS_MASK;
+
+        n += (!(evt & TS_FLAG)) & (!!(ts & TS_FLAG)) & (ts != EOF_MARKER)
+           & (EVT_ADDR(evt) < NUM_CHANS);
+    }
+
+    return n;
+}
+
+
+//========================================================================
+// Convert a closed segment to FILE.col next to it.
+//========================================================================
+int columnar_convert(seg_item_t* item)
+{
+    static uint32_t    buff[2*COL_CHUNK_PAIRS];
+    static col_chunk_t chunk;
+
+    char      colfile[MAX_FILENAME_LEN];
+    int       in = -1, out = -1;
+    off_t     data_start = 0;
+    ssize_t   len;
+    uint32_t  n;
+    uint64_t  num_events = 0, done = 0;
+    col_hdr_t hdr;
+    uint8_t   raw = (OUTPUT_CLEAN != item->format);
+    ts_unwrap_t unwrap = item->unwrap;  // continue the frame's timestamps
+
+    seg_side_name(item, ".col", colfile);
+
+    in = open(item->path, O_RDONLY);
+    if (in < 0)
+    {
+        err("failed to open %s\n", item->path);
+        return -1;
+    }
+    if (!raw)
+    {
+        data_start = sizeof(clean_hdr_t);
+    }
+
+    //--------------------------------------------------
+    // Count the events to lay the columns out.
+    lseek(in, data_start, SEEK_SET);
+    while ((len = read(in, buff, sizeof(buff))) > 0)
+    {
+        num_events += col_unpack(buff, len >> 3, raw, &chunk);
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic      = COL_MAGIC;
+    hdr.version    = COL_VERSION;
+    hdr.frame_num  = item->run_num;
+    hdr.segment    = item->segment;
+    hdr.num_events = num_events;
+    hdr.offset[0]  = COL_ALIGN;
+    for (int c=1; c<NUM_COLS; c++)
+    {
+        hdr.offset[c] = hdr.offset[c-1] + num_events*col_size[c-1];
+        hdr.offset[c] = (hdr.offset[c] + COL_ALIGN - 1) & ~(uint64_t)(COL_ALIGN - 1);
+    }
+
+    out = open(colfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+    {
+        err("failed to open %s\n", colfile);
+        close(in);
+        return -1;
+    }
+
+    //--------------------------------------------------
+    // Unpack and write out, a chunk at a time.
+    lseek(in, data_start, SEEK_SET);
+    while ((len = read(in, buff, sizeof(buff))) > 0)
+    {
+        n = col_unpack(buff, len >> 3, raw, &chunk);
+        for (uint32_t i=0; i<n; i++)
+        {
+            chunk.ts64[i] = ts_unwrap(&unwrap, chunk.ts[i]);
+        }
+
+        if ( pwrite(out, chunk.chip, n,   hdr.offset[COL_CHIP] + done)   != (ssize_t)n   ||
+             pwrite(out, chunk.chan, n,   hdr.offset[COL_CHAN] + done)   != (ssize_t)n   ||
+             pwrite(out, chunk.td,   2*n, hdr.offset[COL_TD]   + 2*done) != (ssize_t)(2*n) ||
+             pwrite(out, chunk.pd,   2*n, hdr.offset[COL_PD]   + 2*done) != (ssize_t)(2*n) ||
+             pwrite(out, chunk.ts64, 8*n, hdr.offset[COL_TS]   + 8*done) != (ssize_t)(8*n) )
+        {
+            err("failed to write %s\n", colfile);
+            close(in);
+            close(out);
+            return -1;
+        }
+        done += n;
+    }
+    close(in);
+
+    if (done != num_events)
+    {
+        err("%s changed during conversion\n", item->path);
+        close(out);
+        return -1;
+    }
+
+    if (pwrite(out, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+    {
+        err("failed to write %s\n", colfile);
+        close(out);
+        return -1;
+    }
+    close(out);
+
+    seg_add_side(item, colfile);
+    log("%s: %lu events\n", colfile, num_events);
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef _COLUMNAR_H_
+#define _COLUMNAR_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+#include "event.h"
+#include "segpipe.h"
+
+//===========================================================
+// Columnar events.
+//
+// A closed segment, raw or clean, is converted to
+// filename.runno.segno.col in the background: one array per
+// field, each starting on a 4 KB boundary so that any column
+// can be mapped on its own.
+//
+//     header  (64 bytes, host byte order)
+//     chip    uint8   [num_events]
+//     chan    uint8   [num_events]
+//     td      uint16  [num_events]
+//     pd      uint16  [num_events]
+//     ts      uint64  [num_events]   unwrapped timestamps
+//
+// Timestamps are unwrapped across the segments of a frame:
+// each segment continues from the unwrap state data_write_
+// thread had when it opened it, so segments can be converted
+// in any order, or some not at all.
+//===========================================================
+
+#define COL_MAGIC       0x4c4f4347   // "GCOL"
+#define COL_VERSION     1
+#define COL_ALIGN       4096
+
+#define COL_CHIP        0
+#define COL_CHAN        1
+#define COL_TD          2
+#define COL_PD          3
+#define COL_TS          4
+#define NUM_COLS        5
+
+typedef struct
+{
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  frame_num;
+    uint32_t  segment;
+    uint64_t  num_events;
+    uint64_t  offset[NUM_COLS];      // bytes from the start of file
+} col_hdr_t;
+
+int columnar_convert(seg_item_t* item);
+
+#endif
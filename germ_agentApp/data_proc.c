@@ -0,0 +1,623 @@
+/**
+ * File: data_proc.c
+ *
+ * Functionality: Process data on the fly.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Read packets from buffer as the second consumer next to
+ *               data_write_thread;
+ *               Accumulate mca/tdc spectra per frame and save them to
+ *                   filename.runno.spec
+ *               where runno follows the data files;
+ *               Per-channel count rates published at a fixed cadence;
+ *               ROI counters latched at end of frame;
+ *               Calibrated spectra saved to filename.runno.cal when a
+ *               calibration is loaded;
+ *               Time-sliced spectra saved to filename.runno.tslice when
+ *               configured;
+ *               Coincidence histograms saved to filename.runno.coinc when
+ *               configured;
+ *               Pile-up rejected spectra saved to filename.runno.pur, and
+ *               dead/live time published, when configured;
+ *               File names taken from the run configuration snapshot;
+ *               Counters opened when profiling;
+ *               Spectrum publishing and CA puts traced.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include <cadef.h>
+
+#include "germ.h"
+#include "event.h"
+#include "data_proc.h"
+#include "rate_meter.h"
+#include "roi.h"
+#include "calib.h"
+#include "tslice.h"
+#include "coinc.h"
+#include "pileup.h"
+#include "runcfg.h"
+#include "perfctr.h"
+#include "trace.h"
+#include "log.h"
+
+
+extern packet_buff_t packet_buff[NUM_PACKET_BUFF];
+
+extern pv_obj_t pv[NUM_PVS];
+
+extern uint32_t mca[NUM_MCA_ROW * NUM_MCA_COL];
+extern uint32_t tdc[NUM_TDC_ROW * NUM_TDC_COL];
+
+extern float    rate[RATE_NUM_WIN][MAX_NELM];
+extern double   total_rate[RATE_NUM_WIN];
+extern uint32_t roi_counts[MAX_ROI];
+extern uint32_t cal_mca[NUM_CAL_ROW * NUM_CAL_COL + 1];
+extern uint32_t cal_sum[NUM_CAL_COL];
+extern uint32_t tslice_mca[NUM_MCA_COL];
+extern uint32_t tslice_index;
+extern uint32_t coinc_mult[COINC_MAX_MULT];
+extern uint32_t coinc_pairs[NUM_COINC_PAIRS];
+extern uint32_t pur_mca[NUM_MCA_ROW * NUM_MCA_COL];
+extern float    dead_time[MAX_NELM];
+extern float    live_time[MAX_NELM];
+
+extern char  spectrafile[MAX_FILENAME_LEN];
+
+extern atomic_char udp_conn_thread_ready;
+extern atomic_char data_proc_thread_ready;
+
+static rate_meter_t rate_meter;
+static roi_table_t* roi_table = NULL;
+static calib_table_t* calib_table = NULL;
+static tslice_t* tslice = NULL;
+static coinc_t* coinc = NULL;
+static pileup_t* pileup = NULL;
+
+static uint8_t  in_frame = 0;
+static uint64_t frame_start_ms;
+
+
+//========================================================================
+// Monotonic time in milliseconds.
+//========================================================================
+static uint64_t time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+
+//========================================================================
+// Decode the event/timestamp pairs of a packet into a batch.
+//
+// Pairs are validated without branching: every pair is stored and the
+// output index only advances for a valid one, so the loop vectorizes.
+//
+// Returns PKT_SOF and/or PKT_EOF.
+//========================================================================
+static uint8_t decode_packet( packet_buff_t * buff_p,
+                              evt_batch_t   * batch,
+                              uint32_t      * frame_num,
+                              uint32_t      * num_lost_events )
+{
+    uint32_t *packet = (uint32_t*)(buff_p->packet);
+    uint16_t  packet_length = (buff_p->length) >> 2;
+    uint16_t  first = 2;  // skip packet counter and header
+    uint16_t  last  = packet_length;
+    uint8_t   pos   = 0;
+    uint32_t  n     = 0;
+
+    if (packet_length >= 4)
+    {
+        if (ntohl(packet[2]) == SOF_MARKER)
+        {
+            *frame_num = ntohl(packet[3]);
+            first = 4;
+            pos |= PKT_SOF;
+        }
+        if (ntohl(packet[packet_length-1]) == EOF_MARKER)
+        {
+            *num_lost_events = ntohl(packet[packet_length-2]);
+            last -= 2;
+            pos |= PKT_EOF;
+        }
+    }
+
+    for (uint16_t i=first; i+1<last; i+=2)
+    {
+        uint32_t evt  = ntohl(packet[i]);
+        uint32_t ts   = ntohl(packet[i+1]);
+        uint16_t addr = EVT_ADDR(evt);
+
+        batch->addr[n] = addr;
+        batch->td[n]   = EVT_TD(evt);
+        batch->pd[n]   = EVT_PD(evt);
+        batch->ts[n]   = ts & TS_MASK;
+
+        n += (!(evt & TS_FLAG)) & (!!(ts & TS_FLAG)) & (addr < NUM_CHANS);
+    }
+
+    batch->num_events = n;
+    batch->num_bad    = ((last > first) ? (last-first)>>1 : 0) - n;
+
+    return pos;
+}
+
+
+//========================================================================
+// Accumulate the energy and time spectra.
+//========================================================================
+static void fill_spectra(const evt_batch_t* batch)
+{
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        mca[batch->addr[i]*NUM_MCA_COL + batch->pd[i]]++;
+        tdc[batch->addr[i]*NUM_TDC_COL + batch->td[i]]++;
+    }
+}
+
+
+//========================================================================
+// Spectra file name in the format of filename.runno.<ext>
+//========================================================================
+static void create_spectrafile_name(char * spectrafile_p, uint32_t run_num, const char * ext)
+{
+    char              run[32];
+    const run_cfg_t * cfg;
+
+    memset(spectrafile_p, 0, MAX_FILENAME_LEN);
+
+    sprintf(run, ".%010u", run_num);
+
+    cfg = run_cfg_acquire();
+    if ( snprintf( spectrafile_p, MAX_FILENAME_LEN, "%s/%s%s.%s",
+                   cfg->tmp_datafile_dir, cfg->filename, run, ext ) >= MAX_FILENAME_LEN )
+    {
+        warn("spectra file name truncated to %s\n", spectrafile_p);
+    }
+    run_cfg_release();
+}
+
+
+//========================================================================
+// Save mca followed by tdc as raw 32-bit counts.
+//========================================================================
+static int save_spectra(uint32_t run_num)
+{
+    FILE * fp;
+
+    create_spectrafile_name(spectrafile, run_num, "spec");
+
+    fp = fopen(spectrafile, "w");
+    if (NULL == fp)
+    {
+        err("failed to open spectra file %s\n", spectrafile);
+        return -1;
+    }
+
+    fwrite(mca, sizeof(mca[0]), NUM_MCA_ROW*NUM_MCA_COL, fp);
+    fwrite(tdc, sizeof(tdc[0]), NUM_TDC_ROW*NUM_TDC_COL, fp);
+    fclose(fp);
+
+    info("spectra file %s written\n", spectrafile);
+    return 0;
+}
+
+
+//========================================================================
+// Save the summed calibrated spectrum followed by the per-channel ones.
+//========================================================================
+static int save_cal_spectra(uint32_t run_num)
+{
+    FILE * fp;
+    char   calfile[MAX_FILENAME_LEN];
+
+    create_spectrafile_name(calfile, run_num, "cal");
+
+    fp = fopen(calfile, "w");
+    if (NULL == fp)
+    {
+        err("failed to open calibrated spectra file %s\n", calfile);
+        return -1;
+    }
+
+    fwrite(cal_sum, sizeof(cal_sum[0]), NUM_CAL_COL, fp);
+    fwrite(cal_mca, sizeof(cal_mca[0]), NUM_CAL_ROW*NUM_CAL_COL, fp);
+    fclose(fp);
+
+    info("calibrated spectra file %s written\n", calfile);
+    return 0;
+}
+
+
+//========================================================================
+// Save the multiplicity histogram followed by the channel pair matrix.
+//========================================================================
+static int save_coinc(uint32_t run_num)
+{
+    FILE * fp;
+    char   coincfile[MAX_FILENAME_LEN];
+
+    create_spectrafile_name(coincfile, run_num, "coinc");
+
+    fp = fopen(coincfile, "w");
+    if (NULL == fp)
+    {
+        err("failed to open coincidence file %s\n", coincfile);
+        return -1;
+    }
+
+    fwrite(coinc_mult, sizeof(coinc_mult[0]), COINC_MAX_MULT, fp);
+    fwrite(coinc_pairs, sizeof(coinc_pairs[0]), NUM_COINC_PAIRS, fp);
+    fclose(fp);
+
+    info("coincidence file %s written\n", coincfile);
+    return 0;
+}
+
+
+//========================================================================
+// Save the pile-up rejected spectra.
+//========================================================================
+static int save_pur_spectra(uint32_t run_num)
+{
+    FILE * fp;
+    char   purfile[MAX_FILENAME_LEN];
+
+    create_spectrafile_name(purfile, run_num, "pur");
+
+    fp = fopen(purfile, "w");
+    if (NULL == fp)
+    {
+        err("failed to open pile-up rejected spectra file %s\n", purfile);
+        return -1;
+    }
+
+    fwrite(pur_mca, sizeof(pur_mca[0]), NUM_MCA_ROW*NUM_MCA_COL, fp);
+    fclose(fp);
+
+    info("pile-up rejected spectra file %s written\n", purfile);
+    return 0;
+}
+
+
+//========================================================================
+// Queue the dead/live time PVs of the frame so far. The caller flushes.
+//========================================================================
+static void publish_dead_time(void)
+{
+    pileup_estimate(pileup, (time_ms() - frame_start_ms) / 1000.0, dead_time, live_time);
+
+    pvs_put_async(PV_DEAD_TIME, MAX_NELM);
+    pvs_put_async(PV_LIVE_TIME, MAX_NELM);
+}
+
+
+//========================================================================
+// Queue the rate PVs. The caller flushes.
+//========================================================================
+static void publish_rates(void)
+{
+    rate_meter_calc(&rate_meter, rate, total_rate);
+
+    for (int w=0; w<RATE_NUM_WIN; w++)
+    {
+        pvs_put_async(PV_RATE_100MS+w, MAX_NELM);
+        pv_put_async(PV_TOTAL_RATE_100MS+w);
+    }
+}
+
+
+//========================================================================
+// Frame boundary: clear the spectra and take any new configuration, which
+// only ever takes effect between frames.
+//========================================================================
+static void start_frame(uint32_t run_num)
+{
+    roi_table_t   * roi_table_new;
+    calib_table_t * calib_table_new;
+    tslice_cfg_t  * tslice_cfg_new;
+    coinc_cfg_t   * coinc_cfg_new;
+    pileup_cfg_t  * pileup_cfg_new;
+    char            tslicefile[MAX_FILENAME_LEN];
+
+    memset(mca, 0, sizeof(mca));
+    memset(tdc, 0, sizeof(tdc));
+
+    roi_table_new = atomic_exchange(&roi_table_pending, NULL);
+    if (roi_table_new)
+    {
+        roi_table_free(roi_table);
+        roi_table = roi_table_new;
+    }
+    if (roi_table)
+    {
+        roi_table_clear(roi_table);
+    }
+
+    // an empty table turns the calibration off
+    calib_table_new = atomic_exchange(&calib_table_pending, NULL);
+    if (calib_table_new)
+    {
+        free(calib_table);
+        calib_table = calib_table_new;
+        if (0 == calib_table->bin_width)
+        {
+            free(calib_table);
+            calib_table = NULL;
+        }
+    }
+    memset(cal_mca, 0, sizeof(cal_mca));
+
+    // so does a zero slice width
+    tslice_cfg_new = atomic_exchange(&tslice_cfg_pending, NULL);
+    if (tslice_cfg_new)
+    {
+        tslice_free(tslice);
+        tslice = NULL;
+        if (tslice_cfg_new->width)
+        {
+            tslice = tslice_create(tslice_cfg_new, tslice_mca, &tslice_index);
+            if (NULL == tslice)
+            {
+                err("failed to allocate time slices\n");
+            }
+        }
+        free(tslice_cfg_new);
+    }
+    if (tslice)
+    {
+        create_spectrafile_name(tslicefile, run_num, "tslice");
+        tslice_start(tslice, tslicefile, run_num);
+    }
+
+    // and a zero coincidence window
+    coinc_cfg_new = atomic_exchange(&coinc_cfg_pending, NULL);
+    if (coinc_cfg_new)
+    {
+        coinc_free(coinc);
+        coinc = NULL;
+        if (coinc_cfg_new->window)
+        {
+            coinc = coinc_create(coinc_cfg_new, coinc_mult, coinc_pairs);
+            if (NULL == coinc)
+            {
+                err("failed to allocate coincidence wheel\n");
+            }
+        }
+        free(coinc_cfg_new);
+    }
+    if (coinc)
+    {
+        coinc_start(coinc);
+    }
+
+    // and a zero resolving time
+    pileup_cfg_new = atomic_exchange(&pileup_cfg_pending, NULL);
+    if (pileup_cfg_new)
+    {
+        free(pileup);
+        pileup = NULL;
+        if (pileup_cfg_new->resolve)
+        {
+            pileup = pileup_create(pileup_cfg_new, pur_mca);
+            if (NULL == pileup)
+            {
+                err("failed to allocate pile-up state\n");
+            }
+        }
+        free(pileup_cfg_new);
+    }
+    if (pileup)
+    {
+        pileup_start(pileup);
+    }
+
+    in_frame       = 1;
+    frame_start_ms = time_ms();
+}
+
+
+//========================================================================
+// End of frame: save the spectra and queue their PVs.
+//========================================================================
+static void end_frame(uint32_t run_num, uint64_t num_bad)
+{
+    if (0 != num_bad)
+    {
+        warn("%lu invalid event/timestamp pairs in frame %u\n", num_bad, run_num);
+    }
+
+    save_spectra(run_num);
+    pvs_put_async(PV_MCA, NUM_MCA_ROW*NUM_MCA_COL);
+    pvs_put_async(PV_TDC, NUM_TDC_ROW*NUM_TDC_COL);
+    pvs_put_async(PV_SPEC_FILENAME, MAX_FILENAME_LEN);
+
+    if (roi_table)
+    {
+        roi_table_latch(roi_table, roi_counts);
+        pvs_put_async(PV_ROI_COUNTS, MAX_ROI);
+    }
+    if (calib_table)
+    {
+        calib_sum(cal_mca, cal_sum);
+        save_cal_spectra(run_num);
+        pvs_put_async(PV_CAL_MCA, NUM_CAL_ROW*NUM_CAL_COL);
+        pvs_put_async(PV_CAL_SUM, NUM_CAL_COL);
+    }
+    if (tslice)
+    {
+        tslice_finish(tslice);
+    }
+    if (coinc)
+    {
+        coinc_finish(coinc);
+        save_coinc(run_num);
+        pvs_put_async(PV_COINC_MULT, COINC_MAX_MULT);
+        pvs_put_async(PV_COINC_PAIRS, NUM_COINC_PAIRS);
+    }
+    if (pileup)
+    {
+        pileup_finish(pileup);
+        save_pur_spectra(run_num);
+        publish_dead_time();
+        pvs_put_async(PV_PUR_MCA, NUM_MCA_ROW*NUM_MCA_COL);
+    }
+
+    in_frame = 0;
+}
+
+
+//=======================================================
+void* data_proc_thread(void* arg)
+{
+    packet_buff_t * buff_p;
+    unsigned char   read_buff = 0;
+
+    evt_batch_t batch;
+    uint8_t     pos;
+
+    uint32_t frame_num = 0;
+    uint32_t num_lost_events = 0;
+    uint32_t run_num = 0;
+    uint64_t num_bad = 0;
+
+    uint64_t now, next_tick, next_pub;
+    uint64_t tr_t0;
+
+    struct timespec t1, t2;
+
+    t1.tv_sec  = 0;
+    t1.tv_nsec = 100;
+
+    log("########## Initializing data_proc_thread ##########\n");
+
+    SEVCHK( ca_context_create(ca_disable_preemptive_callback),
+            "ca_context_create @data_proc_thread");
+    create_channel(__func__, FIRST_DATA_PROC_PV, LAST_DATA_PROC_PV);
+
+    do
+    {
+        nanosleep(&t1, &t2);
+    } while(0 == atomic_load(&udp_conn_thread_ready));
+
+    rate_meter_init(&rate_meter);
+    now       = time_ms();
+    next_tick = now + RATE_TICK_MS;
+    next_pub  = now + RATE_PUB_PERIOD_MS;
+
+    atomic_store(&data_proc_thread_ready, 1);
+
+    info("ready to process data...\n");
+
+    perf_thread_init(__func__);
+    trace_thread_init(__func__);
+
+    while(1)
+    {
+        if (trylock_buff_read(read_buff, DATA_PROCCED, __func__))
+        {
+            buff_p = &(packet_buff[read_buff]);
+
+            // decode while locked, process after release
+            pos = decode_packet(buff_p, &batch, &frame_num, &num_lost_events);
+
+            buff_p->status |= DATA_PROCCED;
+            unlock_buff(read_buff, __func__);
+
+            read_buff++;
+            read_buff &= PACKET_BUFF_MASK;
+
+            if (pos & PKT_SOF)
+            {
+                run_num = frame_num;
+                num_bad = 0;
+                start_frame(run_num);
+            }
+
+            fill_spectra(&batch);
+            rate_meter_count(&rate_meter, &batch);
+            if (roi_table)
+            {
+                roi_table_count(roi_table, &batch);
+            }
+            if (calib_table)
+            {
+                calib_fill(calib_table, &batch, cal_mca);
+            }
+            if (tslice)
+            {
+                tslice_fill(tslice, &batch);
+            }
+            if (coinc)
+            {
+                coinc_fill(coinc, &batch);
+            }
+            if (pileup)
+            {
+                pileup_fill(pileup, &batch);
+            }
+            num_bad += batch.num_bad;
+
+            if (pos & PKT_EOF)
+            {
+                tr_t0 = trace_begin();
+                end_frame(run_num, num_bad);
+                ca_flush_io();
+                trace_end(TR_SPECTRA, tr_t0);
+            }
+        }
+        else
+        {
+            nanosleep(&t1, &t2);
+        }
+
+        //-------------------------------------------------
+        // Fixed cadence, whether or not data is coming.
+        now = time_ms();
+        while (now >= next_tick)
+        {
+            rate_meter_tick(&rate_meter);
+            next_tick += RATE_TICK_MS;
+        }
+
+        if (now >= next_pub)
+        {
+            tr_t0 = trace_begin();
+            publish_rates();
+            if (pileup && in_frame)
+            {
+                publish_dead_time();
+            }
+            if (tslice && tslice->stream_new)
+            {
+                pvs_put_async(PV_TSLICE_MCA, NUM_MCA_COL);
+                pv_put_async(PV_TSLICE_INDEX);
+                tslice->stream_new = 0;
+            }
+            ca_flush_io();
+            trace_end(TR_CA_PUT, tr_t0);
+            next_pub += RATE_PUB_PERIOD_MS;
+            if (next_pub <= now)
+            {
+                next_pub = now + RATE_PUB_PERIOD_MS;
+            }
+        }
+    }
+
+    return NULL;
+}
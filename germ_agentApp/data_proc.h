@@ -0,0 +1,7 @@
+#ifndef _DATA_PROC_H_
+#define _DATA_PROC_H_
+
+
+void* data_proc_thread(void* arg);
+
+#endif
@@ -7,6 +7,39 @@
  * 
  * Revisions:
  *
+ *   v1.2
+ *     - Date  : Oct 2026
+ *     - Brief : Cooked output: events dropped by the filter in
+ *               FILTER_CFG_FILE before writing, with per-channel counts;
+ *               Clean output: event/timestamp pairs only, to
+ *                   filename.runno.segno.evt
+ *               as selected in OUTPUT_CFG_FILE;
+ *               Closed segments posted to the segment pipeline, with
+ *               their index when wanted;
+ *               Segments written by the striped writers, across the
+ *               target directories when set, with a run manifest;
+ *               Next segment opened ahead by a helper thread, with the
+ *               rollover latency per frame;
+ *               Run parameters taken from a run configuration snapshot
+ *               once per frame instead of locked globals;
+ *               Packets broadcast to local readers, and forwarded to
+ *               another node, when wanted;
+ *               Flight recorder triggered by packet counter gaps, lost
+ *               frames or events, and Start/End of Frame mismatches;
+ *               Receive latency and inter-packet gap histograms per
+ *               frame, from kernel receive timestamps;
+ *               Frame statistics kept in a history ring for exp_mon_thread
+ *               to publish;
+ *               Hardware counters of the pipeline threads reported per
+ *               frame when profiling;
+ *               Timestamps unwrapped once per packet, so each segment
+ *               is posted with where its frame's timestamps stand;
+ *               Buffer waits, writes, segment rollovers and CA puts
+ *               traced;
+ *               Pipelined segments noted in the run manifest by the
+ *               pipeline, where they end up;
+ *               No segments written to a directory being replayed from.
+ *
  *   v1.1
  *     - By    : Ji Li
  *     - Date  : Sep 2023
@@ -43,11 +76,27 @@
 #include <sys/time.h>
 #include <time.h>
 #include <stdatomic.h>
+#include <sys/stat.h>
 
 #include <cadef.h>
 
 #include "germ.h"
 #include "data_write.h"
+#include "filter.h"
+#include "output.h"
+#include "clean.h"
+#include "segpipe.h"
+#include "stripe.h"
+#include "preopen.h"
+#include "runcfg.h"
+#include "replay.h"
+#include "bcast.h"
+#include "forward.h"
+#include "flightrec.h"
+#include "rxtime.h"
+#include "framestats.h"
+#include "perfctr.h"
+#include "trace.h"
 #include "log.h"
 
 
@@ -55,37 +104,43 @@ extern packet_buff_t packet_buff[NUM_PACKET_BUFF];
     
 extern pv_obj_t pv[NUM_PVS];
 
-extern char  filename[MAX_FILENAME_LEN];
-extern char  tmp_datafile_dir[MAX_FILENAME_LEN];
-extern pthread_mutex_t tmp_datafile_dir_lock;
-extern pthread_mutex_t datafile_dir_lock;
-extern pthread_mutex_t filename_lock;
-
-extern atomic_ulong runno;
-extern atomic_uint  filesize;  // in Megabyte
+extern uint32_t filter_dropped[MAX_NELM];
+extern float    rollover_max;
+extern float    rollover_mean;
+extern uint32_t rx_latency_hist[RX_HIST_BINS];
+extern uint32_t rx_gap_hist[RX_HIST_BINS];
 
 extern atomic_char udp_conn_thread_ready;
 extern atomic_char data_write_thread_ready;
 
-void create_datafile_name(char * datafile, uint32_t run_num, uint32_t file_segment)
+//========================================================================
+// Data file name in 'dir', or in the temporary data directory of 'cfg'
+// if 'dir' is NULL.
+//========================================================================
+void create_datafile_name( char            * datafile,
+                           const run_cfg_t * cfg,
+                           const char      * dir,
+                           uint32_t          run_num,
+                           uint32_t          file_segment,
+                           const char      * ext )
 {
     char run[32];
     char file_seg[32];
-    char tmp_datafile_dir_val[MAX_FILENAME_LEN];
-    char filename_val[MAX_FILENAME_LEN];
 
     memset(datafile, 0, MAX_FILENAME_LEN);
     
-    read_protected_string(tmp_datafile_dir, tmp_datafile_dir_val, MAX_FILENAME_LEN, &tmp_datafile_dir_lock);
-    printf("Temp Dir = %s, located at %p\n", tmp_datafile_dir_val, (void*)tmp_datafile_dir);
+    if (NULL == dir)
+    {
+        printf("Temp Dir = %s\n", cfg->tmp_datafile_dir);
+        dir = cfg->tmp_datafile_dir;
+    }
 
-    // directory from PV
-    strcpy(datafile, tmp_datafile_dir_val);
+    // directory from PV, or stripe target
+    strcpy(datafile, dir);
     strcat(datafile, "/");
 
     // filename from PV
-    read_protected_string(filename, filename_val, MAX_FILENAME_LEN, &filename_lock);
-    strcat(datafile, filename_val);
+    strcat(datafile, cfg->filename);
     
     // run number
     sprintf(run, ".%010u", run_num);
@@ -95,7 +150,7 @@ void create_datafile_name(char * datafile, uint32_t run_num, uint32_t file_segme
     sprintf(file_seg, ".%010u", file_segment);
     strcat(datafile, file_seg);
     
-    strcat(datafile, ".bin");
+    strcat(datafile, ext);
 
     printf("Data file name is %s\n", datafile);
 
@@ -103,14 +158,225 @@ void create_datafile_name(char * datafile, uint32_t run_num, uint32_t file_segme
 }
 
 
+//========================================================================
+// Run manifest name, filename.runno.manifest in the temporary directory.
+//========================================================================
+static void create_manifest_name(char * manifest, const run_cfg_t * cfg, uint32_t run_num)
+{
+    if ( snprintf( manifest, MAX_FILENAME_LEN, "%s/%s.%010u.manifest",
+                   cfg->tmp_datafile_dir, cfg->filename, run_num ) >= MAX_FILENAME_LEN )
+    {
+        warn("manifest name truncated to %s\n", manifest);
+    }
+}
+
+
+//========================================================================
+// Open a data file segment, on the stripe target of its number. A clean
+// segment starts with a blank header, completed by close_segment().
+// 'base' is where data starts in the file.
+//
+// The segment prepared by the pre-opener is taken if it is the one, and
+// the one after is asked for. Nothing is written to a directory being
+// replayed from.
+//========================================================================
+static stripe_seg_t* open_segment( char               * datafile,
+                                   const run_cfg_t    * run,
+                                   uint32_t             run_num,
+                                   uint32_t             file_segment,
+                                   const output_cfg_t * output,
+                                   clean_hdr_t        * hdr,
+                                   seg_index_t       ** index,
+                                   uint64_t           * base )
+{
+    stripe_seg_t * seg;
+    struct stat    st;
+    uint32_t       target = 0;
+    const char   * dir    = NULL;
+
+    if (output->num_stripes)
+    {
+        target = file_segment % output->num_stripes;
+        dir    = output->stripe[target];
+    }
+
+    if (replay_reads_from(dir ? dir : run->tmp_datafile_dir))
+    {
+        err( "segment %u not written, %s is being replayed from\n",
+             file_segment, dir ? dir : run->tmp_datafile_dir );
+        return NULL;
+    }
+
+    seg = preopen_take(run_num, file_segment, output, run, datafile, base);
+    if (seg)
+    {
+        if (OUTPUT_CLEAN == output->format)
+        {
+            clean_hdr_init(hdr, run_num, file_segment);
+            stripe_write(seg, hdr, sizeof(clean_hdr_t));
+        }
+    }
+    else if (OUTPUT_CLEAN == output->format)
+    {
+        create_datafile_name(datafile, run, dir, run_num, file_segment, ".evt");
+        seg = stripe_open(datafile, file_segment, target, 0);
+        if (seg)
+        {
+            clean_hdr_init(hdr, run_num, file_segment);
+            stripe_write(seg, hdr, sizeof(clean_hdr_t));
+        }
+        *base = sizeof(clean_hdr_t);
+    }
+    else
+    {
+        create_datafile_name(datafile, run, dir, run_num, file_segment, ".bin");
+        seg = stripe_open(datafile, file_segment, target, 1);
+        *base = (0 == stat(datafile, &st)) ? st.st_size : 0;
+    }
+
+    if (NULL == seg)
+    {
+        return NULL;
+    }
+    preopen_request(run_num, file_segment + 1, output);
+
+    seg_index_free(*index);
+    *index = NULL;
+    if (output->stages & SEG_INDEX)
+    {
+        *index = seg_index_create(run_num, file_segment);
+    }
+
+    return seg;
+}
+
+
+//========================================================================
+// Called by the writer once a segment is on disk: on to the segment
+// pipeline, which notes it in the run manifest when done with it.
+//========================================================================
+static void segment_done(void* arg, int status)
+{
+    seg_item_t * item = (seg_item_t*)arg;
+
+    if (NULL == item)
+    {
+        return;
+    }
+    if (0 != status)
+    {
+        err("%s not written, left out of the segment pipeline\n", item->path);
+        stripe_manifest_add(item->manifest, item->segment, item->eof, 1, 0, item->path);
+        seg_item_free(item);
+        return;
+    }
+    seg_pipe_post(item);
+}
+
+
+//========================================================================
+// First event timestamp of a packet, or -1 if it has none.
+//========================================================================
+static int64_t packet_first_ts(const uint32_t* packet, uint32_t packet_length)
+{
+    uint32_t evt, ts;
+
+    for (uint32_t i=2; i+1<packet_length; i+=2)
+    {
+        evt = ntohl(packet[i]);
+        ts  = ntohl(packet[i+1]);
+        if (!(evt & TS_FLAG) && (ts & TS_FLAG) && ts != EOF_MARKER)
+        {
+            return ts & TS_MASK;
+        }
+    }
+    return -1;
+}
+
+
+//========================================================================
+// Close a data file segment. Once written, it goes to the segment
+// pipeline if any stage is wanted, with the frame's timestamp unwrap
+// state from when it was opened, and to the run manifest when striped:
+// by the writer, or by the pipeline once it is done with the segment.
+//========================================================================
+static void close_segment( stripe_seg_t       * seg,
+                           const char         * datafile,
+                           const run_cfg_t    * run,
+                           uint32_t             run_num,
+                           uint32_t             file_segment,
+                           uint8_t              eof,
+                           const output_cfg_t * output,
+                           const clean_hdr_t  * hdr,
+                           seg_index_t       ** index,
+                           const ts_unwrap_t  * unwrap )
+{
+    seg_item_t * item = NULL;
+    char         manifest[MAX_FILENAME_LEN];
+
+    if (output->stages)
+    {
+        item = calloc(1, sizeof(seg_item_t));
+        if (NULL == item)
+        {
+            err("no memory to post %s\n", datafile);
+        }
+    }
+    if (item)
+    {
+        snprintf(item->path, MAX_FILENAME_LEN, "%s", datafile);
+        item->run_num = run_num;
+        item->segment = file_segment;
+        item->format  = output->format;
+        item->eof     = eof;
+        item->stages  = output->stages;
+        item->index   = *index;
+        item->unwrap  = *unwrap;
+    }
+    else
+    {
+        seg_index_free(*index);
+    }
+    *index = NULL;
+
+    if (output->num_stripes)
+    {
+        create_manifest_name(manifest, run, run_num);
+        if (item)
+        {
+            snprintf(item->manifest, MAX_FILENAME_LEN, "%s", manifest);
+        }
+    }
+
+    stripe_close( seg,
+                  (OUTPUT_CLEAN == output->format) ? hdr : NULL,
+                  (OUTPUT_CLEAN == output->format) ? sizeof(clean_hdr_t) : 0,
+                  (output->num_stripes && NULL == item) ? manifest : NULL,
+                  eof,
+                  segment_done,
+                  item );
+}
+
+
+//========================================================================
+static double usec_since(const struct timespec* t0)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - t0->tv_sec) * 1e6 + (t.tv_nsec - t0->tv_nsec) * 1e-3;
+}
+
+
 //=======================================================     
 void* data_write_thread(void* arg)
 {
     packet_buff_t * buff_p;
     unsigned char read_buff = 0;
 
-    FILE * fp = NULL;
+    stripe_seg_t * seg = NULL;
     char   datafile[MAX_FILENAME_LEN];
+    run_cfg_t run;      // snapshot the frame is written with
 
     uint32_t  file_segment = 0;
     uint64_t file_written = 0;
@@ -123,10 +389,11 @@ void* data_write_thread(void* arg)
     uint8_t  first_run = 1;  // a flag indicating receipient of first frame with any frame_num
 
     uint32_t num_packets;
-    uint16_t num_events;
+    uint32_t num_events;
     uint16_t num_lost_events;
     uint16_t packet_length;
     uint32_t packet_counter;
+    uint32_t last_counter = 0;
     uint16_t payload_length;
     uint32_t first_packetnum = 0;
     uint32_t frame_num = 0;
@@ -135,6 +402,45 @@ void* data_write_thread(void* arg)
 
     uint32_t *packet;
 
+    filter_table_t * filter = NULL;
+    filter_table_t * filter_new;
+    uint32_t         dropped[1 << ADDR_WIDTH];  // any address the filter sees
+    uint32_t         cooked[MAX_PACKET_LENGTH >> 2];
+    uint32_t       * out;
+    uint16_t         out_length;
+    uint64_t         num_dropped;
+
+    output_cfg_t   * output_new;
+    output_cfg_t     output = { .format = OUTPUT_RAW, .stages = 0 };
+    uint8_t          sof_packet;
+    clean_hdr_t      hdr;
+    seg_index_t    * index = NULL;
+    uint64_t         seg_base = 0;
+    uint32_t         clean[MAX_PACKET_LENGTH >> 2];
+
+    struct timespec  ro_start;          // segment rollover latency
+    double           ro_usec;
+    double           ro_max = 0;
+    double           ro_sum = 0;
+    uint32_t         num_rollovers = 0;
+    preopen_stats_t  preopen_stats;
+
+    bcast_t        * bcast = NULL;
+    forwarder_t    * fwd = NULL;
+    fwd_stats_t      fwd_stats;
+
+    rx_hist_t        rx_latency;        // per frame, see rxtime.h
+    rx_hist_t        rx_gap;
+    uint64_t         last_rx_ns = 0;
+
+    fs_rec_t         fs_rec;
+
+    ts_unwrap_t      frame_unwrap = { 0, 0 };   // one timestamp per packet
+    ts_unwrap_t      seg_unwrap = { 0, 0 };     // as the segment was opened
+    int64_t          first_ts;
+
+    uint64_t         tr_wait, tr_write, tr_ro, tr_put;  // span starts, see trace.h
+
     struct timespec t1, t2;
 
     struct timeval tv_begin, tv_end;
@@ -153,10 +459,31 @@ void* data_write_thread(void* arg)
         nanosleep(&t1, &t2);
     } while(0 == atomic_load(&udp_conn_thread_ready));
 
+    if (0 != stripe_init(0))
+    {
+        err("segment writers not fully started\n");
+    }
+
+    if (0 != preopen_init())
+    {
+        err("segments will not be opened ahead\n");
+    }
+
+    if (0 != seg_pipe_init())
+    {
+        err("segment pipeline not fully started\n");
+    }
+
     atomic_store(&data_write_thread_ready, 1);
 
     info("ready to read data...\n");
 
+    rx_hist_clear(&rx_latency);
+    rx_hist_clear(&rx_gap);
+
+    perf_thread_init(__func__);
+    trace_thread_init(__func__);
+
     while(1)
     {
         frame_size      = 0;
@@ -171,7 +498,10 @@ void* data_write_thread(void* arg)
         {
             buff_p = &(packet_buff[read_buff]);
             log("lock buff[%d] for read\n", read_buff);
+            tr_wait = trace_begin();
             lock_buff_read(read_buff, DATA_WRITTEN, __func__);
+            trace_end(TR_RING_WAIT, tr_wait);
+            tr_write = trace_begin();
 
             log("%d bytes in buff[%d]\n", buff_p->length, read_buff);
             packet_length = (buff_p->length) >> 2;  // process data as 4-byte words
@@ -183,8 +513,15 @@ void* data_write_thread(void* arg)
 
             //-------------------------------------------------
             // check if it's the 1st or last packet of a frame
-            if (ntohl(packet[2]) == SOF_MARKER) // first packet
+            sof_packet = (ntohl(packet[2]) == SOF_MARKER);
+            if (sof_packet) // first packet
             {
+                if (start_of_frame)
+                {
+                    err("missed End of Frame %u\n", frame_num);
+                    flightrec_trigger(FR_TRIG_FRAME, "missed End of Frame %u", frame_num);
+                }
+
                 gettimeofday(&tv_begin, NULL);
                 first_packetnum = packet_counter;
                 frame_num = ntohl(packet[3]);
@@ -197,12 +534,68 @@ void* data_write_thread(void* arg)
                 start_of_frame = 1;
                 payload_length = packet_length - 4;
                 info("got Start of Frame\n");
+
+                // filter changes take effect at frame boundaries only,
+                // and a disabled table means raw output
+                filter_new = atomic_exchange(&filter_table_pending, NULL);
+                if (filter_new)
+                {
+                    free(filter);
+                    filter = filter_new;
+                    if (!filter->enabled)
+                    {
+                        free(filter);
+                        filter = NULL;
+                    }
+                }
+                memset(dropped, 0, sizeof(dropped));
+
+                ro_max        = 0;
+                ro_sum        = 0;
+                num_rollovers = 0;
+
+                rx_hist_clear(&rx_latency);
+                rx_hist_clear(&rx_gap);
+                memset(&frame_unwrap, 0, sizeof(frame_unwrap));
+
+                // so do output options
+                output_new = atomic_exchange(&output_cfg_pending, NULL);
+                if (output_new)
+                {
+                    if (strcmp(output.broadcast, output_new->broadcast))
+                    {
+                        bcast_close(bcast);
+                        bcast = output_new->broadcast[0] ? bcast_open(output_new->broadcast) : NULL;
+                    }
+                    if ( strcmp(output.forward, output_new->forward)
+                         || output.forward_buffer != output_new->forward_buffer
+                         || output.forward_zerocopy != output_new->forward_zerocopy )
+                    {
+                        forward_close(fwd);
+                        fwd = output_new->forward[0] ? forward_open( output_new->forward,
+                                                                     output_new->forward_buffer,
+                                                                     output_new->forward_zerocopy )
+                                                     : NULL;
+                    }
+                    if (0 != stripe_start(output_new->num_stripes))
+                    {
+                        err("not every stripe target has a writer of its own\n");
+                    }
+                    output = *output_new;
+                    free(output_new);
+                }
             }
             else
             {
                 if(0 == start_of_frame)
                 {
                     err("missed Start of Frame\n");
+                    flightrec_trigger(FR_TRIG_FRAME, "missed Start of Frame after frame %u", frame_num);
+                }
+                else if (packet_counter != last_counter + 1)
+                {
+                    flightrec_trigger( FR_TRIG_GAP, "packet %u after %u in frame %u",
+                                       packet_counter, last_counter, frame_num );
                 }
 
                 if ( ntohl(packet[packet_length-1]) == EOF_MARKER ) // last packet
@@ -218,6 +611,39 @@ void* data_write_thread(void* arg)
                 }
                 run_num = buff_p->runno;
             }
+            last_counter = packet_counter;
+
+            rx_hist_add(&rx_latency, buff_p->rx_latency);
+            if (!sof_packet && buff_p->rx_ns >= last_rx_ns)
+            {
+                rx_hist_add(&rx_gap, buff_p->rx_ns - last_rx_ns);
+            }
+            last_rx_ns = buff_p->rx_ns;
+
+            // often enough to keep track of the timestamp wraps
+            first_ts = packet_first_ts(packet, packet_length);
+            if (first_ts >= 0)
+            {
+                ts_unwrap(&frame_unwrap, first_ts);
+            }
+
+            if (bcast)
+            {
+                bcast_publish( bcast,
+                               packet,
+                               buff_p->length,
+                               run_num,
+                               (sof_packet ? BCAST_PKT_SOF : 0) | (end_of_frame ? BCAST_PKT_EOF : 0) );
+            }
+
+            if (fwd)
+            {
+                forward_packet( fwd,
+                                packet,
+                                buff_p->length,
+                                run_num,
+                                (sof_packet ? FWD_PKT_SOF : 0) | (end_of_frame ? FWD_PKT_EOF : 0) );
+            }
 
             //-------------------------------------------------
             // write data to file
@@ -226,27 +652,78 @@ void* data_write_thread(void* arg)
             // file size limit has been reached.
             
             // open file if it was unsuccessful for the previous packet
-            if(!fp) 
+            if(!seg) 
             {
-                create_datafile_name(datafile, run_num, file_segment);
-                fp = fopen(datafile, "a");
+                run_cfg_copy(&run);
+                clock_gettime(CLOCK_MONOTONIC, &ro_start);
+                tr_ro = trace_begin();
+                seg = open_segment(datafile, &run, run_num, file_segment, &output, &hdr, &index, &seg_base);
+                trace_end(TR_ROLLOVER, tr_ro);
+                seg_unwrap = frame_unwrap;
+                ro_usec = usec_since(&ro_start);
+                ro_max  = (ro_usec > ro_max) ? ro_usec : ro_max;
+                ro_sum += ro_usec;
+                num_rollovers++;
             }
             
-            if(fp)
+            if (filter)
             {
-                fwrite(packet, packet_length << 2, 1, fp);
-                file_written += packet_length << 2;
+                out_length = filter_packet(filter, packet, packet_length, cooked, dropped);
+                out        = cooked;
+            }
+            else
+            {
+                out_length = packet_length;
+                out        = packet;
+            }
 
-                uint16_t filesize_val = atomic_load_explicit(&filesize, memory_order_relaxed);
+            if (OUTPUT_CLEAN == output.format)
+            {
+                out_length = clean_packet(out, out_length, clean, &hdr.num_bad);
+                out        = clean;
 
-                if (((file_written+1008)>>20) > filesize_val)
+                if (0 == hdr.num_packets)
+                {
+                    hdr.first_packet = packet_counter;
+                }
+                hdr.last_packet  = packet_counter;
+                hdr.num_packets++;
+                hdr.num_events  += out_length >> 1;
+                if (sof_packet)
+                {
+                    hdr.flags |= CLEAN_FLAG_SOF;
+                }
+                if (end_of_frame)
                 {
-                    fclose(fp);
+                    hdr.flags   |= CLEAN_FLAG_EOF;
+                    hdr.num_lost = num_lost_events;
+                }
+            }
+
+            if(seg)
+            {
+                if (index)
+                {
+                    seg_index_packet(index, seg_base + file_written, packet, packet_length);
+                }
+                stripe_write(seg, out, out_length << 2);
+                file_written += out_length << 2;
+
+                if (((file_written+1008)>>20) > run.filesize)
+                {
+                    clock_gettime(CLOCK_MONOTONIC, &ro_start);
+                    tr_ro = trace_begin();
+                    close_segment(seg, datafile, &run, run_num, file_segment, 0, &output, &hdr, &index, &seg_unwrap);
                     info("last data file is %s\n", datafile);
                     file_segment++;
                     file_written = 0;
-                    create_datafile_name(datafile, run_num, file_segment);
-                    fp = fopen(datafile, "a");
+                    seg = open_segment(datafile, &run, run_num, file_segment, &output, &hdr, &index, &seg_base);
+                    trace_end(TR_ROLLOVER, tr_ro);
+                    seg_unwrap = frame_unwrap;
+                    ro_usec = usec_since(&ro_start);
+                    ro_max  = (ro_usec > ro_max) ? ro_usec : ro_max;
+                    ro_sum += ro_usec;
+                    num_rollovers++;
                 }
             }
             else
@@ -259,6 +736,7 @@ void* data_write_thread(void* arg)
             buff_p->status |= DATA_WRITTEN;
             unlock_buff(read_buff, __func__);
             log("buff[%d] unlocked\n", read_buff);
+            trace_end(TR_WRITE, tr_write);
 
             //-------------------------------------------------
             // move to next buffer
@@ -271,24 +749,83 @@ void* data_write_thread(void* arg)
             }
         } // loop until a frame has been received
 
-        if(fp)
+        if(seg)
         {
-            fclose(fp);
+            tr_ro = trace_begin();
+            close_segment(seg, datafile, &run, run_num, file_segment, 1, &output, &hdr, &index, &seg_unwrap);
+            trace_end(TR_ROLLOVER, tr_ro);
+            tr_put = trace_begin();
             pv_put(PV_DATA_FILENAME);
-            fp = NULL;
-            gettimeofday(&tv_end, NULL);
+            trace_end(TR_CA_PUT, tr_put);
+            seg = NULL;
             log("datafile (new run) written\n"); 
             printf("datafile %s written\n", datafile); 
 
             file_segment = 0;
             file_written = 0;
+            tr_put = trace_begin();
             pv_put(PV_DATA_FILENAME);
+            trace_end(TR_CA_PUT, tr_put);
         }
+
+        gettimeofday(&tv_end, NULL);
+
+        // segment 0 of the next frame, most likely
+        preopen_request(frame_num + 1, 0, &output);
+
+        rollover_max  = ro_max;
+        rollover_mean = num_rollovers ? ro_sum / num_rollovers : 0;
+        preopen_get_stats(&preopen_stats);
+        info( "%u segment opens, %.1f us mean, %.1f us max (%lu opened ahead, %lu not)\n",
+              num_rollovers, rollover_mean, rollover_max,
+              preopen_stats.num_taken, preopen_stats.num_missed );
+        pv_put_async(PV_ROLLOVER_MAX);
+        pv_put_async(PV_ROLLOVER_MEAN);
+
+        info( "receive latency %.1f/%.1f/%.1f us, gaps %.1f/%.1f/%.1f us (median/99%%/max)\n",
+              rx_hist_quantile(&rx_latency, 0.5) * 1e-3,
+              rx_hist_quantile(&rx_latency, 0.99) * 1e-3,
+              rx_latency.max * 1e-3,
+              rx_hist_quantile(&rx_gap, 0.5) * 1e-3,
+              rx_hist_quantile(&rx_gap, 0.99) * 1e-3,
+              rx_gap.max * 1e-3 );
+        perf_report(num_packets);
+        memcpy(rx_latency_hist, rx_latency.bins, sizeof(rx_latency_hist));
+        memcpy(rx_gap_hist, rx_gap.bins, sizeof(rx_gap_hist));
+        tr_put = trace_begin();
+        pvs_put_async(PV_RX_LATENCY, RX_HIST_BINS);
+        pvs_put_async(PV_RX_GAP, RX_HIST_BINS);
+        ca_flush_io();
+        trace_end(TR_CA_PUT, tr_put);
+        if (fwd)
+        {
+            forward_get_stats(fwd, &fwd_stats);
+            info( "forwarded %lu packets (%.1f MB), %lu dropped, %lu lost, %lu waiting\n",
+                  fwd_stats.num_sent, fwd_stats.bytes_sent * 1e-6,
+                  fwd_stats.num_dropped, fwd_stats.num_lost, fwd_stats.lag );
+        }
+        if (filter)
+        {
+            num_dropped = 0;
+            for (int i=0; i<MAX_NELM; i++)
+            {
+                filter_dropped[i] = dropped[i];
+                num_dropped      += dropped[i];
+            }
+            info("%lu events dropped by the filter\n", num_dropped);
+            tr_put = trace_begin();
+            pvs_put_async(PV_FILTER_DROPPED, MAX_NELM);
+            ca_flush_io();
+            trace_end(TR_CA_PUT, tr_put);
+        }
+
         if(first_run == 0)
         {
             if ((frame_num-last_frame_num) != 1)
             {
                 err("%u frames lost\n", frame_num-last_frame_num-1);
+                flightrec_trigger( FR_TRIG_GAP, "%u frames lost before frame %u",
+                                   frame_num-last_frame_num-1, frame_num );
             }
         }
         else
@@ -306,6 +843,8 @@ void* data_write_thread(void* arg)
         if (packet_counter != num_packets )
         {
             err("    missed %u packets\n", packet_counter - num_packets);
+            flightrec_trigger( FR_TRIG_GAP, "missed %u packets in frame %u",
+                               packet_counter - num_packets, frame_num );
         }
         else
         {
@@ -315,11 +854,23 @@ void* data_write_thread(void* arg)
         if (0!= num_lost_events)
         {
             err("    %u events lost due to UDP Tx FIFO overflow.\n", num_lost_events);
+            flightrec_trigger( FR_TRIG_LOST, "%u events lost in frame %u",
+                               num_lost_events, frame_num );
         }
         else
         {
             log("    no overflow detected in UDP Tx FIFO\n");
         }
+
+        fs_rec.run_num        = run_num;
+        fs_rec.frame_num      = frame_num;
+        fs_rec.num_packets    = num_packets;
+        fs_rec.num_events     = num_events;
+        fs_rec.num_bytes      = frame_size;
+        fs_rec.elapsed        = time_elapsed(tv_begin, tv_end) / 1e6;
+        fs_rec.missed_packets = (packet_counter > num_packets) ? packet_counter - num_packets : 0;
+        fs_rec.lost_events    = num_lost_events;
+        framestats_add(&fs_rec);
    
     }
     
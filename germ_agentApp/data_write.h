@@ -1,7 +1,16 @@
 #ifndef _DATA_WRITE_H_
 #define _DATA_WRITE_H_
 
+#include <stdint.h>
+
+#include "runcfg.h"
 
 void* data_write_thread(void* arg);
+void  create_datafile_name( char            * datafile,
+                            const run_cfg_t * cfg,
+                            const char      * dir,
+                            uint32_t          run_num,
+                            uint32_t          file_segment,
+                            const char      * ext );
 
 #endif
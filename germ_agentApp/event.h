@@ -0,0 +1,104 @@
+#ifndef _EVENT_H_
+#define _EVENT_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+
+//===========================================================
+// Event format
+//
+// A packet carries 8-byte values in network byte order:
+//
+//   Packet counter | PKT_CNTR     | 0x00000000
+//   SOF            | 0xFEEDFACE   | FRAM_NUM     (1st packet of a frame)
+//   Event          | EVENT_DATA   | TIMESTAMP    (EVENT_DATA  <= 0x7FFFFFFF,
+//                                                 TIMESTAMP   >= 0x80000000)
+//   EOF            | NUM_LOST_EVT | 0xDECAFBAD   (last packet of a frame)
+//===========================================================
+
+#define NUM_CHIPS            12
+#define NUM_CHIP_CHANS       32
+#define NUM_CHANS            (NUM_CHIPS * NUM_CHIP_CHANS)
+
+#define CHIP_START_BIT       27
+#define CHIP_WIDTH            4
+#define CHAN_START_BIT       22
+#define CHAN_WIDTH            5
+#define ADDR_START_BIT       CHAN_START_BIT
+#define ADDR_WIDTH           (CHIP_WIDTH + CHAN_WIDTH)
+#define TD_START_BIT         12
+#define TD_WIDTH             10
+#define PD_START_BIT          0
+#define PD_WIDTH             12
+
+#define FIELD_MASK(w)        ((1u << (w)) - 1)
+
+#define EVT_CHIP(e)          (((e) >> CHIP_START_BIT) & FIELD_MASK(CHIP_WIDTH))
+#define EVT_CHAN(e)          (((e) >> CHAN_START_BIT) & FIELD_MASK(CHAN_WIDTH))
+#define EVT_TD(e)            (((e) >> TD_START_BIT)   & FIELD_MASK(TD_WIDTH))
+#define EVT_PD(e)            (((e) >> PD_START_BIT)   & FIELD_MASK(PD_WIDTH))
+// chip*32+chan, i.e. the row in mca/tdc
+#define EVT_ADDR(e)          (((e) >> ADDR_START_BIT) & FIELD_MASK(ADDR_WIDTH))
+
+#define TS_FLAG              0x80000000
+#define TS_MASK              0x7fffffff
+
+// 8 bytes per event, less the packet counter/header
+#define MAX_EVT_PER_PACKET   (MAX_PACKET_LENGTH >> 3)
+
+// Packet position within a frame, returned by the packet decoder.
+#define PKT_SOF              0x01
+#define PKT_EOF              0x02
+
+//===========================================================
+// Decoded events of one packet, stored as arrays so that
+// processing stages can run as plain loops over them.
+//===========================================================
+typedef struct
+{
+    uint32_t  num_events;
+    uint32_t  num_bad;      // pairs rejected by the decoder
+    uint16_t  addr[MAX_EVT_PER_PACKET];
+    uint16_t  td[MAX_EVT_PER_PACKET];
+    uint16_t  pd[MAX_EVT_PER_PACKET];
+    uint32_t  ts[MAX_EVT_PER_PACKET];
+} evt_batch_t;
+
+//===========================================================
+// Timestamps are a 31-bit counter. Unwrap them to 64 bits,
+// tolerating events that arrive slightly out of order.
+//===========================================================
+typedef struct
+{
+    uint8_t   started;
+    uint64_t  last;     // latest unwrapped timestamp
+} ts_unwrap_t;
+
+static inline uint64_t ts_unwrap(ts_unwrap_t* u, uint32_t ts)
+{
+    int32_t  delta;
+    uint64_t ext;
+
+    if (!u->started)
+    {
+        u->started = 1;
+        u->last    = ts;
+        return ts;
+    }
+
+    // signed distance to the latest timestamp, modulo 2^31
+    delta = (int32_t)((ts - (uint32_t)u->last) << 1) >> 1;
+    if (delta < 0 && (uint64_t)(-(int64_t)delta) > u->last)
+    {
+        return 0;  // before the very first timestamp
+    }
+    ext   = u->last + delta;
+    if (delta > 0)
+    {
+        u->last = ext;
+    }
+    return ext;
+}
+
+#endif
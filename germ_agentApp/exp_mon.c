@@ -10,6 +10,18 @@
 
 #include "germ.h"
 #include "exp_mon.h"
+#include "roi.h"
+#include "calib.h"
+#include "tslice.h"
+#include "coinc.h"
+#include "pileup.h"
+#include "filter.h"
+#include "output.h"
+#include "mover.h"
+#include "runcfg.h"
+#include "flightrec.h"
+#include "framestats.h"
+#include "trace.h"
 #include "log.h"
 
 extern atomic_char   count;
@@ -20,9 +32,6 @@ extern char          datafile_run[MAX_FILENAME_LEN];
 extern char          spectrafile_run[MAX_FILENAME_LEN];
 extern unsigned long filesize;
 extern unsigned long runno;
-extern pthread_mutex_t tmp_datafile_dir_lock;
-extern pthread_mutex_t datafile_dir_lock;
-extern pthread_mutex_t filename_lock;
 
 extern pv_obj_t  pv[NUM_PVS];
 extern unsigned int  nelm;
@@ -132,6 +141,24 @@ void en_array_proc( unsigned char pv_proc,      // Can be PV_TSEN_PROC or PV_TSE
     pv_put(pv_proc);
 }
 
+//========================================================================
+// Publish the run parameters, as they are now, as one snapshot for the
+// other threads.
+//========================================================================
+static void run_cfg_update(void)
+{
+    run_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    snprintf(cfg.tmp_datafile_dir, MAX_FILENAME_LEN, "%s", tmp_datafile_dir);
+    snprintf(cfg.datafile_dir,     MAX_FILENAME_LEN, "%s", datafile_dir);
+    snprintf(cfg.filename,         MAX_FILENAME_LEN, "%s", filename);
+    cfg.runno    = runno;
+    cfg.filesize = filesize;
+
+    run_cfg_publish(&cfg);
+}
+
 //========================================================================
 // Update on data file name related PV updates.
 //    typedef struct event_handler_args {
@@ -146,7 +173,6 @@ void en_array_proc( unsigned char pv_proc,      // Can be PV_TSEN_PROC or PV_TSE
 void pv_update(struct event_handler_args eha)
 {
     uint8_t count_status;
-    char str[MAX_FILENAME_LEN];
 
     if (ECA_NORMAL != eha.status)
     {
@@ -210,6 +236,7 @@ void pv_update(struct event_handler_args eha)
     {
         atomic_store_explicit(&filesize, *(unsigned long*)eha.dbr, memory_order_relaxed);
         pv_put(PV_FILESIZE_RBV);
+        run_cfg_update();
     }
     // count
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_COUNT].my_chid))
@@ -229,30 +256,31 @@ void pv_update(struct event_handler_args eha)
     //tmp_datafile_dir
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_TMP_DATAFILE_DIR].my_chid))
     {
-        write_protected_string((char*)eha.dbr, tmp_datafile_dir, MAX_FILENAME_LEN, &tmp_datafile_dir_lock);
-        read_protected_string(tmp_datafile_dir, str, MAX_FILENAME_LEN, &tmp_datafile_dir_lock);
-        info("new temp data directory is %s at %p\n", str, (void*)tmp_datafile_dir);
+        snprintf(tmp_datafile_dir, MAX_FILENAME_LEN, "%s", (char*)eha.dbr);
+        info("new temp data directory is %s\n", tmp_datafile_dir);
+        run_cfg_update();
     }
     //datafile_dir
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_DATAFILE_DIR].my_chid))
     {
-        write_protected_string((char*)eha.dbr, datafile_dir, MAX_FILENAME_LEN, &datafile_dir_lock);
-        read_protected_string(datafile_dir, str, MAX_FILENAME_LEN, &datafile_dir_lock);
-        info("new data directory is %s\n", str);
+        snprintf(datafile_dir, MAX_FILENAME_LEN, "%s", (char*)eha.dbr);
+        info("new data directory is %s\n", datafile_dir);
+        run_cfg_update();
     }
     //filename
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_FILENAME].my_chid))
     {
-        write_protected_string((char*)eha.dbr, filename, MAX_FILENAME_LEN, &filename_lock);
-        read_protected_string(filename, str, MAX_FILENAME_LEN, &filename_lock);
-        info("new filename is %s\n", str);
+        snprintf(filename, MAX_FILENAME_LEN, "%s", (char*)eha.dbr);
+        info("new filename is %s\n", filename);
         pvs_put(PV_FILENAME_RBV, MAX_FILENAME_LEN);
+        run_cfg_update();
     }
     // runno
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_RUNNO].my_chid))
     {
         atomic_store_explicit(&runno, *(unsigned long*)eha.dbr, memory_order_relaxed);
         pv_put(PV_RUNNO_RBV);
+        run_cfg_update();
     }
     // ipaddr
     else if ((unsigned long)eha.chid == (unsigned long)(pv[PV_IPADDR].my_chid))
@@ -290,6 +318,8 @@ void pv_subscribe(unsigned char i)
 
 void* exp_mon_thread(void * arg)
 {
+    uint64_t tr_put;
+
     printf("#####################################################\n");
     log("Initializing exp_mon_thread...\n");
 
@@ -313,7 +343,43 @@ void* exp_mon_thread(void * arg)
 
     printf("=====================================================\n");
 
-    SEVCHK(ca_pend_event(0.0),"ca_pend_event @exp_mon_thread");
+    trace_thread_init(__func__);
+
+    // Handle CA events, reload processing configurations on change, and
+    // report on the mover and the last frames.
+    while(1)
+    {
+        roi_cfg_poll();
+        calib_cfg_poll();
+        tslice_cfg_poll();
+        coinc_cfg_poll();
+        pileup_cfg_poll();
+        filter_cfg_poll();
+        output_cfg_poll();
+        flightrec_cfg_poll();
+        trace_cfg_poll();
+        run_cfg_reclaim();
+
+        mover_update_stats(CFG_POLL_PERIOD);
+        pv_put_async(PV_MOVE_PENDING);
+        pv_put_async(PV_MOVE_DONE);
+        pv_put_async(PV_MOVE_FAILED);
+        pv_put_async(PV_MOVE_RATE);
+
+        if (framestats_poll())
+        {
+            pvs_put_async(PV_FRAME_HIST_NUM, FS_HISTORY);
+            pvs_put_async(PV_FRAME_HIST_MBPS, FS_HISTORY);
+            pvs_put_async(PV_FRAME_HIST_EVPS, FS_HISTORY);
+            pvs_put_async(PV_FRAME_HIST_MISS, FS_HISTORY);
+            pvs_put_async(PV_FRAME_HIST_LOST, FS_HISTORY);
+        }
+        tr_put = trace_begin();
+        ca_flush_io();
+        trace_end(TR_CA_PUT, tr_put);
+
+        ca_pend_event(CFG_POLL_PERIOD);
+    }
 
     return NULL;
 }
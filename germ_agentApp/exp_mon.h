@@ -6,6 +6,8 @@
 #define EN_CTRL_DISABLE        2
 #define EN_CTRL_DISABLE_ALL    3 
 
+#define CFG_POLL_PERIOD      1.0   // seconds between checks of the *.cfg files
+
 
 void * exp_mon_thread(void* arg);
 
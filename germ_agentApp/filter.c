@@ -0,0 +1,235 @@
+/**
+ * File: filter.c
+ *
+ * Functionality: Event filter for the cooked output.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Per-channel thresholds from FILTER_CFG_FILE and the CHEN
+ *               mask, rebuilt when either changes and handed to
+ *               data_write_thread by pointer swap.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "filter.h"
+#include "log.h"
+
+
+extern char chen[MAX_NELM];
+
+_Atomic(filter_table_t*) filter_table_pending = ATOMIC_VAR_INIT(NULL);
+
+
+//========================================================================
+// Read FILTER_CFG_FILE and build the table. Returns NULL on error.
+//========================================================================
+static filter_table_t* filter_load(const char* file)
+{
+    FILE           * fp;
+    char             line[512];
+    char             chans[256], arg[64];
+    uint8_t          sel[NUM_CHANS];
+    unsigned int     val;
+    int              n, line_num = 0, use_chen = 1;
+    filter_table_t * t;
+
+    fp = fopen(file, "r");
+    if (NULL == fp)
+    {
+        err("failed to open %s\n", file);
+        return NULL;
+    }
+
+    t = calloc(1, sizeof(filter_table_t));
+    if (NULL == t)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    t->enabled = 1;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_num++;
+        *strchrnul(line, '#') = 0;
+
+        n = sscanf(line, "%255s %63s", chans, arg);
+        if (n <= 0)
+        {
+            continue;  // blank line or comment
+        }
+        if (2 != n)
+        {
+            goto bad_line;
+        }
+
+        if (0 == strcmp(chans, "chen"))
+        {
+            if (1 != sscanf(arg, "%d", &use_chen))
+            {
+                goto bad_line;
+            }
+            continue;
+        }
+
+        if (0 != parse_chan_list(chans, sel))
+        {
+            goto bad_line;
+        }
+        if (0 == strcmp(arg, "off"))
+        {
+            val = FILTER_DROP_ALL;
+        }
+        else if (1 != sscanf(arg, "%u", &val) || val > FILTER_DROP_ALL)
+        {
+            goto bad_line;
+        }
+
+        for (int ch=0; ch<NUM_CHANS; ch++)
+        {
+            if (sel[ch])
+            {
+                t->thresh[ch] = val;
+            }
+        }
+    }
+    fclose(fp);
+
+    // CHEN holds 0 for an enabled channel
+    if (use_chen)
+    {
+        for (int ch=0; ch<NUM_CHANS; ch++)
+        {
+            if (chen[ch])
+            {
+                t->thresh[ch] = FILTER_DROP_ALL;
+            }
+        }
+    }
+
+    return t;
+
+bad_line:
+    err("%s line %d: invalid filter\n", file, line_num);
+    fclose(fp);
+    free(t);
+    return NULL;
+}
+
+
+//========================================================================
+// Copy a packet, leaving out the events the table drops. Returns the
+// length of the copy in words.
+//
+// Like the packet decoder, pairs are compacted without branching: every
+// pair is copied and the output index only advances for a kept one.
+//========================================================================
+uint16_t filter_packet( const filter_table_t * t,
+                        const uint32_t       * packet,
+                        uint16_t               packet_length,
+                        uint32_t             * out,
+                        uint32_t             * dropped )
+{
+    uint16_t first = 2;  // packet counter and header
+    uint16_t last  = packet_length;
+    uint16_t n, i;
+
+    if (packet_length >= 4)
+    {
+        if (ntohl(packet[2]) == SOF_MARKER)
+        {
+            first = 4;
+        }
+        if (ntohl(packet[packet_length-1]) == EOF_MARKER)
+        {
+            last -= 2;
+        }
+    }
+    if (last < first)
+    {
+        last = first;
+    }
+
+    memcpy(out, packet, first*sizeof(uint32_t));
+    n = first;
+
+    for (i=first; i+1<last; i+=2)
+    {
+        uint32_t evt  = ntohl(packet[i]);
+        uint32_t drop = (!(evt & TS_FLAG)) & (EVT_PD(evt) < t->thresh[EVT_ADDR(evt)]);
+
+        out[n]   = packet[i];
+        out[n+1] = packet[i+1];
+        dropped[EVT_ADDR(evt)] += drop;
+        n += (!drop) << 1;
+    }
+
+    // odd word, if any, and trailer
+    memcpy(out+n, packet+i, (packet_length-i)*sizeof(uint32_t));
+    n += packet_length - i;
+
+    return n;
+}
+
+
+//========================================================================
+// Rebuild the table if FILTER_CFG_FILE or CHEN has changed. Removing the
+// file switches back to raw output.
+//========================================================================
+void filter_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+    static char            last_chen[MAX_NELM];
+    static uint8_t         active = 0;
+
+    filter_table_t * t = NULL;
+    filter_table_t * old;
+    int              status;
+
+    status = cfg_file_changed(FILTER_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        if (!active || 0 == memcmp(last_chen, chen, MAX_NELM))
+        {
+            return;
+        }
+        status = CFG_CHANGED;  // CHEN changed
+    }
+    memcpy(last_chen, chen, MAX_NELM);
+
+    if (CFG_REMOVED == status)
+    {
+        info("%s removed. Raw data output.\n", FILTER_CFG_FILE);
+        t = calloc(1, sizeof(filter_table_t));
+        if (NULL == t)
+        {
+            return;
+        }
+        active = 0;
+    }
+    else
+    {
+        t = filter_load(FILTER_CFG_FILE);
+        if (NULL == t)
+        {
+            err("filter in %s ignored.\n", FILTER_CFG_FILE);
+            return;
+        }
+        info("event filter loaded, cooked data output from the next frame.\n");
+        active = 1;
+    }
+
+    old = atomic_exchange(&filter_table_pending, t);
+    free(old);
+}
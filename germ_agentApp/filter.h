@@ -0,0 +1,51 @@
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Event filter for the cooked output.
+//
+// With FILTER_CFG_FILE in place, data_write_thread drops
+// events of masked channels, or below a per-channel pd
+// threshold, before writing. Everything else in a packet,
+// including malformed pairs, is written as it is. Without
+// the file the data is written raw.
+//
+// FILTER_CFG_FILE:
+//
+//     chen  0|1              drop channels disabled by CHEN
+//                            (default 1)
+//     <channels> <pd_min>    drop events with pd < pd_min
+//     <channels> off         drop all events
+//
+// <channels> is "all" or a list like 0-31,64. Later lines
+// override earlier ones.
+//
+// Both are folded into one threshold per address, so an event
+// is kept if pd >= thresh[addr].
+//===========================================================
+
+#define FILTER_DROP_ALL   NUM_MCA_COL   // above any pd
+
+typedef struct
+{
+    uint8_t    enabled;                       // 0: raw output
+    uint16_t   thresh[1 << ADDR_WIDTH];       // all addresses, valid or not
+} filter_table_t;
+
+// New table from filter_cfg_poll(), taken by data_write_thread.
+extern _Atomic(filter_table_t*) filter_table_pending;
+
+void     filter_cfg_poll(void);
+uint16_t filter_packet( const filter_table_t * t,
+                        const uint32_t       * packet,
+                        uint16_t               packet_length,
+                        uint32_t             * out,
+                        uint32_t             * dropped );
+
+#endif
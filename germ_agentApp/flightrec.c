@@ -0,0 +1,387 @@
+/**
+ * File: flightrec.c
+ *
+ * Functionality: Flight recorder of the raw packet stream.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Last packets kept with their arrival time, and dumped to
+ *               files when packets, frames or events go missing;
+ *               Arrival time given by the receiving thread.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+
+#include "germ.h"
+#include "flightrec.h"
+#include "log.h"
+
+#define FR_MAX_REASON   256
+
+typedef struct
+{
+    _Atomic uint64_t  seq;          // 2n+1 while packet n is written, 2n+2 after
+    uint64_t          ts_ns;        // arrival, CLOCK_REALTIME
+    uint32_t          length;
+    uint32_t          reserved;
+    uint8_t           data[MAX_PACKET_LENGTH];
+} fr_slot_t;
+
+typedef struct
+{
+    uint32_t  capacity;
+    uint32_t  seconds;
+    uint32_t  holdoff;
+    uint32_t  triggers;
+    char      dir[MAX_FILENAME_LEN];
+} fr_cfg_t;
+
+static struct
+{
+    fr_slot_t       * slots;        // NULL when not recording
+    uint64_t          num_slots;
+    uint64_t          head;         // next packet number, receiving thread only
+    _Atomic uint64_t  published;    // packets fully written
+
+    fr_cfg_t          cfg;          // under mutex, but for the two below
+    _Atomic uint32_t  triggers;
+    _Atomic uint64_t  next_dump_ns; // CLOCK_MONOTONIC, end of the hold-off
+
+    pthread_mutex_t   mutex;
+    pthread_cond_t    cond;
+    uint8_t           requested;
+    uint64_t          trigger_ns;   // CLOCK_REALTIME
+    char              reason[FR_MAX_REASON];
+} fr = { .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+
+//========================================================================
+static uint64_t clock_ns(clockid_t clk)
+{
+    struct timespec t;
+
+    clock_gettime(clk, &t);
+    return t.tv_sec * 1000000000UL + t.tv_nsec;
+}
+
+
+//========================================================================
+// Read FLIGHTREC_CFG_FILE, defaults for what it doesn't have.
+//========================================================================
+static void read_cfg(fr_cfg_t* cfg, int exists)
+{
+    cfg_key_t keys[] =
+    {
+        { "capacity", CFG_U32, &cfg->capacity                      },
+        { "seconds",  CFG_U32, &cfg->seconds                       },
+        { "holdoff",  CFG_U32, &cfg->holdoff                       },
+        { "dir",      CFG_STR, cfg->dir,      MAX_FILENAME_LEN     },
+        { "gap",      CFG_BIT, &cfg->triggers, FR_TRIG_GAP         },
+        { "lost",     CFG_BIT, &cfg->triggers, FR_TRIG_LOST        },
+        { "overflow", CFG_BIT, &cfg->triggers, FR_TRIG_OVERFLOW    },
+        { "frame",    CFG_BIT, &cfg->triggers, FR_TRIG_FRAME       },
+    };
+
+    cfg->capacity = FR_DEFAULT_CAPACITY;
+    cfg->seconds  = FR_DEFAULT_SECONDS;
+    cfg->holdoff  = FR_DEFAULT_HOLDOFF;
+    cfg->triggers = FR_TRIG_ALL;
+    strcpy(cfg->dir, ".");
+
+    if (exists)
+    {
+        cfg_read(FLIGHTREC_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0]));
+    }
+}
+
+
+//========================================================================
+// Reload FLIGHTREC_CFG_FILE if it has changed. The trigger rules take
+// effect at once, the capacity at the next start.
+//========================================================================
+void flightrec_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    fr_cfg_t cfg;
+    int      status;
+
+    status = cfg_file_changed(FLIGHTREC_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        return;
+    }
+    read_cfg(&cfg, CFG_CHANGED == status);
+
+    pthread_mutex_lock(&fr.mutex);
+    if (fr.slots && cfg.capacity != fr.cfg.capacity)
+    {
+        warn("flight recorder capacity of %u MB effective from the next start.\n", cfg.capacity);
+        cfg.capacity = fr.cfg.capacity;
+    }
+    fr.cfg = cfg;
+    atomic_store(&fr.triggers, cfg.triggers);
+    pthread_mutex_unlock(&fr.mutex);
+
+    info( "flight recorder dumps %u s to %s on triggers 0x%x, %u s apart.\n",
+          cfg.seconds, cfg.dir, cfg.triggers, cfg.holdoff );
+}
+
+
+//========================================================================
+// Write the recorded packets that arrived from some seconds before the
+// trigger on. Packets are copied out of the ring first, as the receiving
+// thread keeps overwriting it; those overwritten meanwhile are counted.
+//========================================================================
+static void dump(const fr_cfg_t* cfg, uint64_t trigger_ns, const char* reason)
+{
+    fr_slot_t * copy;
+    fr_slot_t * slot;
+    uint64_t    head, first, seq;
+    uint64_t    since_ns;
+    uint64_t    num = 0, num_torn = 0, offset = 0;
+    char        base[MAX_FILENAME_LEN + 64];
+    char        path[MAX_FILENAME_LEN + 96];
+    char        stamp[32];
+    time_t      sec = trigger_ns / 1000000000UL;
+    struct tm   tm;
+    FILE      * bin;
+    FILE      * txt;
+
+    head     = atomic_load_explicit(&fr.published, memory_order_acquire);
+    first    = (head > fr.num_slots) ? head - fr.num_slots : 0;
+    since_ns = trigger_ns - cfg->seconds * 1000000000UL;
+
+    copy = malloc((head - first) * sizeof(fr_slot_t));
+    if (NULL == copy)
+    {
+        err("no memory for a flight recorder dump\n");
+        return;
+    }
+
+    for (uint64_t n=first; n<head; n++)
+    {
+        slot = &fr.slots[n % fr.num_slots];
+        seq  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != 2 * n + 2)
+        {
+            num_torn++;
+            continue;
+        }
+        copy[num].ts_ns  = slot->ts_ns;
+        copy[num].length = slot->length;
+        memcpy(copy[num].data, slot->data, copy[num].length);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != atomic_load_explicit(&slot->seq, memory_order_relaxed))
+        {
+            num_torn++;
+            continue;
+        }
+        num += (copy[num].ts_ns >= since_ns);
+    }
+
+    localtime_r(&sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    snprintf(base, sizeof(base), "%s/flightrec.%s", cfg->dir, stamp);
+
+    snprintf(path, sizeof(path), "%s.0000000000.bin", base);
+    bin = fopen(path, "wb");
+    snprintf(path, sizeof(path), "%s.txt", base);
+    txt = fopen(path, "w");
+    if (NULL == bin || NULL == txt)
+    {
+        err("failed to create flight recorder dump %s: %s\n", base, strerror(errno));
+        if (bin) fclose(bin);
+        if (txt) fclose(txt);
+        free(copy);
+        return;
+    }
+
+    fprintf(txt, "# %s\n", reason);
+    fprintf(txt, "# triggered at %lu.%09lu\n", sec, trigger_ns % 1000000000UL);
+    fprintf(txt, "# %lu packets in the last %u s", num, cfg->seconds);
+    if (num_torn)
+    {
+        fprintf(txt, ", %lu more overwritten while copying", num_torn);
+    }
+    fprintf(txt, "\n# offset length counter arrival_ns\n");
+
+    for (uint64_t i=0; i<num; i++)
+    {
+        fwrite(copy[i].data, 1, copy[i].length, bin);
+        fprintf( txt, "%lu %u %u %lu\n",
+                 offset,
+                 copy[i].length,
+                 (copy[i].length >= 4) ? ntohl(*(uint32_t*)copy[i].data) : 0,
+                 copy[i].ts_ns );
+        offset += copy[i].length;
+    }
+
+    if (0 != fclose(bin) || 0 != fclose(txt))
+    {
+        err("failed to write flight recorder dump %s\n", base);
+    }
+    else
+    {
+        info("flight recorder: %lu packets dumped to %s (%s)\n", num, base, reason);
+    }
+    free(copy);
+}
+
+
+//========================================================================
+static void* dump_thread(void* arg)
+{
+    fr_cfg_t  cfg;
+    uint64_t  trigger_ns;
+    char      reason[FR_MAX_REASON];
+
+    while (1)
+    {
+        pthread_mutex_lock(&fr.mutex);
+        while (!fr.requested)
+        {
+            pthread_cond_wait(&fr.cond, &fr.mutex);
+        }
+        fr.requested = 0;
+        cfg          = fr.cfg;
+        trigger_ns   = fr.trigger_ns;
+        memcpy(reason, fr.reason, sizeof(reason));
+        pthread_mutex_unlock(&fr.mutex);
+
+        dump(&cfg, trigger_ns, reason);
+    }
+
+    return NULL;
+}
+
+
+//========================================================================
+// Read FLIGHTREC_CFG_FILE and set up the ring, touched now rather than on
+// the first lap of the receiving thread.
+//========================================================================
+int flightrec_init(void)
+{
+    pthread_t tid;
+    int       status;
+
+    flightrec_cfg_poll();
+    if (0 == fr.cfg.capacity)
+    {
+        info("flight recorder off.\n");
+        return 0;
+    }
+
+    fr.num_slots = ((uint64_t)fr.cfg.capacity << 20) / sizeof(fr_slot_t);
+    if (0 == fr.num_slots)
+    {
+        fr.num_slots = 1;
+    }
+    fr.slots = malloc(fr.num_slots * sizeof(fr_slot_t));
+    if (NULL == fr.slots)
+    {
+        err("no memory for a flight recorder of %u MB\n", fr.cfg.capacity);
+        return -1;
+    }
+    memset(fr.slots, 0, fr.num_slots * sizeof(fr_slot_t));
+
+    status = pthread_create(&tid, NULL, &dump_thread, NULL);
+    if (0 != status)
+    {
+        err("can't create the flight recorder dump thread: %s\n", strerror(status));
+        free(fr.slots);
+        fr.slots = NULL;
+        return -1;
+    }
+    pthread_detach(tid);
+
+    info("flight recorder of %lu packets.\n", fr.num_slots);
+    return 0;
+}
+
+
+//========================================================================
+// Record a packet as it arrives, at rx_ns (CLOCK_REALTIME). Called by the
+// receiving thread only.
+//========================================================================
+void flightrec_packet(const void* packet, uint32_t length, uint64_t rx_ns)
+{
+    fr_slot_t * slot;
+
+    if (NULL == fr.slots)
+    {
+        return;
+    }
+    slot = &fr.slots[fr.head % fr.num_slots];
+
+    if (length > MAX_PACKET_LENGTH)
+    {
+        length = MAX_PACKET_LENGTH;
+    }
+
+    atomic_store_explicit(&slot->seq, 2 * fr.head + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->ts_ns  = rx_ns;
+    slot->length = length;
+    memcpy(slot->data, packet, length);
+
+    atomic_store_explicit(&slot->seq, 2 * fr.head + 2, memory_order_release);
+    fr.head++;
+    atomic_store_explicit(&fr.published, fr.head, memory_order_release);
+}
+
+
+//========================================================================
+// Report an anomaly. Dumps are made by a thread of their own, so this is
+// cheap for the caller, and cheaper still within the hold-off.
+//========================================================================
+void flightrec_trigger(uint32_t what, const char* fmt, ...)
+{
+    va_list   args;
+    uint64_t  now, next;
+
+    if (NULL == fr.slots || !(atomic_load(&fr.triggers) & what))
+    {
+        return;
+    }
+
+    now  = clock_ns(CLOCK_MONOTONIC);
+    next = atomic_load(&fr.next_dump_ns);
+    if (now < next)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&fr.mutex);
+    // one of several threads triggering at once gets it
+    if (now < atomic_load(&fr.next_dump_ns))
+    {
+        pthread_mutex_unlock(&fr.mutex);
+        return;
+    }
+    atomic_store(&fr.next_dump_ns, now + (fr.cfg.holdoff ? fr.cfg.holdoff : 1) * 1000000000UL);
+
+    va_start(args, fmt);
+    vsnprintf(fr.reason, sizeof(fr.reason), fmt, args);
+    va_end(args);
+    fr.trigger_ns = clock_ns(CLOCK_REALTIME);
+    fr.requested  = 1;
+    pthread_cond_signal(&fr.cond);
+    warn("flight recorder triggered: %s\n", fr.reason);
+    pthread_mutex_unlock(&fr.mutex);
+}
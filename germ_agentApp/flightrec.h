@@ -0,0 +1,63 @@
+#ifndef _FLIGHTREC_H_
+#define _FLIGHTREC_H_
+
+#include <stdint.h>
+
+//===========================================================
+// Flight recorder of the raw packet stream.
+//
+// The receiving thread copies every packet, with the time it
+// arrived (see rxtime.h), into a ring of fixed slots, overwriting the oldest.
+// Nothing else touches the ring until an anomaly is reported:
+//
+//   FR_TRIG_GAP       packet counter jumps within a frame,
+//                     or frames lost
+//   FR_TRIG_LOST      events lost, as reported at End of Frame
+//   FR_TRIG_OVERFLOW  packet buffers full when a packet arrives
+//   FR_TRIG_FRAME     packets without Start of Frame, or Start
+//                     of Frame without the End of the previous
+//
+// A dump thread then writes the packets from some seconds
+// before the trigger on, as far as the ring holds them, to
+//     dir/flightrec.YYYYmmdd-HHMMSS.0000000000.bin
+//     dir/flightrec.YYYYmmdd-HHMMSS.txt
+//
+// The .bin holds the packets as a raw segment does, so it can
+// be replayed with germ_daemon -r dir/flightrec.YYYYmmdd-HHMMSS.
+// The .txt gives the reason, then a line per packet: offset
+// in the .bin, length, packet counter and arrival time (ns
+// since the epoch).
+//
+// Triggers within the hold-off of a dump are ignored, so a
+// burst of anomalies makes one dump.
+//
+// FLIGHTREC_CFG_FILE, all optional:
+//
+//     capacity <MB>      ring size, read at startup only
+//                        (default 64, 0 turns recording off)
+//     seconds  <s>       how much to dump (default 10)
+//     holdoff  <s>       between dumps (default 60)
+//     dir      <path>    where dumps go (default .)
+//     gap      0|1       triggers, all on by default
+//     lost     0|1
+//     overflow 0|1
+//     frame    0|1
+//===========================================================
+
+#define FR_TRIG_GAP            0x01
+#define FR_TRIG_LOST           0x02
+#define FR_TRIG_OVERFLOW       0x04
+#define FR_TRIG_FRAME          0x08
+#define FR_TRIG_ALL            0x0f
+
+#define FR_DEFAULT_CAPACITY    64           // MB
+#define FR_DEFAULT_SECONDS     10
+#define FR_DEFAULT_HOLDOFF     60
+
+int  flightrec_init(void);
+void flightrec_cfg_poll(void);
+void flightrec_packet(const void* packet, uint32_t length, uint64_t rx_ns);
+void flightrec_trigger(uint32_t what, const char* fmt, ...)
+         __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -0,0 +1,510 @@
+/**
+ * File: forward.c
+ *
+ * Functionality: Forwarding of the live packet stream to another node.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Bounded ring drained by a sender thread over TCP or a Unix
+ *               socket, batched sendmsg() with optional MSG_ZEROCOPY, and
+ *               packets dropped rather than acquisition held up.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <endian.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/errqueue.h>
+
+#include "germ.h"
+#include "event.h"
+#include "forward.h"
+#include "log.h"
+
+
+_Static_assert(FWD_MAX_PACKET == MAX_PACKET_LENGTH, "forwarded packets must fit a slot");
+_Static_assert(FWD_PKT_SOF == PKT_SOF && FWD_PKT_EOF == PKT_EOF, "packet flags");
+_Static_assert(24 == sizeof(fwd_rec_t), "forwarding record header must be 24 bytes");
+
+#define FWD_BATCH       256         // packets per sendmsg()
+#define FWD_IDLE_NS     100000      // between looks at an empty ring
+#define FWD_MAX_CALLS   1024        // zerocopy sends awaiting completion
+#define FWD_SNDBUF      (4 << 20)
+
+typedef struct
+{
+    fwd_rec_t  rec;                 // as sent, network byte order
+    uint8_t    data[FWD_MAX_PACKET];
+} fwd_slot_t;
+
+struct forwarder
+{
+    char              addr[MAX_FILENAME_LEN];
+    uint8_t           zerocopy;
+    fwd_slot_t      * slots;
+    uint64_t          num_slots;
+    pthread_t         tid;
+    pthread_mutex_t   lock;         // fd and stop, against forward_close()
+    _Atomic uint8_t   stop;
+    _Atomic uint8_t   connected;
+    int               fd;
+
+    // data_write_thread's side
+    _Alignas(64)
+    _Atomic uint64_t  head;         // slots filled
+    uint64_t          seq;          // packets numbered
+    _Atomic uint64_t  num_dropped;
+
+    // the sender's side
+    _Alignas(64)
+    _Atomic uint64_t  tail;         // slots free to reuse
+    _Atomic uint64_t  num_sent;
+    _Atomic uint64_t  bytes_sent;
+    _Atomic uint64_t  num_lost;
+    _Atomic uint64_t  num_connects;
+    uint64_t          call_end[FWD_MAX_CALLS];  // slots sent once call k completes
+    uint32_t          calls_sent;
+    uint32_t          calls_done;
+};
+
+
+//========================================================================
+// connect() giving up after FWD_RETRY_SEC, so an unreachable receiver
+// doesn't hold the sender for the TCP timeout.
+//========================================================================
+static int connect_timeout(int fd, const struct sockaddr* sa, socklen_t len)
+{
+    struct timeval tv = { FWD_RETRY_SEC, 0 };
+    int            ret;
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    ret = connect(fd, sa, len);
+    tv.tv_sec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    return ret;
+}
+
+
+//========================================================================
+static int connect_to(forwarder_t* fw, int quiet)
+{
+    struct sockaddr_un   sun;
+    struct addrinfo      hints, *res, *ai;
+    char                 host[MAX_FILENAME_LEN];
+    char               * port;
+    int                  fd = -1;
+    int                  one = 1;
+    int                  size = FWD_SNDBUF;
+
+    if ('/' == fw->addr[0])
+    {
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (snprintf(sun.sun_path, sizeof(sun.sun_path), "%s", fw->addr) >= (int)sizeof(sun.sun_path))
+        {
+            err("socket path %s too long\n", fw->addr);
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && 0 != connect_timeout(fd, (struct sockaddr*)&sun, sizeof(sun)))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    else
+    {
+        snprintf(host, sizeof(host), "%s", fw->addr);
+        port = strrchr(host, ':');
+        if (NULL == port)
+        {
+            err("forwarding address %s is neither host:port nor a path\n", fw->addr);
+            return -1;
+        }
+        *port++ = 0;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (0 != getaddrinfo(host, port, &hints, &res))
+        {
+            if (!quiet)
+            {
+                err("can't resolve %s\n", fw->addr);
+            }
+            return -1;
+        }
+        for (ai=res; ai; ai=ai->ai_next)
+        {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+            {
+                continue;
+            }
+            if (0 == connect_timeout(fd, ai->ai_addr, ai->ai_addrlen))
+            {
+                break;
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+    }
+
+    if (fd < 0)
+    {
+        if (!quiet)
+        {
+            err("can't connect to %s: %s; packets dropped until connected\n", fw->addr, strerror(errno));
+        }
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    if (fw->zerocopy)
+    {
+#ifdef SO_ZEROCOPY
+        if ('/' == fw->addr[0] || 0 != setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)))
+#endif
+        {
+            warn("no MSG_ZEROCOPY to %s, copying\n", fw->addr);
+            fw->zerocopy = 0;
+        }
+    }
+    (void)one;
+
+    info("forwarding packets to %s%s\n", fw->addr, fw->zerocopy ? " (zerocopy)" : "");
+    return fd;
+}
+
+
+//========================================================================
+// Take zerocopy completions, waiting for some if 'wait'. Sends complete
+// in order, so the ring is freed up to the last one reported.
+//========================================================================
+static void reap(forwarder_t* fw, int fd, int wait)
+{
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    struct pollfd               pfd = { .fd = fd, .events = 0 };
+    struct msghdr               msg;
+    char                        control[256];
+    struct cmsghdr            * cm;
+    struct sock_extended_err  * ee;
+
+    if (wait)
+    {
+        poll(&pfd, 1, 100);
+    }
+
+    while (1)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            break;
+        }
+        for (cm=CMSG_FIRSTHDR(&msg); cm; cm=CMSG_NXTHDR(&msg, cm))
+        {
+            ee = (struct sock_extended_err*)CMSG_DATA(cm);
+            if (SO_EE_ORIGIN_ZEROCOPY == ee->ee_origin
+                && (int32_t)(ee->ee_data + 1 - fw->calls_done) > 0)
+            {
+                fw->calls_done = ee->ee_data + 1;
+                atomic_store_explicit( &fw->tail,
+                                       fw->call_end[ee->ee_data % FWD_MAX_CALLS],
+                                       memory_order_release );
+            }
+        }
+    }
+#endif
+}
+
+
+//========================================================================
+// Close the connection, dropping what is still in the ring.
+//========================================================================
+static void disconnect(forwarder_t* fw, int fd, uint64_t* sent)
+{
+    uint64_t head;
+
+    atomic_store(&fw->connected, 0);
+    pthread_mutex_lock(&fw->lock);
+    fw->fd = -1;
+    close(fd);
+    pthread_mutex_unlock(&fw->lock);
+
+    head = atomic_load_explicit(&fw->head, memory_order_acquire);
+    atomic_fetch_add(&fw->num_lost, head - atomic_load(&fw->tail));
+    atomic_store_explicit(&fw->tail, head, memory_order_release);
+    *sent = head;
+}
+
+
+//========================================================================
+static void* forward_thread(void* arg)
+{
+    forwarder_t     * fw = arg;
+    struct iovec      iov[FWD_BATCH];
+    struct msghdr     msg;
+    struct timespec   idle = { 0, FWD_IDLE_NS };
+    fwd_slot_t      * slot;
+    uint64_t          sent = 0;     // slots sent in full
+    uint32_t          partial = 0;  // bytes of slot 'sent' sent
+    uint64_t          head;
+    uint32_t          n;
+    ssize_t           r;
+    int               fd = -1;
+    int               flags = MSG_NOSIGNAL;
+    int               quiet = 0;
+
+    while (!atomic_load(&fw->stop))
+    {
+        if (fd < 0)
+        {
+            fd = connect_to(fw, quiet);
+            if (fd < 0)
+            {
+                quiet = 1;
+                for (int i=0; i<10*FWD_RETRY_SEC && !atomic_load(&fw->stop); i++)
+                {
+                    usleep(100000);
+                }
+                continue;
+            }
+            quiet          = 0;
+            fw->calls_sent = 0;
+            fw->calls_done = 0;
+            partial        = 0;
+            sent           = atomic_load(&fw->tail);
+#ifdef MSG_ZEROCOPY
+            flags = MSG_NOSIGNAL | (fw->zerocopy ? MSG_ZEROCOPY : 0);
+#endif
+            pthread_mutex_lock(&fw->lock);
+            fw->fd = fd;
+            pthread_mutex_unlock(&fw->lock);
+            atomic_store(&fw->connected, 1);
+            atomic_fetch_add(&fw->num_connects, 1);
+        }
+
+        if (fw->zerocopy)
+        {
+            reap(fw, fd, fw->calls_sent - fw->calls_done >= FWD_MAX_CALLS);
+            if (fw->calls_sent - fw->calls_done >= FWD_MAX_CALLS)
+            {
+                continue;
+            }
+        }
+
+        head = atomic_load_explicit(&fw->head, memory_order_acquire);
+        if (sent == head)
+        {
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        n = (head - sent < FWD_BATCH) ? head - sent : FWD_BATCH;
+        for (uint32_t i=0; i<n; i++)
+        {
+            slot = &fw->slots[(sent + i) % fw->num_slots];
+            iov[i].iov_base = &slot->rec;
+            iov[i].iov_len  = sizeof(fwd_rec_t) + ntohl(slot->rec.length);
+        }
+        iov[0].iov_base  = (uint8_t*)iov[0].iov_base + partial;
+        iov[0].iov_len  -= partial;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = n;
+        r = sendmsg(fd, &msg, flags);
+        if (r < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if (ENOBUFS == errno && fw->zerocopy)
+            {
+                reap(fw, fd, 1);
+                continue;
+            }
+            if (!atomic_load(&fw->stop))
+            {
+                err("forwarding to %s failed: %s\n", fw->addr, strerror(errno));
+            }
+            disconnect(fw, fd, &sent);
+            fd = -1;
+            continue;
+        }
+
+        atomic_fetch_add_explicit(&fw->bytes_sent, r, memory_order_relaxed);
+        for (uint32_t i=0; i<n && r>0; i++)
+        {
+            if ((size_t)r >= iov[i].iov_len)
+            {
+                r      -= iov[i].iov_len;
+                partial = 0;
+                sent++;
+                atomic_fetch_add_explicit(&fw->num_sent, 1, memory_order_relaxed);
+            }
+            else
+            {
+                partial += r;
+                r        = 0;
+            }
+        }
+
+        if (fw->zerocopy)
+        {
+            fw->call_end[fw->calls_sent % FWD_MAX_CALLS] = sent;
+            fw->calls_sent++;
+        }
+        else
+        {
+            atomic_store_explicit(&fw->tail, sent, memory_order_release);
+        }
+    }
+
+    if (fd >= 0)
+    {
+        disconnect(fw, fd, &sent);
+    }
+
+    info( "forwarding to %s stopped: %lu packets sent, %lu dropped, %lu lost\n",
+          fw->addr, fw->num_sent, fw->num_dropped, fw->num_lost );
+    // forward_close() is done with it once it has the lock released
+    pthread_mutex_lock(&fw->lock);
+    pthread_mutex_unlock(&fw->lock);
+    pthread_mutex_destroy(&fw->lock);
+    free(fw->slots);
+    free(fw);
+    return NULL;
+}
+
+
+//========================================================================
+forwarder_t* forward_open(const char* addr, uint32_t buffer_mb, uint8_t zerocopy)
+{
+    forwarder_t * fw;
+
+    fw = calloc(1, sizeof(forwarder_t));
+    if (NULL == fw)
+    {
+        return NULL;
+    }
+    snprintf(fw->addr, sizeof(fw->addr), "%s", addr);
+    fw->zerocopy  = zerocopy;
+    fw->num_slots = ((uint64_t)(buffer_mb ? buffer_mb : FWD_DEFAULT_BUFFER) << 20) / sizeof(fwd_slot_t);
+    fw->fd        = -1;
+    pthread_mutex_init(&fw->lock, NULL);
+
+    fw->slots = malloc(fw->num_slots * sizeof(fwd_slot_t));
+    if (NULL == fw->slots)
+    {
+        err("no memory for forwarding %lu packets\n", fw->num_slots);
+        free(fw);
+        return NULL;
+    }
+
+    if (0 != pthread_create(&fw->tid, NULL, forward_thread, fw))
+    {
+        err("failed to start forwarding to %s\n", addr);
+        pthread_mutex_destroy(&fw->lock);
+        free(fw->slots);
+        free(fw);
+        return NULL;
+    }
+    pthread_detach(fw->tid);
+
+    return fw;
+}
+
+
+//========================================================================
+// Stop forwarding. The sender finishes, and frees the forwarder, on its
+// own, so this never waits on the receiver.
+//========================================================================
+void forward_close(forwarder_t* fw)
+{
+    if (NULL == fw)
+    {
+        return;
+    }
+
+    // a send blocked on the receiver returns on shutdown
+    pthread_mutex_lock(&fw->lock);
+    atomic_store(&fw->stop, 1);
+    if (fw->fd >= 0)
+    {
+        shutdown(fw->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&fw->lock);
+}
+
+
+//========================================================================
+// Queue one packet, or drop it if the ring is full or the receiver is
+// not connected. Never waits.
+//========================================================================
+void forward_packet( forwarder_t * fw,
+                     const void  * packet,
+                     uint32_t      length,
+                     uint32_t      frame_num,
+                     uint32_t      flags )
+{
+    uint64_t     head = atomic_load_explicit(&fw->head, memory_order_relaxed);
+    fwd_slot_t * slot;
+
+    if ( !atomic_load_explicit(&fw->connected, memory_order_relaxed)
+         || head - atomic_load_explicit(&fw->tail, memory_order_acquire) >= fw->num_slots )
+    {
+        fw->seq++;
+        atomic_fetch_add_explicit(&fw->num_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (length > FWD_MAX_PACKET)
+    {
+        length = FWD_MAX_PACKET;
+    }
+
+    slot = &fw->slots[head % fw->num_slots];
+    slot->rec.magic     = htonl(FWD_MAGIC);
+    slot->rec.length    = htonl(length);
+    slot->rec.seq       = htobe64(fw->seq++);
+    slot->rec.frame_num = htonl(frame_num);
+    slot->rec.flags     = htonl(flags);
+    memcpy(slot->data, packet, length);
+
+    atomic_store_explicit(&fw->head, head + 1, memory_order_release);
+}
+
+
+//========================================================================
+void forward_get_stats(forwarder_t* fw, fwd_stats_t* stats)
+{
+    stats->num_sent     = atomic_load(&fw->num_sent);
+    stats->bytes_sent   = atomic_load(&fw->bytes_sent);
+    stats->num_dropped  = atomic_load(&fw->num_dropped);
+    stats->num_lost     = atomic_load(&fw->num_lost);
+    stats->lag          = atomic_load(&fw->head) - atomic_load(&fw->tail);
+    stats->num_connects = atomic_load(&fw->num_connects);
+}
@@ -0,0 +1,80 @@
+#ifndef _FORWARD_H_
+#define _FORWARD_H_
+
+#include <stdint.h>
+
+//===========================================================
+// Forwarding of the live packet stream to another node.
+//
+// With 'forward ADDR' in OUTPUT_CFG_FILE, data_write_thread
+// also hands every packet it takes from the packet buffers
+// to a forwarder, from the next frame, which sends them
+// over TCP (ADDR is host:port) or a Unix stream socket
+// (ADDR starts with '/').
+//
+// The forwarder keeps packets in a bounded ring and a
+// thread of its own sends them, many packets per sendmsg()
+// with one iovec each, and with MSG_ZEROCOPY if wanted.
+// Acquisition never waits for the receiver. The policy is:
+//
+//   - ring full (receiver lagging by forward_buffer MB):
+//     new packets are dropped until there is room;
+//   - not connected: new packets are dropped, and the
+//     connection is tried again every FWD_RETRY_SEC;
+//   - send error: the connection is closed and packets
+//     still in the ring are dropped with it.
+//
+// Every packet is numbered, sent or not, so the receiver
+// sees exactly which were dropped.
+//
+// OUTPUT_CFG_FILE options:
+//
+//     forward          <host:port|/path>
+//     forward_buffer   <MB>      ring size (default 64)
+//     forward_zerocopy 0|1       MSG_ZEROCOPY for TCP
+//                                (default 0)
+//
+// Stream format: records of fwd_rec_t followed by 'length'
+// bytes of packet as received. Header fields are in network
+// byte order. This file doesn't depend on EPICS.
+//===========================================================
+
+#define FWD_MAGIC              0x47465744   // "GFWD"
+#define FWD_MAX_PACKET         2048         // MAX_PACKET_LENGTH
+#define FWD_DEFAULT_BUFFER     64           // MB
+#define FWD_RETRY_SEC          1
+
+#define FWD_PKT_SOF            0x01         // as PKT_SOF/PKT_EOF in event.h
+#define FWD_PKT_EOF            0x02
+
+typedef struct
+{
+    uint32_t  magic;
+    uint32_t  length;           // packet bytes following
+    uint64_t  seq;              // packet number, gaps are dropped packets
+    uint32_t  frame_num;
+    uint32_t  flags;            // FWD_PKT_*
+} fwd_rec_t;
+
+typedef struct
+{
+    uint64_t  num_sent;         // packets
+    uint64_t  bytes_sent;       // records, headers included
+    uint64_t  num_dropped;      // not taken: ring full or not connected
+    uint64_t  num_lost;         // in the ring when a connection failed
+    uint64_t  lag;              // packets in the ring
+    uint64_t  num_connects;
+} fwd_stats_t;
+
+typedef struct forwarder forwarder_t;
+
+forwarder_t* forward_open(const char* addr, uint32_t buffer_mb, uint8_t zerocopy);
+void         forward_close(forwarder_t* fw);
+void         forward_packet( forwarder_t * fw,
+                             const void  * packet,
+                             uint32_t      length,
+                             uint32_t      frame_num,
+                             uint32_t      flags );
+void         forward_get_stats(forwarder_t* fw, fwd_stats_t* stats);
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * File: framestats.c
+ *
+ * Functionality: History of frame statistics, as PVs and a file.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Lock-free ring of the last frames with their throughput,
+ *               published by exp_mon_thread and appended to a CSV file;
+ *               A CSV file per run.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "framestats.h"
+#include "runcfg.h"
+#include "log.h"
+
+extern uint32_t frame_hist_num[FS_HISTORY];
+extern float    frame_hist_mbps[FS_HISTORY];
+extern float    frame_hist_evps[FS_HISTORY];
+extern uint32_t frame_hist_missed[FS_HISTORY];
+extern uint32_t frame_hist_lost[FS_HISTORY];
+
+typedef struct
+{
+    _Atomic uint64_t  seq;      // 2n+1 while record n is written, 2n+2 after
+    fs_rec_t          rec;
+} fs_slot_t;
+
+static fs_slot_t        ring[FS_HISTORY];
+static _Atomic uint64_t head = ATOMIC_VAR_INIT(0);
+
+// exp_mon_thread only
+static uint64_t  cursor = 0;
+static fs_rec_t  hist[FS_HISTORY];
+static uint32_t  num_hist = 0;
+
+
+//========================================================================
+// Add the record of a frame, with its throughput. Called by
+// data_write_thread only.
+//========================================================================
+void framestats_add(fs_rec_t* rec)
+{
+    struct timespec t;
+    uint64_t        n = atomic_load_explicit(&head, memory_order_relaxed);
+    fs_slot_t     * slot = &ring[n % FS_HISTORY];
+
+    clock_gettime(CLOCK_REALTIME, &t);
+    rec->end_ns       = t.tv_sec * 1000000000UL + t.tv_nsec;
+    rec->mb_per_s     = (rec->elapsed > 0) ? rec->num_bytes * 1e-6 / rec->elapsed : 0;
+    rec->events_per_s = (rec->elapsed > 0) ? rec->num_events / rec->elapsed : 0;
+
+    atomic_store_explicit(&slot->seq, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->rec = *rec;
+
+    atomic_store_explicit(&slot->seq, 2 * n + 2, memory_order_release);
+    atomic_store_explicit(&head, n + 1, memory_order_release);
+}
+
+
+//========================================================================
+static void append_csv(FILE* fp, const fs_rec_t* r)
+{
+    fprintf( fp, "%u,%lu.%03lu,%u,%u,%lu,%.6f,%.3f,%.1f,%u,%u\n",
+             r->frame_num,
+             r->end_ns / 1000000000UL, r->end_ns / 1000000UL % 1000,
+             r->num_packets,
+             r->num_events,
+             r->num_bytes,
+             r->elapsed,
+             r->mb_per_s,
+             r->events_per_s,
+             r->missed_packets,
+             r->lost_events );
+}
+
+
+//========================================================================
+// Take the records added since the last call into the history PVs and
+// the statistics file. Returns the number of records taken, so the
+// caller knows whether to put the PVs.
+//========================================================================
+int framestats_poll(void)
+{
+    const run_cfg_t * run;
+    char              dir[MAX_FILENAME_LEN];
+    char              filename[MAX_FILENAME_LEN];
+    char              path[2 * MAX_FILENAME_LEN + 32];
+    FILE            * fp = NULL;
+    uint32_t          fp_run = 0;
+    fs_slot_t       * slot;
+    fs_rec_t          rec;
+    uint64_t          h = atomic_load_explicit(&head, memory_order_acquire);
+    uint64_t          seq;
+    uint32_t          i, k;
+    int               num = 0;
+
+    if (cursor == h)
+    {
+        return 0;
+    }
+    if (h - cursor > FS_HISTORY)
+    {
+        warn("%lu frame statistics records overwritten before publishing\n", h - FS_HISTORY - cursor);
+        cursor = h - FS_HISTORY;
+    }
+
+    run = run_cfg_acquire();
+    snprintf(dir,      MAX_FILENAME_LEN, "%s", run->tmp_datafile_dir);
+    snprintf(filename, MAX_FILENAME_LEN, "%s", run->filename);
+    run_cfg_release();
+
+    for (; cursor<h; cursor++)
+    {
+        slot = &ring[cursor % FS_HISTORY];
+        seq  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != 2 * cursor + 2)
+        {
+            continue;
+        }
+        rec = slot->rec;
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != atomic_load_explicit(&slot->seq, memory_order_relaxed))
+        {
+            continue;
+        }
+
+        if (num_hist == FS_HISTORY)
+        {
+            memmove(hist, hist + 1, (FS_HISTORY - 1) * sizeof(fs_rec_t));
+            num_hist--;
+        }
+        hist[num_hist++] = rec;
+
+        // a file per run, as for the segments
+        if (fp && rec.run_num != fp_run)
+        {
+            fclose(fp);
+            fp = NULL;
+        }
+        if (NULL == fp && dir[0] && filename[0])
+        {
+            snprintf(path, sizeof(path), "%s/%s.%010u.fstats.csv", dir, filename, rec.run_num);
+            fp     = fopen(path, "a");
+            fp_run = rec.run_num;
+            if (NULL == fp)
+            {
+                err("failed to open %s\n", path);
+                dir[0] = 0;
+            }
+            else if (0 == ftell(fp))
+            {
+                fprintf( fp, "frame,end_time,packets,events,bytes,elapsed_s,"
+                             "mb_per_s,events_per_s,missed_packets,lost_events\n" );
+            }
+        }
+        if (fp)
+        {
+            append_csv(fp, &rec);
+        }
+        num++;
+    }
+
+    if (fp)
+    {
+        fclose(fp);
+    }
+
+    // newest last, zeros before the oldest
+    for (i=0; i<FS_HISTORY; i++)
+    {
+        if (i + num_hist < FS_HISTORY)
+        {
+            frame_hist_num[i] = frame_hist_missed[i] = frame_hist_lost[i] = 0;
+            frame_hist_mbps[i] = frame_hist_evps[i] = 0;
+            continue;
+        }
+        k = i + num_hist - FS_HISTORY;
+        frame_hist_num[i]    = hist[k].frame_num;
+        frame_hist_mbps[i]   = hist[k].mb_per_s;
+        frame_hist_evps[i]   = hist[k].events_per_s;
+        frame_hist_missed[i] = hist[k].missed_packets;
+        frame_hist_lost[i]   = hist[k].lost_events;
+    }
+
+    return num;
+}
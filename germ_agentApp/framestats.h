@@ -0,0 +1,44 @@
+#ifndef _FRAMESTATS_H_
+#define _FRAMESTATS_H_
+
+#include <stdint.h>
+
+//===========================================================
+// Frame statistics history.
+//
+// data_write_thread adds a record at the end of each frame
+// to a ring of the last FS_HISTORY frames. The ring has one
+// writer and is read without locks: a slot carries a sequence
+// number that is odd while the slot is written, so a reader
+// that loses the race skips the record instead of waiting.
+//
+// Once a second exp_mon_thread takes the new records, fills
+// the history PVs with them (oldest first, newest last) and
+// appends them to the file of the run they were written in,
+//
+//     tmp_datafile_dir/filename.runno.fstats.csv
+//
+// with a header line when the file is created.
+//===========================================================
+
+#define FS_HISTORY   64
+
+typedef struct
+{
+    uint64_t  end_ns;           // CLOCK_REALTIME at the end of the frame
+    uint64_t  num_bytes;
+    double    elapsed;          // s, Start to End of Frame, file closed
+    uint32_t  run_num;
+    uint32_t  frame_num;
+    uint32_t  num_packets;
+    uint32_t  num_events;
+    uint32_t  missed_packets;   // from the packet counters
+    uint32_t  lost_events;      // reported at End of Frame
+    float     mb_per_s;
+    float     events_per_s;
+} fs_rec_t;
+
+void framestats_add(fs_rec_t* rec);
+int  framestats_poll(void);
+
+#endif
@@ -7,6 +7,20 @@
  *
  * Revisions:
  *
+ *   v1.2
+ *     - Date  : Oct 2026
+ *     - Brief : Replay of recorded segments in place of the UDP input (-r);
+ *               Flight recorder set up before the threads start;
+ *               Receive latency and gap histograms as PVs;
+ *               Frame statistics history as PVs;
+ *               Hardware counter profiling of the pipeline threads (-P);
+ *               Key table reader for the configuration files.
+ *
+ *   v1.1
+ *     - Date  : Oct 2026
+ *     - Brief : Run parameters published as run configuration snapshots
+ *               instead of mutex protected strings.
+ *
  *   v1.0
  *     - Author: Ji Li
  *     - Date  : Dec 2022
@@ -34,6 +48,7 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include <sched.h>
+#include <sys/stat.h>
 
 #include <cadef.h>
 
@@ -41,6 +56,19 @@
 #include "exp_mon.h"
 #include "udp_conn.h"
 #include "data_write.h"
+#include "data_proc.h"
+#include "rate_meter.h"
+#include "roi.h"
+#include "calib.h"
+#include "tslice.h"
+#include "coinc.h"
+#include "pileup.h"
+#include "filter.h"
+#include "runcfg.h"
+#include "replay.h"
+#include "flightrec.h"
+#include "rxtime.h"
+#include "framestats.h"
 #include "log.h"
 
 
@@ -48,6 +76,10 @@ packet_buff_t packet_buff[NUM_PACKET_BUFF];
     
 uint32_t reg1_val = 0x1;  // value to be written to FPGA register 1
 
+char     replay_path[MAX_FILENAME_LEN];   // DIR/FILENAME.RUNNO, empty for UDP
+double   replay_tick_ns = 0;              // 0: as fast as possible
+uint8_t  perf_enabled = 0;               // -P, see perfctr.h
+
 pv_obj_t pv[NUM_PVS];
 
 char ca_dtype[7][11] = { "DBR_STRING",
@@ -58,8 +90,35 @@ char ca_dtype[7][11] = { "DBR_STRING",
                          "DBR_LONG",
                          "DBR_DOUBLE" };
 
-uint16_t mca[NUM_MCA_ROW * NUM_MCA_COL];
-uint16_t tdc[NUM_TDC_ROW * NUM_TDC_COL];
+uint32_t mca[NUM_MCA_ROW * NUM_MCA_COL];
+uint32_t tdc[NUM_TDC_ROW * NUM_TDC_COL];
+
+float    rate[RATE_NUM_WIN][MAX_NELM];
+double   total_rate[RATE_NUM_WIN];
+uint32_t roi_counts[MAX_ROI];
+uint32_t cal_mca[NUM_CAL_ROW * NUM_CAL_COL + 1];
+uint32_t cal_sum[NUM_CAL_COL];
+uint32_t tslice_mca[NUM_MCA_COL];
+uint32_t tslice_index;
+uint32_t coinc_mult[COINC_MAX_MULT];
+uint32_t coinc_pairs[NUM_COINC_PAIRS];
+uint32_t pur_mca[NUM_MCA_ROW * NUM_MCA_COL];
+float    dead_time[MAX_NELM];
+float    live_time[MAX_NELM];
+uint32_t filter_dropped[MAX_NELM];
+uint32_t move_pending;
+uint32_t move_done;
+uint32_t move_failed;
+float    move_rate;
+uint32_t frame_hist_num[FS_HISTORY];
+float    frame_hist_mbps[FS_HISTORY];
+float    frame_hist_evps[FS_HISTORY];
+uint32_t frame_hist_missed[FS_HISTORY];
+uint32_t frame_hist_lost[FS_HISTORY];
+float    rollover_max;   // us
+float    rollover_mean;  // us
+uint32_t rx_latency_hist[RX_HIST_BINS];
+uint32_t rx_gap_hist[RX_HIST_BINS];
 
 atomic_char   count = ATOMIC_VAR_INIT(0);
 char          tmp_datafile_dir[MAX_FILENAME_LEN];
@@ -72,10 +131,6 @@ char          spectrafile[MAX_FILENAME_LEN];
 atomic_ulong filesize = 0;
 atomic_ulong runno = 0;
 
-pthread_mutex_t tmp_datafile_dir_lock = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t datafile_dir_lock     = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t filename_lock         = PTHREAD_MUTEX_INITIALIZER;
-
 
 unsigned int  nelm = 0;
 unsigned int  monch = 0;
@@ -97,6 +152,7 @@ unsigned int  watchdog = 0;
 atomic_char exp_mon_thread_ready    = ATOMIC_VAR_INIT(0);
 atomic_char udp_conn_thread_ready   = ATOMIC_VAR_INIT(0);
 atomic_char data_write_thread_ready = ATOMIC_VAR_INIT(0);
+atomic_char data_proc_thread_ready  = ATOMIC_VAR_INIT(0);
 
 //========================================================================
 // Calculate elapsed time.
@@ -145,6 +201,24 @@ void lock_buff_read(uint8_t idx, char check_val, const char* caller)
 }
 
 
+//========================================================================
+// Try to lock a buffer for read. Returns 1 with the buffer locked if it
+// has new data, 0 otherwise. For readers that have other work to do
+// while waiting.
+//========================================================================
+int trylock_buff_read(uint8_t idx, char check_val, const char* caller)
+{
+    pthread_mutex_lock(&packet_buff[idx].mutex);
+    if( !(packet_buff[idx].status & check_val) )
+    {
+        log("%s - buff[%d] locked\n", caller, idx);
+        return 1;
+    }
+    pthread_mutex_unlock(&packet_buff[idx].mutex);
+    return 0;
+}
+
+
 //========================================================================
 // Lock a buffer for write.
 //========================================================================
@@ -171,6 +245,23 @@ void lock_buff_write(uint8_t idx, char check_val, const char* caller)
 }
 
 
+//========================================================================
+// Try to lock a buffer for write. Returns 1 with the buffer locked if it
+// has been read, 0 otherwise. For writers that wait in their own way.
+//========================================================================
+int trylock_buff_write(uint8_t idx, char check_val, const char* caller)
+{
+    pthread_mutex_lock(&packet_buff[idx].mutex);
+    if( (packet_buff[idx].status & check_val) == check_val )
+    {
+        log("%s - buff[%d] locked\n", caller, idx);
+        return 1;
+    }
+    pthread_mutex_unlock(&packet_buff[idx].mutex);
+    return 0;
+}
+
+
 //========================================================================
 // Unlock a buffer.
 //========================================================================
@@ -180,6 +271,22 @@ void unlock_buff(uint8_t idx, const char* caller)
     log("%s - buff[%d] unlocked\n", caller, idx);
 }
 
+
+//========================================================================
+// Number of buffers still waiting for data_write_thread. Read without
+// locking, as a hint for background work to back off.
+//========================================================================
+int buff_backlog(void)
+{
+    int n = 0;
+
+    for (int i=0; i<NUM_PACKET_BUFF; i++)
+    {
+        n += !(__atomic_load_n(&packet_buff[i].status, __ATOMIC_RELAXED) & DATA_WRITTEN);
+    }
+    return n;
+}
+
 //========================================================================
 // Create channels for PVs.
 //========================================================================
@@ -196,6 +303,145 @@ void create_channel(const char * thread, unsigned int first_pv, unsigned int las
     }   
 }
 
+//========================================================================
+// Check if a configuration file has changed since last_mtime, which is
+// updated. A file that has never existed is reported as unchanged.
+//========================================================================
+int cfg_file_changed(const char* file, struct timespec* last_mtime)
+{
+    struct stat st;
+
+    if (0 != stat(file, &st))
+    {
+        if (0 == last_mtime->tv_sec && 0 == last_mtime->tv_nsec)
+        {
+            return CFG_UNCHANGED;
+        }
+        memset(last_mtime, 0, sizeof(struct timespec));
+        return CFG_REMOVED;
+    }
+
+    if ( st.st_mtim.tv_sec  == last_mtime->tv_sec &&
+         st.st_mtim.tv_nsec == last_mtime->tv_nsec )
+    {
+        return CFG_UNCHANGED;
+    }
+
+    *last_mtime = st.st_mtim;
+    return CFG_CHANGED;
+}
+
+//========================================================================
+// Read the keys of a configuration file into where 'keys' says. Keys the
+// file doesn't have are left as they are. Returns -1 if it can't be read.
+//========================================================================
+int cfg_read(const char* file, const cfg_key_t* keys, uint32_t num_keys)
+{
+    FILE     * fp;
+    char       line[512];
+    char       key[64];
+    char       val[MAX_FILENAME_LEN];
+    uint64_t   n;
+    uint32_t   i;
+
+    fp = fopen(file, "r");
+    if (NULL == fp)
+    {
+        err("failed to open %s\n", file);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        *strchrnul(line, '#') = 0;
+        if (2 != sscanf(line, "%63s %254s", key, val))
+        {
+            continue;
+        }
+        for (i=0; i<num_keys && strcmp(key, keys[i].key); i++);
+        if (i == num_keys)
+        {
+            warn("unknown key %s in %s\n", key, file);
+            continue;
+        }
+
+        n = strtoull(val, NULL, 10);
+        switch (keys[i].type)
+        {
+            case CFG_U64:
+                *(uint64_t*)keys[i].dst = n;
+                break;
+            case CFG_U32:
+                *(uint32_t*)keys[i].dst = n;
+                break;
+            case CFG_FLAG:
+                *(uint8_t*)keys[i].dst = (0 != n);
+                break;
+            case CFG_BIT:
+                if (n)
+                {
+                    *(uint32_t*)keys[i].dst |= keys[i].arg;
+                }
+                else
+                {
+                    *(uint32_t*)keys[i].dst &= ~keys[i].arg;
+                }
+                break;
+            case CFG_STR:
+                if (strlen(val) < keys[i].arg)
+                {
+                    strcpy((char*)keys[i].dst, val);
+                }
+                else
+                {
+                    warn("%s %s too long in %s\n", key, val, file);
+                }
+                break;
+            case CFG_FN:
+                keys[i].fn(keys[i].dst, val);
+                break;
+        }
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+//========================================================================
+// Parse a channel list like "all" or "0-31,64,70-79".
+//========================================================================
+int parse_chan_list(char* str, uint8_t chans[MAX_NELM])
+{
+    char *tok, *save;
+    unsigned int lo, hi;
+
+    memset(chans, 0, MAX_NELM);
+
+    if (0 == strcmp(str, "all"))
+    {
+        memset(chans, 1, MAX_NELM);
+        return 0;
+    }
+
+    for (tok = strtok_r(str, ",", &save); tok; tok = strtok_r(NULL, ",", &save))
+    {
+        if (2 != sscanf(tok, "%u-%u", &lo, &hi))
+        {
+            if (1 != sscanf(tok, "%u", &lo))
+            {
+                return -1;
+            }
+            hi = lo;
+        }
+        if (lo > hi || hi >= MAX_NELM)
+        {
+            return -1;
+        }
+        memset(chans+lo, 1, hi-lo+1);
+    }
+
+    return 0;
+}
+
 //========================================================================
 // PV initialization
 //------------------------------------------------------------------------
@@ -264,6 +510,15 @@ int pv_array_init(void)
     memcpy(pv_suffix[PV_NELM_RBV],         ":NELM_RBV",            9);
     memcpy(pv_suffix[PV_MONCH],            ".MONCH",               6);
     memcpy(pv_suffix[PV_MONCH_RBV],        ":MONCH_RBV",          10);
+    memcpy(pv_suffix[PV_MOVE_PENDING],     ":MOVE_PENDING",       13);
+    memcpy(pv_suffix[PV_MOVE_DONE],        ":MOVE_DONE",          10);
+    memcpy(pv_suffix[PV_MOVE_FAILED],      ":MOVE_FAILED",        12);
+    memcpy(pv_suffix[PV_MOVE_RATE],        ":MOVE_RATE",          10);
+    memcpy(pv_suffix[PV_FRAME_HIST_NUM],   ":FRAME_HIST_NUM",     15);
+    memcpy(pv_suffix[PV_FRAME_HIST_MBPS],  ":FRAME_HIST_MBPS",    16);
+    memcpy(pv_suffix[PV_FRAME_HIST_EVPS],  ":FRAME_HIST_EVPS",    16);
+    memcpy(pv_suffix[PV_FRAME_HIST_MISS],  ":FRAME_HIST_MISS",    16);
+    memcpy(pv_suffix[PV_FRAME_HIST_LOST],  ":FRAME_HIST_LOST",    16);
     memcpy(pv_suffix[PV_PID],              ":PID",                 4);
     memcpy(pv_suffix[PV_HOSTNAME],         ":HOSTNAME",            9);
     memcpy(pv_suffix[PV_DIR],              ":DIR",                 4);
@@ -278,7 +533,28 @@ int pv_array_init(void)
     memcpy(pv_suffix[PV_CHEN],             ".CHEN",                5);
     memcpy(pv_suffix[PV_RESTART],          ":UDP_RESTART",        12);
     memcpy(pv_suffix[PV_DATA_FILENAME],    ":DATA_FILENAME.VAL$", 19);
+    memcpy(pv_suffix[PV_FILTER_DROPPED],   ":FILTER_DROPPED",     15);
+    memcpy(pv_suffix[PV_ROLLOVER_MAX],     ":ROLLOVER_MAX",       13);
+    memcpy(pv_suffix[PV_ROLLOVER_MEAN],    ":ROLLOVER_MEAN",      14);
+    memcpy(pv_suffix[PV_RX_LATENCY],       ":RX_LATENCY",         11);
+    memcpy(pv_suffix[PV_RX_GAP],           ":RX_GAP",              7);
     memcpy(pv_suffix[PV_SPEC_FILENAME],    ":SPEC_FILENAME.VAL$", 19);
+    memcpy(pv_suffix[PV_RATE_100MS],       ":RATE_100MS",         11);
+    memcpy(pv_suffix[PV_RATE_1S],          ":RATE_1S",             8);
+    memcpy(pv_suffix[PV_RATE_10S],         ":RATE_10S",            9);
+    memcpy(pv_suffix[PV_TOTAL_RATE_100MS], ":TOTAL_RATE_100MS",   17);
+    memcpy(pv_suffix[PV_TOTAL_RATE_1S],    ":TOTAL_RATE_1S",      14);
+    memcpy(pv_suffix[PV_TOTAL_RATE_10S],   ":TOTAL_RATE_10S",     15);
+    memcpy(pv_suffix[PV_ROI_COUNTS],       ":ROI_COUNTS",         11);
+    memcpy(pv_suffix[PV_CAL_MCA],          ":CAL_MCA",             8);
+    memcpy(pv_suffix[PV_CAL_SUM],          ":CAL_SUM",             8);
+    memcpy(pv_suffix[PV_TSLICE_MCA],       ":TSLICE_MCA",         11);
+    memcpy(pv_suffix[PV_TSLICE_INDEX],     ":TSLICE_INDEX",       13);
+    memcpy(pv_suffix[PV_COINC_MULT],       ":COINC_MULT",         11);
+    memcpy(pv_suffix[PV_COINC_PAIRS],      ":COINC_PAIRS",        12);
+    memcpy(pv_suffix[PV_PUR_MCA],          ":PUR_MCA",             8);
+    memcpy(pv_suffix[PV_DEAD_TIME],        ":DEAD_TIME",          10);
+    memcpy(pv_suffix[PV_LIVE_TIME],        ":LIVE_TIME",          10);
 
     //--------------------------------------------------
     // PV name assembly
@@ -315,6 +591,15 @@ int pv_array_init(void)
     pv[PV_NELM_RBV].my_var_p         = (void*)(&nelm);
     pv[PV_MONCH].my_var_p            = (void*)(&monch);
     pv[PV_MONCH_RBV].my_var_p        = (void*)(&monch);
+    pv[PV_MOVE_PENDING].my_var_p     = (void*)(&move_pending);
+    pv[PV_MOVE_DONE].my_var_p        = (void*)(&move_done);
+    pv[PV_MOVE_FAILED].my_var_p      = (void*)(&move_failed);
+    pv[PV_MOVE_RATE].my_var_p        = (void*)(&move_rate);
+    pv[PV_FRAME_HIST_NUM].my_var_p   = (void*)frame_hist_num;
+    pv[PV_FRAME_HIST_MBPS].my_var_p  = (void*)frame_hist_mbps;
+    pv[PV_FRAME_HIST_EVPS].my_var_p  = (void*)frame_hist_evps;
+    pv[PV_FRAME_HIST_MISS].my_var_p  = (void*)frame_hist_missed;
+    pv[PV_FRAME_HIST_LOST].my_var_p  = (void*)frame_hist_lost;
     pv[PV_PID].my_var_p              = (void*)(&pid);
     pv[PV_HOSTNAME].my_var_p         = (void*)hostname;
     pv[PV_DIR].my_var_p              = (void*)directory;
@@ -329,7 +614,28 @@ int pv_array_init(void)
     pv[PV_CHEN].my_var_p             = (void*)(&chen);
     pv[PV_RESTART].my_var_p          = (void*)(&restart);
     pv[PV_DATA_FILENAME].my_var_p    = (void*)datafile;
+    pv[PV_FILTER_DROPPED].my_var_p   = (void*)filter_dropped;
+    pv[PV_ROLLOVER_MAX].my_var_p     = (void*)(&rollover_max);
+    pv[PV_ROLLOVER_MEAN].my_var_p    = (void*)(&rollover_mean);
+    pv[PV_RX_LATENCY].my_var_p       = (void*)rx_latency_hist;
+    pv[PV_RX_GAP].my_var_p           = (void*)rx_gap_hist;
     pv[PV_SPEC_FILENAME].my_var_p    = (void*)spectrafile;
+    pv[PV_RATE_100MS].my_var_p       = (void*)rate[RATE_WIN_100MS];
+    pv[PV_RATE_1S].my_var_p          = (void*)rate[RATE_WIN_1S];
+    pv[PV_RATE_10S].my_var_p         = (void*)rate[RATE_WIN_10S];
+    pv[PV_TOTAL_RATE_100MS].my_var_p = (void*)(&total_rate[RATE_WIN_100MS]);
+    pv[PV_TOTAL_RATE_1S].my_var_p    = (void*)(&total_rate[RATE_WIN_1S]);
+    pv[PV_TOTAL_RATE_10S].my_var_p   = (void*)(&total_rate[RATE_WIN_10S]);
+    pv[PV_ROI_COUNTS].my_var_p       = (void*)roi_counts;
+    pv[PV_CAL_MCA].my_var_p          = (void*)cal_mca;
+    pv[PV_CAL_SUM].my_var_p          = (void*)cal_sum;
+    pv[PV_TSLICE_MCA].my_var_p       = (void*)tslice_mca;
+    pv[PV_TSLICE_INDEX].my_var_p     = (void*)(&tslice_index);
+    pv[PV_COINC_MULT].my_var_p       = (void*)coinc_mult;
+    pv[PV_COINC_PAIRS].my_var_p      = (void*)coinc_pairs;
+    pv[PV_PUR_MCA].my_var_p          = (void*)pur_mca;
+    pv[PV_DEAD_TIME].my_var_p        = (void*)dead_time;
+    pv[PV_LIVE_TIME].my_var_p        = (void*)live_time;
 
     //--------------------------------------------------
     // Data types
@@ -351,6 +657,15 @@ int pv_array_init(void)
     pv[PV_NELM_RBV].my_dtype         = DBR_LONG;
     pv[PV_MONCH].my_dtype            = DBR_LONG;
     pv[PV_MONCH_RBV].my_dtype        = DBR_LONG;
+    pv[PV_MOVE_PENDING].my_dtype     = DBR_LONG;
+    pv[PV_MOVE_DONE].my_dtype        = DBR_LONG;
+    pv[PV_MOVE_FAILED].my_dtype      = DBR_LONG;
+    pv[PV_MOVE_RATE].my_dtype        = DBR_FLOAT;
+    pv[PV_FRAME_HIST_NUM].my_dtype   = DBR_LONG;
+    pv[PV_FRAME_HIST_MBPS].my_dtype  = DBR_FLOAT;
+    pv[PV_FRAME_HIST_EVPS].my_dtype  = DBR_FLOAT;
+    pv[PV_FRAME_HIST_MISS].my_dtype  = DBR_LONG;
+    pv[PV_FRAME_HIST_LOST].my_dtype  = DBR_LONG;
     pv[PV_PID].my_dtype              = DBR_LONG;
     pv[PV_HOSTNAME].my_dtype         = DBR_STRING;
     pv[PV_DIR].my_dtype              = DBR_STRING;
@@ -365,7 +680,28 @@ int pv_array_init(void)
     pv[PV_CHEN].my_dtype             = DBR_CHAR;
     pv[PV_RESTART].my_dtype          = DBR_CHAR;
     pv[PV_DATA_FILENAME].my_dtype    = DBR_CHAR;
+    pv[PV_FILTER_DROPPED].my_dtype   = DBR_LONG;
+    pv[PV_ROLLOVER_MAX].my_dtype     = DBR_FLOAT;
+    pv[PV_ROLLOVER_MEAN].my_dtype    = DBR_FLOAT;
+    pv[PV_RX_LATENCY].my_dtype       = DBR_LONG;
+    pv[PV_RX_GAP].my_dtype           = DBR_LONG;
     pv[PV_SPEC_FILENAME].my_dtype    = DBR_CHAR;
+    pv[PV_RATE_100MS].my_dtype       = DBR_FLOAT;
+    pv[PV_RATE_1S].my_dtype          = DBR_FLOAT;
+    pv[PV_RATE_10S].my_dtype         = DBR_FLOAT;
+    pv[PV_TOTAL_RATE_100MS].my_dtype = DBR_DOUBLE;
+    pv[PV_TOTAL_RATE_1S].my_dtype    = DBR_DOUBLE;
+    pv[PV_TOTAL_RATE_10S].my_dtype   = DBR_DOUBLE;
+    pv[PV_ROI_COUNTS].my_dtype       = DBR_LONG;
+    pv[PV_CAL_MCA].my_dtype          = DBR_LONG;
+    pv[PV_CAL_SUM].my_dtype          = DBR_LONG;
+    pv[PV_TSLICE_MCA].my_dtype       = DBR_LONG;
+    pv[PV_TSLICE_INDEX].my_dtype     = DBR_LONG;
+    pv[PV_COINC_MULT].my_dtype       = DBR_LONG;
+    pv[PV_COINC_PAIRS].my_dtype      = DBR_LONG;
+    pv[PV_PUR_MCA].my_dtype          = DBR_LONG;
+    pv[PV_DEAD_TIME].my_dtype        = DBR_FLOAT;
+    pv[PV_LIVE_TIME].my_dtype        = DBR_FLOAT;
     //pv[PV_DATA_FILENAME].my_dtype    = DBR_STRING;
     //pv[PV_SPEC_FILENAME].my_dtype    = DBR_STRING;
    
@@ -386,7 +722,7 @@ int main(int argc, char* argv[])
 
     //-----------------------------------------------------------
 
-    char* op_string = "t::d::h::";
+    char* op_string = "t::d::h::r:p:P";
 
     while ((opt = getopt(argc, argv, op_string))!= -1)
     {
@@ -399,11 +735,23 @@ int main(int argc, char* argv[])
                 reg1_val = 0x3;
                 log("start in test mode. FPGA will send test data.\n");
                 break;
+            case 'r':
+                snprintf(replay_path, sizeof(replay_path), "%s", optarg);
+                break;
+            case 'p':
+                replay_tick_ns = strtod(optarg, NULL);
+                break;
+            case 'P':
+                perf_enabled = 1;
+                break;
             case 'h':
                 printf("Usage:\n");
-                printf("    germ_udp_daemon [-t] [-d]\n");
+                printf("    germ_udp_daemon [-t] [-d] [-P] [-r DIR/FILENAME.RUNNO [-p ns]]\n");
                 printf("        -t  : enable test mode.\n");
                 printf("        -d  : enable dummy data.\n");
+                printf("        -r  : replay the raw segments of a run instead of receiving.\n");
+                printf("        -p  : replay at the recorded rate, timestamp period in ns.\n");
+                printf("        -P  : report hardware counters of the pipeline threads per frame.\n");
                 break;
             default:
                 break;
@@ -416,6 +764,19 @@ int main(int argc, char* argv[])
 
     memset(mca, 0, sizeof(mca));
     memset(tdc, 0, sizeof(tdc));
+    memset(rate, 0, sizeof(rate));
+    memset(total_rate, 0, sizeof(total_rate));
+    memset(roi_counts, 0, sizeof(roi_counts));
+    memset(cal_mca, 0, sizeof(cal_mca));
+    memset(cal_sum, 0, sizeof(cal_sum));
+    memset(tslice_mca, 0, sizeof(tslice_mca));
+    tslice_index = 0;
+    memset(coinc_mult, 0, sizeof(coinc_mult));
+    memset(coinc_pairs, 0, sizeof(coinc_pairs));
+    memset(pur_mca, 0, sizeof(pur_mca));
+    memset(dead_time, 0, sizeof(dead_time));
+    memset(live_time, 0, sizeof(live_time));
+    memset(filter_dropped, 0, sizeof(filter_dropped));
     memset(gige_ip_addr, 0, sizeof(gige_ip_addr));
     memset(hostname, 0, sizeof(hostname));
     memset(directory, 0, sizeof(directory));
@@ -469,6 +830,23 @@ int main(int argc, char* argv[])
     //-----------------------------------------------------------
     buff_init();
 
+    //-----------------------------------------------------------
+    // Publish an empty run configuration, filled in by exp_mon.
+    //-----------------------------------------------------------
+    if (0 != run_cfg_init())
+    {
+        err("failed to initialize the run configuration.\n");
+        return -1;
+    }
+
+    //-----------------------------------------------------------
+    // Keep the last packets for dumps on anomalies.
+    //-----------------------------------------------------------
+    if (0 != flightrec_init())
+    {
+        err("no flight recorder.\n");
+    }
+
     //-----------------------------------------------------------
     // Create threads.
     //-----------------------------------------------------------
@@ -490,30 +868,17 @@ int main(int argc, char* argv[])
 		strerror(status));
     }
 
-    
-    //-----------------------------------------------------------
-    // Initialize mutexes.
-    //-----------------------------------------------------------
-    if (pthread_mutex_init(&tmp_datafile_dir_lock, NULL) != 0) {
-        fprintf(stderr, "Mutex initialization failed\n");
-        return 1;
-    }
-    if (pthread_mutex_init(&datafile_dir_lock, NULL) != 0) {
-        fprintf(stderr, "Mutex initialization failed\n");
-        return 1;
-    }
-    if (pthread_mutex_init(&filename_lock, NULL) != 0) {
-        fprintf(stderr, "Mutex initialization failed\n");
-        return 1;
-    }
 
     //-------------------------------------------------------------------
     // Create udp_conn_thread to configure FPGA and receive data through
-    // UDP connection.
+    // UDP connection, or replay_thread to read recorded segments instead.
     log("creating udp_conn_thread...\n");
     while(1)
     {
-        status = pthread_create(&tid[1], NULL, &udp_conn_thread, NULL);
+        status = pthread_create( &tid[1],
+                                 NULL,
+                                 replay_path[0] ? &replay_thread : &udp_conn_thread,
+                                 NULL );
         if ( 0 == status)
         {
             log("udp_conn_thread created.\n");
@@ -542,6 +907,23 @@ int main(int argc, char* argv[])
 		strerror(status));
     }
 
+    //-------------------------------------------------------------------
+    // Create data_proc_thread to calculate spectra and count rates.
+    log("creating data_proc_thread...\n");
+    while(1)
+    {
+        status = pthread_create(&tid[3], NULL, &data_proc_thread, NULL);
+        if ( 0 == status)
+        {
+            log("data_proc_thread created.\n");
+            break;
+        }
+
+        err("Can't create data_proc_thread: [%s]\n",
+	            __func__,
+		strerror(status));
+    }
+
     log("finished initialization.\n");
 
     //-----------------------------------------------------------
@@ -14,6 +14,16 @@
 #define RETRY_ON_FAILURE  5
 #define MAX_FILENAME_LEN  255
 #define PREFIX_CFG_FILE  "prefix.cfg"
+#define ROI_CFG_FILE     "roi.cfg"
+#define CALIB_CFG_FILE   "calib.cfg"
+#define TSLICE_CFG_FILE  "tslice.cfg"
+#define COINC_CFG_FILE   "coinc.cfg"
+#define PILEUP_CFG_FILE  "pileup.cfg"
+#define FILTER_CFG_FILE  "filter.cfg"
+#define OUTPUT_CFG_FILE  "output.cfg"
+#define FLIGHTREC_CFG_FILE "flightrec.cfg"
+#define TRACE_CFG_FILE   "trace.cfg"
+#define TRACE_DUMP_FILE  "trace.dump"
 
 
 //###########################################################
@@ -57,18 +67,48 @@
 #define PV_IPADDR_RBV         23
 #define PV_NELM_RBV           24
 #define PV_MONCH_RBV          25
+#define PV_MOVE_PENDING       26
+#define PV_MOVE_DONE          27
+#define PV_MOVE_FAILED        28
+#define PV_MOVE_RATE          29
+#define PV_FRAME_HIST_NUM     30
+#define PV_FRAME_HIST_MBPS    31
+#define PV_FRAME_HIST_EVPS    32
+#define PV_FRAME_HIST_MISS    33
+#define PV_FRAME_HIST_LOST    34
 
 //-----------------------------------------------------------
 // Read/written by data_write_thread.
 //-----------------------------------------------------------
-#define PV_DATA_FILENAME      26
+#define PV_DATA_FILENAME      35
+#define PV_FILTER_DROPPED     36
+#define PV_ROLLOVER_MAX       37
+#define PV_ROLLOVER_MEAN      38
+#define PV_RX_LATENCY         39
+#define PV_RX_GAP             40
 
 //-----------------------------------------------------------
 // Read/written by data_proc_thread.
 //-----------------------------------------------------------
-#define PV_MCA                27
-#define PV_TDC                28
-#define PV_SPEC_FILENAME      29
+#define PV_MCA                41
+#define PV_TDC                42
+#define PV_SPEC_FILENAME      43
+#define PV_RATE_100MS         44
+#define PV_RATE_1S            45
+#define PV_RATE_10S           46
+#define PV_TOTAL_RATE_100MS   47
+#define PV_TOTAL_RATE_1S      48
+#define PV_TOTAL_RATE_10S     49
+#define PV_ROI_COUNTS         50
+#define PV_CAL_MCA            51
+#define PV_CAL_SUM            52
+#define PV_TSLICE_MCA         53
+#define PV_TSLICE_INDEX       54
+#define PV_COINC_MULT         55
+#define PV_COINC_PAIRS        56
+#define PV_PUR_MCA            57
+#define PV_DEAD_TIME          58
+#define PV_LIVE_TIME          59
 
 
 //===========================================================
@@ -78,22 +118,22 @@
 #define MAX_PV_NAME_LEN      256
 #define MAX_NELM             384
 
-#define NUM_PVS               30
+#define NUM_PVS               60
 
 #define FIRST_MAIN_PV          0
 #define LAST_MAIN_PV           3
 
 #define FIRST_EXP_MON_PV       4
-#define LAST_EXP_MON_PV       25
+#define LAST_EXP_MON_PV       34
 
 #define FIRST_EXP_MON_RD_PV    4
 #define LAST_EXP_MON_RD_PV    19
 
-#define FIRST_DATA_WRITE_PV   26
-#define LAST_DATA_WRITE_PV    26
+#define FIRST_DATA_WRITE_PV   35
+#define LAST_DATA_WRITE_PV    40
 
-#define FIRST_DATA_PROC_PV    27
-#define LAST_DATA_PROC_PV     29
+#define FIRST_DATA_PROC_PV    41
+#define LAST_DATA_PROC_PV     59
 
 #define FIRST_ENV_PV          PV_PID
 #define LAST_ENV_PV           PV_DIR
@@ -135,6 +175,8 @@ typedef struct
     uint8_t             status;
     uint16_t            length;
     uint32_t            runno;
+    uint32_t            rx_latency;     // ns from kernel receive to recvmsg()
+    uint64_t            rx_ns;          // kernel receive time, CLOCK_REALTIME
     uint8_t             packet[MAX_PACKET_LENGTH];
 } packet_buff_t;
 
@@ -161,6 +203,14 @@ typedef struct
 #define NUM_TDC_ROW   MAX_NELM
 #define NUM_TDC_COL       1024
 
+// calibrated spectra, one extra count at the end for out of range events
+#define NUM_CAL_ROW   MAX_NELM
+#define NUM_CAL_COL       4096
+
+// coincidence histograms, the last multiplicity bin takes all higher ones
+#define COINC_MAX_MULT      32
+#define NUM_COINC_PAIRS   (MAX_NELM * MAX_NELM)
+
 //===========================================================
 
 //#define TRACE_CA
@@ -178,6 +228,8 @@ extern char ca_dtype[7][11];
                               999 ))))))
 
 //###########################################################
+// The *_async variants only queue the request. They are used by threads
+// that can't afford the sleep; the caller flushes with ca_flush_io().
 #ifdef TRACE_CA
 #define pv_get(i)                                                                               \
     printf("[%s]: read %s as %s\n", __func__, pv[i].my_name, ca_dtype[pv[i].my_dtype]);         \
@@ -198,6 +250,14 @@ extern char ca_dtype[7][11];
     printf("[%s]: write %s as %d %s\n", __func__, pv[i].my_name, n, ca_dtype[pv[i].my_dtype]);  \
     SEVCHK(ca_array_put(pv[i].my_dtype, n, pv[i].my_chid, pv[i].my_var_p), "Put failed");       \
     ca_flush_io(); sleep(1)
+
+#define pv_put_async(i)                                                                         \
+    printf("[%s]: queue %s as %s\n", __func__, pv[i].my_name, ca_dtype[pv[i].my_dtype]);        \
+    SEVCHK(ca_put(pv[i].my_dtype, pv[i].my_chid, pv[i].my_var_p), "Put failed")
+
+#define pvs_put_async(i, n)                                                                     \
+    printf("[%s]: queue %s as %d %s\n", __func__, pv[i].my_name, n, ca_dtype[pv[i].my_dtype]);  \
+    SEVCHK(ca_array_put(pv[i].my_dtype, n, pv[i].my_chid, pv[i].my_var_p), "Put failed")
 //-----------------------------------------------------------
 #else
 #define pv_get(i)                                                                               \
@@ -215,6 +275,12 @@ extern char ca_dtype[7][11];
 #define pvs_put(i, n)                                                                           \
     SEVCHK(ca_array_put(pv[i].my_dtype, n, pv[i].my_chid, pv[i].my_var_p), "Put failed");       \
     ca_flush_io(); sleep(1)
+
+#define pv_put_async(i)                                                                         \
+    SEVCHK(ca_put(pv[i].my_dtype, pv[i].my_chid, pv[i].my_var_p), "Put failed")
+
+#define pvs_put_async(i, n)                                                                     \
+    SEVCHK(ca_array_put(pv[i].my_dtype, n, pv[i].my_chid, pv[i].my_var_p), "Put failed")
 //-----------------------------------------------------------
 #endif // ifdef TRACE_CA
 //===========================================================
@@ -234,43 +300,47 @@ extern char ca_dtype[7][11];
 
 long int time_elapsed(struct timeval time_i, struct timeval time_f);
 
-//========================================================================
-// Read a mutex protected string.
-//========================================================================
-inline void read_protected_string( char * src,
-                                   char * dest,
-                                   unsigned char len,
-                                   pthread_mutex_t * mutex_p )
-{
-    memset(dest, 0, len);
-    log("lock mutex for read.\n");
-    pthread_mutex_lock(mutex_p);
-    strcpy(dest, src);
-    pthread_mutex_unlock(mutex_p);
-    log("mutex unlocked\n");
-}
-
-//========================================================================
-// Write a mutex protected string.
-//========================================================================
-inline void write_protected_string( char * src,
-                                    char * dest,
-                                    unsigned char len,
-                                    pthread_mutex_t * mutex_p )
-{
-    log("lock mutex for write.\n");
-    pthread_mutex_lock(mutex_p);
-    memset(dest, 0, len);
-    strcpy(dest, src);
-    pthread_mutex_unlock(mutex_p);
-    log("mutex unlocked\n");
-}
-
 void lock_buff_read(uint8_t idx, char check_val, const char* caller);
+int  trylock_buff_read(uint8_t idx, char check_val, const char* caller);
 void lock_buff_write(uint8_t idx, char check_val, const char* caller);
+int  trylock_buff_write(uint8_t idx, char check_val, const char* caller);
 void unlock_buff(uint8_t, const char* caller);
+int  buff_backlog(void);
 
 void create_channel(const char* thread, unsigned int first, unsigned int last_pv);
 
+#define CFG_UNCHANGED   0
+#define CFG_CHANGED     1
+#define CFG_REMOVED     2
+int cfg_file_changed(const char* file, struct timespec* last_mtime);
+
+// What is read from a configuration file goes to the thread using it
+// through an _Atomic pointer, <name>_pending. exp_mon_thread swaps the
+// new one in with atomic_exchange() and frees what it replaces, which
+// was never taken; the other thread takes it by swapping in NULL, and
+// owns it from then on. NULL thus means nothing new.
+
+// Configuration files are lines of '<key> <value>', '#' to the end of a
+// line a comment. cfg_read() stores the value of each key of a table
+// where its entry says, and warns of keys not in it.
+#define CFG_U64         0       // decimal, into a uint64_t
+#define CFG_U32         1       // decimal, into a uint32_t
+#define CFG_FLAG        2       // 0 or not, into a uint8_t
+#define CFG_BIT         3       // 0 or not, clears or sets 'arg' in a uint32_t
+#define CFG_STR         4       // into a char['arg'], left alone if too long
+#define CFG_FN          5       // passed to fn(dst, value)
+
+typedef struct
+{
+    const char * key;
+    uint8_t      type;
+    void       * dst;
+    uint32_t     arg;
+    void       (*fn)(void* dst, const char* val);
+} cfg_key_t;
+
+int cfg_read(const char* file, const cfg_key_t* keys, uint32_t num_keys);
+int parse_chan_list(char* str, uint8_t chans[MAX_NELM]);
+
 
 #endif
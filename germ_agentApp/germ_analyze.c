@@ -0,0 +1,447 @@
+/**
+ * File: germ_analyze.c
+ *
+ * Functionality: Offline spectra of a run from its raw segment files.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Native replacement of the analysis notebooks: all segments
+ *               of a run scanned in parallel, with the same results.
+ *
+ * Usage:
+ *
+ *   germ_analyze [-j threads] [-x] [-o prefix] DIR FILENAME RUNNO
+ *
+ * Scans the files of DIR matching FILENAME.RUNNO.segno.bin, as the
+ * notebook lists them (RUNNO as 10 digits, FILENAME taken as a pattern),
+ * each memory mapped and counted as its calc_spectra() does. Files are
+ * shared out over the threads (default: one per CPU), each counting into
+ * its own spectra, added up at the end.
+ *
+ * A file with an invalid chip number stops where it is found and is
+ * reported. Its counts up to there are kept, as when calc_spectra() is
+ * called in a loop; with -x they are taken out again, as when the
+ * notebook runs it in a process pool.
+ *
+ * Writes, with prefix DIR/FILENAME.RUNNO by default:
+ *
+ *   prefix.mca.dat     mca spectra, 384 x 4096    in the notebook's
+ *   prefix.tdc.dat     tdc spectra, 384 x 1024    text format
+ *   prefix.counts      events per channel
+ *   prefix.stats       files, events and losses
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <regex.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rawscan.h"
+
+#define MCA_BINS      (RAWSCAN_NUM_CHANS * RAWSCAN_MCA_SIZE)
+#define TDC_BINS      (RAWSCAN_NUM_CHANS * RAWSCAN_TDC_SIZE)
+#define MAX_PATH_LEN  4096
+
+typedef struct
+{
+    char      path[MAX_PATH_LEN];
+    uint64_t  size;
+} scan_file_t;
+
+static scan_file_t    * files;
+static uint32_t         num_files;
+static atomic_uint      next_file;
+static uint8_t          exclude_bad = 0;
+
+static pthread_mutex_t  total_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t       * total_mca;
+static uint64_t       * total_tdc;
+static rawscan_stats_t  total_stats;
+static uint64_t         total_bytes;
+
+
+//========================================================================
+static double mono_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+// Add a thread's spectra to the totals and clear them.
+//========================================================================
+static void flush_spectra(uint32_t* mca, uint32_t* tdc)
+{
+    pthread_mutex_lock(&total_lock);
+    for (uint32_t i=0; i<MCA_BINS; i++)
+    {
+        total_mca[i] += mca[i];
+    }
+    for (uint32_t i=0; i<TDC_BINS; i++)
+    {
+        total_tdc[i] += tdc[i];
+    }
+    pthread_mutex_unlock(&total_lock);
+
+    memset(mca, 0, MCA_BINS * sizeof(uint32_t));
+    memset(tdc, 0, TDC_BINS * sizeof(uint32_t));
+}
+
+
+//========================================================================
+// Scan files until there are none left. Spectra are counted in 32 bits,
+// and flushed before a file could overflow them.
+//========================================================================
+static void* scan_thread(void* arg)
+{
+    uint32_t        * mca;
+    uint32_t        * tdc;
+    uint64_t          pending = 0;     // events counted since the last flush, at most
+    rawscan_stats_t   stats;
+    rawscan_stats_t   file_stats;
+    uint64_t          bytes = 0;
+    uint32_t          idx;
+    scan_file_t     * f;
+    uint8_t         * data;
+    int               fd;
+
+    mca = calloc(MCA_BINS, sizeof(uint32_t));
+    tdc = calloc(TDC_BINS, sizeof(uint32_t));
+    if (NULL == mca || NULL == tdc)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    memset(&stats, 0, sizeof(stats));
+
+    while ((idx = atomic_fetch_add(&next_file, 1)) < num_files)
+    {
+        f = &files[idx];
+        if (0 == f->size)
+        {
+            continue;
+        }
+
+        fd = open(f->path, O_RDONLY);
+        if (fd < 0)
+        {
+            perror(f->path);
+            continue;
+        }
+        data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (MAP_FAILED == data)
+        {
+            perror(f->path);
+            continue;
+        }
+        madvise(data, f->size, MADV_SEQUENTIAL);
+
+        if (pending + f->size / 8 + 1 > UINT32_MAX)
+        {
+            flush_spectra(mca, tdc);
+            pending = 0;
+        }
+        pending += f->size / 8 + 1;
+
+        memset(&file_stats, 0, sizeof(file_stats));
+        if (0 != rawscan_spectra(data, f->size, mca, tdc, 1, &file_stats))
+        {
+            printf( "%s: chip %u at offset 0x%lx (event 0x%08x, timestamp 0x%08x)%s\n",
+                    f->path, file_stats.bad_event >> 27, file_stats.bad_offset,
+                    file_stats.bad_event, file_stats.bad_ts,
+                    exclude_bad ? ", left out" : "" );
+            if (exclude_bad)
+            {
+                // the same scan again, counted backwards
+                rawscan_spectra(data, f->size, mca, tdc, (uint32_t)-1, NULL);
+                file_stats.num_events = 0;
+            }
+        }
+        rawscan_stats_add(&stats, &file_stats);
+        bytes += f->size;
+
+        munmap(data, f->size);
+    }
+
+    flush_spectra(mca, tdc);
+    free(mca);
+    free(tdc);
+
+    pthread_mutex_lock(&total_lock);
+    rawscan_stats_add(&total_stats, &stats);
+    total_bytes += bytes;
+    pthread_mutex_unlock(&total_lock);
+
+    return NULL;
+}
+
+
+//========================================================================
+static int by_size(const void* a, const void* b)
+{
+    const scan_file_t * fa = (const scan_file_t*)a;
+    const scan_file_t * fb = (const scan_file_t*)b;
+
+    return (fa->size < fb->size) - (fa->size > fb->size);
+}
+
+
+//========================================================================
+// The segment files of a run, as the notebook's
+// mp_list_files_in_directory() finds them, largest first.
+//========================================================================
+static int list_files(const char* dir, const char* filename, uint32_t runno)
+{
+    char            pattern[MAX_PATH_LEN];
+    regex_t         re;
+    DIR           * d;
+    struct dirent * e;
+    struct stat     st;
+    scan_file_t   * more;
+    uint32_t        max_files = 0;
+
+    snprintf(pattern, sizeof(pattern), "%s.%010u.([0-9]{10})\\.bin", filename, runno);
+    if (0 != regcomp(&re, pattern, REG_EXTENDED | REG_NOSUB))
+    {
+        fprintf(stderr, "bad file name pattern %s\n", pattern);
+        return -1;
+    }
+
+    d = opendir(dir);
+    if (NULL == d)
+    {
+        perror(dir);
+        regfree(&re);
+        return -1;
+    }
+
+    while ((e = readdir(d)) != NULL)
+    {
+        if (0 != regexec(&re, e->d_name, 0, NULL, 0))
+        {
+            continue;
+        }
+        if (num_files == max_files)
+        {
+            max_files = max_files ? 2 * max_files : 256;
+            more      = realloc(files, max_files * sizeof(scan_file_t));
+            if (NULL == more)
+            {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+            files = more;
+        }
+        snprintf(files[num_files].path, MAX_PATH_LEN, "%s/%s", dir, e->d_name);
+        if (0 != stat(files[num_files].path, &st) || !S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+        files[num_files].size = st.st_size;
+        num_files++;
+    }
+
+    closedir(d);
+    regfree(&re);
+
+    // big ones first, so the threads finish together
+    qsort(files, num_files, sizeof(scan_file_t), by_size);
+    return 0;
+}
+
+
+//========================================================================
+// Spectra as the notebook writes mca.dat/tdc.dat.
+//========================================================================
+static int write_dat(const char* path, const uint64_t* counts, uint32_t n)
+{
+    FILE * fp = fopen(path, "w");
+
+    if (NULL == fp)
+    {
+        perror(path);
+        return -1;
+    }
+    fprintf(fp, "data %u ", n);
+    for (uint32_t i=0; i<n; i++)
+    {
+        fprintf(fp, "%lu ", counts[i]);
+    }
+    if (0 != fclose(fp))
+    {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+
+//========================================================================
+static int write_results(const char* prefix)
+{
+    char     path[MAX_PATH_LEN];
+    FILE   * fp;
+    uint64_t n;
+    int      ret = 0;
+
+    snprintf(path, sizeof(path), "%s.mca.dat", prefix);
+    ret |= write_dat(path, total_mca, MCA_BINS);
+    snprintf(path, sizeof(path), "%s.tdc.dat", prefix);
+    ret |= write_dat(path, total_tdc, TDC_BINS);
+
+    snprintf(path, sizeof(path), "%s.counts", prefix);
+    fp = fopen(path, "w");
+    if (NULL == fp)
+    {
+        perror(path);
+        return -1;
+    }
+    fprintf(fp, "# addr chip chan events\n");
+    for (uint32_t a=0; a<RAWSCAN_NUM_CHANS; a++)
+    {
+        n = 0;
+        for (uint32_t i=0; i<RAWSCAN_MCA_SIZE; i++)
+        {
+            n += total_mca[a * RAWSCAN_MCA_SIZE + i];
+        }
+        fprintf(fp, "%u %u %u %lu\n", a, a >> 5, a & 31, n);
+    }
+    ret |= fclose(fp);
+
+    snprintf(path, sizeof(path), "%s.stats", prefix);
+    fp = fopen(path, "w");
+    if (NULL == fp)
+    {
+        perror(path);
+        return -1;
+    }
+    fprintf(fp, "files            %u\n",  num_files);
+    fprintf(fp, "bytes            %lu\n", total_bytes);
+    fprintf(fp, "events           %lu\n", total_stats.num_events);
+    fprintf(fp, "frames_started   %lu\n", total_stats.num_sof);
+    fprintf(fp, "frames_ended     %lu\n", total_stats.num_eof);
+    fprintf(fp, "events_lost      %lu\n", total_stats.num_lost);
+    fprintf(fp, "pairs_dropped    %lu\n", total_stats.num_dropped);
+    fprintf(fp, "no_timestamp     %lu\n", total_stats.num_no_ts);
+    fprintf(fp, "zero_words       %lu\n", total_stats.num_zero);
+    fprintf(fp, "ignored_words    %lu\n", total_stats.num_ignored);
+    fprintf(fp, "bad_files        %u\n",  total_stats.num_bad);
+    ret |= fclose(fp);
+
+    return ret ? -1 : 0;
+}
+
+
+//========================================================================
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-x] [-o prefix] DIR FILENAME RUNNO\n", prog);
+    exit(1);
+}
+
+
+//========================================================================
+int main(int argc, char* argv[])
+{
+    int          num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char         prefix[MAX_PATH_LEN] = "";
+    const char * dir;
+    const char * filename;
+    uint32_t     runno;
+    pthread_t  * tids;
+    double       t0, t;
+    int          opt;
+
+    while ((opt = getopt(argc, argv, "j:xo:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j': num_threads = atoi(optarg); break;
+            case 'x': exclude_bad = 1; break;
+            case 'o': snprintf(prefix, sizeof(prefix), "%s", optarg); break;
+            default:  usage(argv[0]);
+        }
+    }
+    if (argc - optind != 3 || num_threads < 1)
+    {
+        usage(argv[0]);
+    }
+    dir      = argv[optind];
+    filename = argv[optind + 1];
+    runno    = strtoul(argv[optind + 2], NULL, 0);
+    if (0 == prefix[0])
+    {
+        snprintf(prefix, sizeof(prefix), "%s/%s.%010u", dir, filename, runno);
+    }
+
+    if (0 != list_files(dir, filename, runno))
+    {
+        return 1;
+    }
+    if (0 == num_files)
+    {
+        fprintf(stderr, "no segment files of run %u in %s\n", runno, dir);
+        return 1;
+    }
+    if ((uint32_t)num_threads > num_files)
+    {
+        num_threads = num_files;
+    }
+
+    total_mca = calloc(MCA_BINS, sizeof(uint64_t));
+    total_tdc = calloc(TDC_BINS, sizeof(uint64_t));
+    tids      = calloc(num_threads, sizeof(pthread_t));
+    if (NULL == total_mca || NULL == total_tdc || NULL == tids)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    t0 = mono_sec();
+    for (int i=0; i<num_threads; i++)
+    {
+        if (0 != pthread_create(&tids[i], NULL, scan_thread, NULL))
+        {
+            fprintf(stderr, "failed to start thread %d\n", i);
+            return 1;
+        }
+    }
+    for (int i=0; i<num_threads; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    t = mono_sec() - t0;
+
+    printf( "%u files, %.1f MB, %lu events in %.2f s (%.1f MB/s, %d threads)\n",
+            num_files, total_bytes / 1e6, total_stats.num_events, t,
+            total_bytes / 1e6 / t, num_threads );
+    if (total_stats.num_bad)
+    {
+        printf("%u files with invalid chip numbers\n", total_stats.num_bad);
+    }
+
+    if (0 != write_results(prefix))
+    {
+        return 1;
+    }
+    printf("results in %s.{mca.dat,tdc.dat,counts,stats}\n", prefix);
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * File: germ_bcast_reader.c
+ *
+ * Functionality: Example reader of the live packet broadcast.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Follow a broadcast and report packets, events, frames and
+ *               packets lost, once a second.
+ *
+ * Usage:
+ *
+ *   germ_bcast_reader [-o] NAME
+ *
+ *   -o  start from the oldest packet in the ring instead of the newest
+ *
+ * Events are counted as in the packet decoder: pairs of an event word and
+ * a word with the timestamp flag, after the packet counter.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "bcast.h"
+
+#define TS_FLAG   0x80000000
+
+
+//========================================================================
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+static uint32_t count_events(const uint32_t* packet, int length)
+{
+    uint32_t n = 0;
+
+    for (int i=2; i+1<length/4; i+=2)
+    {
+        n += !(ntohl(packet[i]) & TS_FLAG) && (ntohl(packet[i + 1]) & TS_FLAG);
+    }
+    return n;
+}
+
+
+//========================================================================
+int main(int argc, char* argv[])
+{
+    bcast_reader_t * r;
+    bcast_info_t     info;
+    uint32_t         packet[BCAST_MAX_PACKET / 4];
+    int              from_oldest = 0;
+    int              opt;
+    int              length;
+    uint64_t         packets = 0, bytes = 0, events = 0, frames = 0;
+    uint64_t         lost = 0;
+    double           t0, t;
+
+    while ((opt = getopt(argc, argv, "o")) != -1)
+    {
+        if ('o' == opt)
+        {
+            from_oldest = 1;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-o] NAME\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 1 != argc)
+    {
+        fprintf(stderr, "usage: %s [-o] NAME\n", argv[0]);
+        return 1;
+    }
+
+    r = bcast_attach(argv[optind], from_oldest);
+    if (NULL == r)
+    {
+        fprintf(stderr, "no broadcast %s\n", argv[optind]);
+        return 1;
+    }
+
+    t0 = now();
+    while (1)
+    {
+        length = bcast_next(r, packet, 1000, &info);
+        if (length < 0)
+        {
+            printf("broadcast closed\n");
+            break;
+        }
+        if (length > 0)
+        {
+            packets++;
+            bytes  += length;
+            events += count_events(packet, length);
+            frames += !!(info.flags & BCAST_PKT_SOF);
+        }
+
+        t = now();
+        if (t - t0 >= 1.0)
+        {
+            printf( "%.0f packets/s, %.1f MB/s, %.0f events/s, %lu frames started, %lu lost\n",
+                    packets / (t - t0),
+                    bytes * 1e-6 / (t - t0),
+                    events / (t - t0),
+                    frames,
+                    bcast_lost(r) - lost );
+            fflush(stdout);
+            lost    = bcast_lost(r);
+            packets = bytes = events = frames = 0;
+            t0      = t;
+        }
+    }
+
+    bcast_detach(r);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * File: germ_codec.c
+ *
+ * Functionality: Command line front end of the segment codec.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Compress, decompress and benchmark segment files.
+ *
+ * Usage:
+ *
+ *   germ_codec -c FILE...     compress to FILE.gsc
+ *   germ_codec -d FILE.gsc... decompress to FILE
+ *   germ_codec -b FILE...     report ratio and MB/s per core, no output
+ *
+ * Files ending in .evt are taken as clean segments, anything else as raw.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codec.h"
+
+#define CLEAN_EXT      ".evt"
+#define CLEAN_HDR_LEN  64
+
+
+//========================================================================
+static int ends_with(const char* s, const char* ext)
+{
+    size_t n = strlen(s), m = strlen(ext);
+
+    return n >= m && 0 == strcmp(s + n - m, ext);
+}
+
+
+//========================================================================
+static int compress_one(const char* file, const char* out, gsc_stats_t* stats)
+{
+    uint8_t clean = ends_with(file, CLEAN_EXT);
+
+    return gsc_compress_file( file,
+                              out,
+                              clean ? GSC_ORDER_HOST : GSC_ORDER_NET,
+                              clean ? CLEAN_HDR_LEN : 0,
+                              NULL,
+                              stats );
+}
+
+
+//========================================================================
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s -c|-d|-b FILE...\n", prog);
+    exit(1);
+}
+
+
+//========================================================================
+int main(int argc, char* argv[])
+{
+    char        out[4096];
+    char        tmp[4096];
+    gsc_stats_t enc, dec;
+    uint64_t    in_total = 0, out_total = 0;
+    double      enc_cpu = 0, dec_cpu = 0;
+    int         failed = 0;
+
+    if (argc < 3 || '-' != argv[1][0] || strlen(argv[1]) != 2)
+    {
+        usage(argv[0]);
+    }
+
+    for (int i=2; i<argc; i++)
+    {
+        const char * file = argv[i];
+
+        switch (argv[1][1])
+        {
+            case 'c':
+                snprintf(out, sizeof(out), "%s%s", file, GSC_EXT);
+                if (0 != compress_one(file, out, &enc))
+                {
+                    fprintf(stderr, "failed to compress %s\n", file);
+                    failed++;
+                    continue;
+                }
+                printf("%s: %.2f\n", out, (double)enc.in_bytes / enc.out_bytes);
+                break;
+
+            case 'd':
+                if (!ends_with(file, GSC_EXT))
+                {
+                    fprintf(stderr, "%s: not a %s file\n", file, GSC_EXT);
+                    failed++;
+                    continue;
+                }
+                snprintf(out, sizeof(out), "%.*s", (int)(strlen(file) - strlen(GSC_EXT)), file);
+                if (0 != gsc_decompress_file(file, out, &dec))
+                {
+                    fprintf(stderr, "failed to decompress %s\n", file);
+                    failed++;
+                    continue;
+                }
+                printf("%s\n", out);
+                break;
+
+            case 'b':
+                snprintf(tmp, sizeof(tmp), "%s.bench%d%s", file, (int)getpid(), GSC_EXT);
+                snprintf(out, sizeof(out), "%s.bench%d", file, (int)getpid());
+                if ( 0 != compress_one(file, tmp, &enc) ||
+                     0 != gsc_decompress_file(tmp, out, &dec) ||
+                     0 != gsc_verify_file(tmp, file) )
+                {
+                    fprintf(stderr, "%s: round trip failed\n", file);
+                    failed++;
+                }
+                else
+                {
+                    printf( "%-40s %12lu -> %12lu  ratio %6.2f  enc %7.1f MB/s  dec %7.1f MB/s\n",
+                            file, enc.in_bytes, enc.out_bytes,
+                            (double)enc.in_bytes / enc.out_bytes,
+                            enc.in_bytes / 1e6 / enc.cpu_sec,
+                            dec.in_bytes / 1e6 / dec.cpu_sec );
+                    in_total  += enc.in_bytes;
+                    out_total += enc.out_bytes;
+                    enc_cpu   += enc.cpu_sec;
+                    dec_cpu   += dec.cpu_sec;
+                }
+                unlink(tmp);
+                unlink(out);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if ('b' == argv[1][1] && out_total)
+    {
+        printf( "%-40s %12lu -> %12lu  ratio %6.2f  enc %7.1f MB/s  dec %7.1f MB/s (per core)\n",
+                "total", in_total, out_total,
+                (double)in_total / out_total,
+                in_total / 1e6 / enc_cpu,
+                in_total / 1e6 / dec_cpu );
+    }
+
+    return failed ? 1 : 0;
+}
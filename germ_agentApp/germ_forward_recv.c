@@ -0,0 +1,266 @@
+/**
+ * File: germ_forward_recv.c
+ *
+ * Functionality: Receiver of a forwarded packet stream, for tests.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Accept forwarded streams, check them and report the rate and
+ *               the packets dropped by the sender.
+ *
+ * Usage:
+ *
+ *   germ_forward_recv [-1] [-o FILE] PORT|/PATH
+ *
+ *   -1       exit after the first connection closes
+ *   -o FILE  append the packets to FILE, as a raw segment holds them
+ *
+ * Listens on TCP port PORT, or on a Unix socket at /PATH, and prints once a
+ * second the packets and MB/s received and the packets missing from the
+ * sequence, i.e. dropped by the sender.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "forward.h"
+
+#define RECV_BUFF_SIZE   (4 << 20)
+
+
+typedef struct
+{
+    uint64_t  packets;
+    uint64_t  bytes;
+    uint64_t  missing;
+} recv_count_t;
+
+
+//========================================================================
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+static int listen_on(const char* addr)
+{
+    struct sockaddr_un sun;
+    struct sockaddr_in sin;
+    int                fd;
+    int                one = 1;
+
+    if ('/' == addr[0])
+    {
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        snprintf(sun.sun_path, sizeof(sun.sun_path), "%s", addr);
+        unlink(addr);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || 0 != bind(fd, (struct sockaddr*)&sun, sizeof(sun)))
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family      = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_ANY);
+        sin.sin_port        = htons(atoi(addr));
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (0 != bind(fd, (struct sockaddr*)&sin, sizeof(sin)))
+        {
+            return -1;
+        }
+    }
+
+    return (0 == listen(fd, 1)) ? fd : -1;
+}
+
+
+//========================================================================
+static void report(const char* what, const recv_count_t* c, double sec)
+{
+    printf( "%s%.0f packets/s, %.1f MB/s, %lu missing\n",
+            what,
+            c->packets / sec,
+            c->bytes * 1e-6 / sec,
+            c->missing );
+    fflush(stdout);
+}
+
+
+//========================================================================
+// Take one stream until the sender closes it. Returns -1 on a malformed
+// stream.
+//========================================================================
+static int receive(int fd, uint8_t* buff, FILE* out, recv_count_t* total)
+{
+    recv_count_t  sec = { 0 }, conn = { 0 };
+    fwd_rec_t     rec;
+    size_t        have = 0, used, length;
+    ssize_t       n;
+    uint64_t      next = 0, seq;
+    int           first = 1;
+    int           ret = 0;
+    double        t0 = now(), t_conn = t0, t;
+
+    while (1)
+    {
+        n = recv(fd, buff + have, RECV_BUFF_SIZE - have, 0);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        have      += n;
+        sec.bytes += n;
+
+        for (used=0; have - used >= sizeof(fwd_rec_t); used+=sizeof(fwd_rec_t) + length)
+        {
+            memcpy(&rec, buff + used, sizeof(rec));
+            length = ntohl(rec.length);
+            if (FWD_MAGIC != ntohl(rec.magic) || length > FWD_MAX_PACKET)
+            {
+                fprintf(stderr, "bad record at packet %lu, closing\n", next);
+                ret = -1;
+                goto done;
+            }
+            if (have - used < sizeof(fwd_rec_t) + length)
+            {
+                break;
+            }
+
+            seq = be64toh(rec.seq);
+            if (!first && seq != next)
+            {
+                sec.missing += seq - next;
+            }
+            first = 0;
+            next  = seq + 1;
+            sec.packets++;
+
+            if (out)
+            {
+                fwrite(buff + used + sizeof(fwd_rec_t), 1, length, out);
+            }
+        }
+        memmove(buff, buff + used, have - used);
+        have -= used;
+
+        t = now();
+        if (t - t0 >= 1.0)
+        {
+            report("", &sec, t - t0);
+            conn.packets += sec.packets;
+            conn.bytes   += sec.bytes;
+            conn.missing += sec.missing;
+            memset(&sec, 0, sizeof(sec));
+            t0 = t;
+        }
+    }
+
+done:
+    conn.packets += sec.packets;
+    conn.bytes   += sec.bytes;
+    conn.missing += sec.missing;
+    report("connection closed: ", &conn, now() - t_conn);
+    printf("    %lu packets, %lu bytes\n", conn.packets, conn.bytes);
+
+    total->packets += conn.packets;
+    total->bytes   += conn.bytes;
+    total->missing += conn.missing;
+    return ret;
+}
+
+
+//========================================================================
+int main(int argc, char* argv[])
+{
+    recv_count_t  total = { 0 };
+    FILE        * out = NULL;
+    uint8_t     * buff;
+    int           once = 0;
+    int           opt;
+    int           lfd, fd;
+
+    while ((opt = getopt(argc, argv, "1o:")) != -1)
+    {
+        switch (opt)
+        {
+            case '1':
+                once = 1;
+                break;
+            case 'o':
+                out = fopen(optarg, "ab");
+                if (NULL == out)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-1] [-o FILE] PORT|/PATH\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind + 1 != argc)
+    {
+        fprintf(stderr, "usage: %s [-1] [-o FILE] PORT|/PATH\n", argv[0]);
+        return 1;
+    }
+
+    buff = malloc(RECV_BUFF_SIZE);
+    lfd  = listen_on(argv[optind]);
+    if (NULL == buff || lfd < 0)
+    {
+        fprintf(stderr, "can't listen on %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    do
+    {
+        fd = accept(lfd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        receive(fd, buff, out, &total);
+        close(fd);
+    } while (!once);
+
+    if (out)
+    {
+        fclose(out);
+    }
+    close(lfd);
+    free(buff);
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * File: germ_stripe_bench.c
+ *
+ * Functionality: Benchmark of the striped segment writers.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Aggregate write rate over 1 to N target directories;
+ *               Rate relative to one target, and a warning when
+ *               directories share a device.
+ *
+ * Usage:
+ *
+ *   germ_stripe_bench [-t total_MB] [-s segment_MB] DIR...
+ *
+ * For k = 1 to the number of directories, writes total_MB in packet
+ * sized pieces as segments striped over the first k directories, each
+ * segment synced to disk before it counts as done, and reports MB/s and
+ * the ratio to the rate on one target. Directories on the same device
+ * are reported, since striping over them shows no scaling. The files are
+ * removed afterwards.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "germ.h"
+#include "stripe.h"
+
+#define BENCH_PIECE   8192     // about a packet
+
+
+static atomic_uint num_done;
+static atomic_uint num_failed;
+
+
+//========================================================================
+static void bench_done(void* arg, int status)
+{
+    if (0 != status)
+    {
+        atomic_fetch_add(&num_failed, 1);
+    }
+    atomic_fetch_add(&num_done, 1);
+}
+
+
+//========================================================================
+static double mono_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+int main(int argc, char* argv[])
+{
+    uint64_t       total_mb = 4096, seg_mb = 256;
+    uint32_t       num_dirs, num_segs;
+    char           path[MAX_FILENAME_LEN];
+    uint32_t       piece[BENCH_PIECE / 4];
+    stripe_seg_t * seg;
+    double         t0, t;
+    double         rate, rate_one = 0;
+    struct stat    st[STRIPE_MAX_TARGETS];
+    int            opt;
+
+    while ((opt = getopt(argc, argv, "t:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': total_mb = strtoull(optarg, NULL, 0); break;
+            case 's': seg_mb   = strtoull(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-t total_MB] [-s segment_MB] DIR...\n", argv[0]);
+                return 1;
+        }
+    }
+    num_dirs = argc - optind;
+    if (0 == num_dirs || num_dirs > STRIPE_MAX_TARGETS || 0 == seg_mb)
+    {
+        fprintf(stderr, "usage: %s [-t total_MB] [-s segment_MB] DIR... (1 to %d)\n",
+                argv[0], STRIPE_MAX_TARGETS);
+        return 1;
+    }
+    num_segs = (total_mb + seg_mb - 1) / seg_mb;
+
+    for (uint32_t i=0; i<num_dirs; i++)
+    {
+        if (0 != stat(argv[optind + i], &st[i]))
+        {
+            perror(argv[optind + i]);
+            return 1;
+        }
+        for (uint32_t j=0; j<i; j++)
+        {
+            if (st[i].st_dev == st[j].st_dev)
+            {
+                printf("warning: %s and %s are on the same device\n", argv[optind + j], argv[optind + i]);
+                break;
+            }
+        }
+    }
+
+    if (0 != stripe_init(1) || 0 != stripe_start(num_dirs))
+    {
+        return 1;
+    }
+
+    // event-like data, so nothing on the way can shortcut it
+    for (uint32_t i=0; i<BENCH_PIECE/4; i++)
+    {
+        piece[i] = (i & 1) ? (0x80000000 | (i * 37)) : (i * 2654435761u) >> 1;
+    }
+
+    printf("%u MB in %lu MB segments\n", num_segs * (uint32_t)seg_mb, seg_mb);
+    for (uint32_t k=1; k<=num_dirs; k++)
+    {
+        atomic_store(&num_done, 0);
+        atomic_store(&num_failed, 0);
+
+        t0 = mono_sec();
+        for (uint32_t s=0; s<num_segs; s++)
+        {
+            snprintf(path, MAX_FILENAME_LEN, "%s/stripe_bench.%010u.bin", argv[optind + s % k], s);
+            seg = stripe_open(path, s, s % k, 0);
+            if (NULL == seg)
+            {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            for (uint64_t b=0; b<(seg_mb << 20); b+=BENCH_PIECE)
+            {
+                piece[0] = b;
+                stripe_write(seg, piece, BENCH_PIECE);
+            }
+            stripe_close(seg, NULL, 0, NULL, s == num_segs-1, bench_done, NULL);
+        }
+        while (atomic_load(&num_done) < num_segs)
+        {
+            usleep(1000);
+        }
+        t        = mono_sec() - t0;
+        rate     = num_segs * seg_mb / t;
+        rate_one = (1 == k) ? rate : rate_one;
+
+        printf( "%u target%s: %8.1f MB/s  x%.2f%s\n",
+                k, (k > 1) ? "s" : " ",
+                rate, rate / rate_one,
+                atomic_load(&num_failed) ? "  (write errors)" : "" );
+
+        for (uint32_t s=0; s<num_segs; s++)
+        {
+            snprintf(path, MAX_FILENAME_LEN, "%s/stripe_bench.%010u.bin", argv[optind + s % k], s);
+            unlink(path);
+        }
+    }
+
+    return 0;
+}
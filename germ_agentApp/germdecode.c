@@ -0,0 +1,130 @@
+/**
+ * File: germdecode.c
+ *
+ * Functionality: Event decoding library for readers outside the daemon.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Stable C API over rawscan for Python/ctypes: spectra and
+ *               columns of raw segments, spectra of selected events.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "germdecode.h"
+#include "rawscan.h"
+
+
+_Static_assert(sizeof(gd_stats_t) == 128, "gd_stats_t is part of the ABI");
+_Static_assert(GD_NUM_CHANS == RAWSCAN_NUM_CHANS, "channels");
+_Static_assert(GD_MCA_SIZE == RAWSCAN_MCA_SIZE, "mca size");
+_Static_assert(GD_TDC_SIZE == RAWSCAN_TDC_SIZE, "tdc size");
+
+
+//========================================================================
+static void stats_add(gd_stats_t* total, const rawscan_stats_t* s)
+{
+    if (!total)
+    {
+        return;
+    }
+
+    total->num_events  += s->num_events;
+    total->num_sof     += s->num_sof;
+    total->num_eof     += s->num_eof;
+    total->num_lost    += s->num_lost;
+    total->num_dropped += s->num_dropped;
+    total->num_no_ts   += s->num_no_ts;
+    total->num_zero    += s->num_zero;
+    total->num_ignored += s->num_ignored;
+    if (s->num_bad)
+    {
+        total->num_bad    += s->num_bad;
+        total->bad_offset  = s->bad_offset;
+        total->bad_event   = s->bad_event;
+        total->bad_ts      = s->bad_ts;
+    }
+}
+
+
+//========================================================================
+uint32_t gd_abi_version(void)
+{
+    return GD_ABI_VERSION;
+}
+
+
+//========================================================================
+uint64_t gd_max_events(uint64_t size)
+{
+    // every event takes two whole words
+    return size / 8;
+}
+
+
+//========================================================================
+int32_t gd_spectra( const void  * data,
+                    uint64_t      size,
+                    uint32_t    * mca,
+                    uint32_t    * tdc,
+                    gd_stats_t  * stats )
+{
+    rawscan_stats_t s;
+    int             ret;
+
+    memset(&s, 0, sizeof(s));
+    ret = rawscan_spectra(data, size, mca, tdc, 1, &s);
+    stats_add(stats, &s);
+
+    return ret;
+}
+
+
+//========================================================================
+uint64_t gd_events( const void  * data,
+                    uint64_t      size,
+                    uint16_t    * addr,
+                    uint16_t    * td,
+                    uint16_t    * pd,
+                    uint32_t    * ts,
+                    gd_stats_t  * stats )
+{
+    rawscan_stats_t s;
+    uint64_t        num;
+
+    memset(&s, 0, sizeof(s));
+    rawscan_events(data, size, addr, td, pd, ts, &num, &s);
+    stats_add(stats, &s);
+
+    return num;
+}
+
+
+//========================================================================
+uint64_t gd_accumulate( const uint16_t * addr,
+                        const uint16_t * td,
+                        const uint16_t * pd,
+                        uint64_t         num,
+                        uint32_t       * mca,
+                        uint32_t       * tdc )
+{
+    uint64_t n = 0;
+
+    for (uint64_t i=0; i<num; i++)
+    {
+        if (addr[i] >= GD_NUM_CHANS || pd[i] >= GD_MCA_SIZE || td[i] >= GD_TDC_SIZE)
+        {
+            continue;
+        }
+        mca[addr[i] * GD_MCA_SIZE + pd[i]]++;
+        tdc[addr[i] * GD_TDC_SIZE + td[i]]++;
+        n++;
+    }
+
+    return n;
+}
@@ -0,0 +1,93 @@
+#ifndef _GERMDECODE_H_
+#define _GERMDECODE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//===========================================================
+// Event decoding for readers outside the daemon, Python
+// with ctypes and numpy in particular: libgermdecode.
+//
+// Everything works on buffers the caller owns (a file read
+// or memory-mapped, numpy arrays), in one call per buffer;
+// nothing is allocated and there are no callbacks. Raw
+// segments are decoded as calc_spectra() of
+// script/germ-datafile-analysis.ipynb does (see rawscan.h).
+//
+// The ABI is kept stable: only fixed-width types, no enums
+// or bit fields, gd_stats_t only grows into its reserved
+// words, and an incompatible change bumps GD_ABI_VERSION.
+// Readers should compare gd_abi_version() with the version
+// they were written for.
+//===========================================================
+
+#define GD_ABI_VERSION      1
+
+#define GD_NUM_CHANS        384     // addr: chip * 32 + channel
+#define GD_MCA_SIZE         4096    // pd bins per channel
+#define GD_TDC_SIZE         1024    // td bins per channel
+
+typedef struct
+{
+    uint64_t  num_events;       // decoded
+    uint64_t  num_sof;          // SOF + frame number skipped
+    uint64_t  num_eof;          // ended on EOF
+    uint64_t  num_lost;         // lost events reported before EOF
+    uint64_t  num_dropped;      // two words with the flag bit
+    uint64_t  num_no_ts;        // event words without a timestamp
+    uint64_t  num_zero;         // 0 after a timestamp
+    uint64_t  num_ignored;      // words ignored after a timestamp
+    uint64_t  num_bad;          // buffers stopped on an invalid chip
+    uint64_t  bad_offset;       // of its event word, in the last one
+    uint32_t  bad_event;
+    uint32_t  bad_ts;
+    uint64_t  reserved[5];
+} gd_stats_t;                   // 128 bytes
+
+uint32_t gd_abi_version(void);
+
+// Largest number of events in 'size' bytes of a raw segment:
+// the length gd_events() needs of its arrays.
+uint64_t gd_max_events(uint64_t size);
+
+// Add the spectra of one raw segment to 'mca' (GD_NUM_CHANS
+// x GD_MCA_SIZE) and 'tdc' (GD_NUM_CHANS x GD_TDC_SIZE),
+// both C order. 'stats' (may be NULL) is added to. Returns
+// 0, or -1 if stopped on an invalid chip.
+int32_t gd_spectra( const void  * data,
+                    uint64_t      size,
+                    uint32_t    * mca,
+                    uint32_t    * tdc,
+                    gd_stats_t  * stats );
+
+// Decode one raw segment into columns of gd_max_events(size)
+// entries each: addr, td, pd and the timestamp word as read,
+// flag bit included. 'stats' (may be NULL) is added to.
+// Returns the number of events; on an invalid chip, the ones
+// before it, with stats->num_bad counted.
+uint64_t gd_events( const void  * data,
+                    uint64_t      size,
+                    uint16_t    * addr,
+                    uint16_t    * td,
+                    uint16_t    * pd,
+                    uint32_t    * ts,
+                    gd_stats_t  * stats );
+
+// Add 'num' events in columns, as from gd_events() and then
+// selected, to the spectra. Events out of range are skipped.
+// Returns the number of events added.
+uint64_t gd_accumulate( const uint16_t * addr,
+                        const uint16_t * td,
+                        const uint16_t * pd,
+                        uint64_t         num,
+                        uint32_t       * mca,
+                        uint32_t       * tdc );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * File: mover.c
+ *
+ * Functionality: Move closed segments to the final data directory.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Rename or in-kernel copy from the temporary directory,
+ *               paced and limited so the writer keeps the disk;
+ *               Final directory taken from the run configuration snapshot;
+ *               Files never replaced at the destination, checked by the
+ *               rename itself rather than ahead of it.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
+#include "germ.h"
+#include "mover.h"
+#include "runcfg.h"
+#include "log.h"
+
+
+extern uint32_t move_pending;
+extern uint32_t move_done;
+extern uint32_t move_failed;
+extern float    move_rate;
+
+// Copies wait while more packet buffers than this are unwritten.
+#define MOVE_MAX_BACKLOG   (NUM_PACKET_BUFF / 4)
+
+static atomic_uint  rate_limit = ATOMIC_VAR_INIT(MOVE_DEFAULT_RATE);
+static atomic_uint  max_jobs   = ATOMIC_VAR_INIT(1);
+static atomic_ulong bytes_moved;
+
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  jobs_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t        num_jobs;
+
+static pthread_mutex_t pace_lock = PTHREAD_MUTEX_INITIALIZER;
+static double          pace_next;   // when the next chunk may go
+
+
+//========================================================================
+static double mono_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+//========================================================================
+// Set from output_cfg_poll(). Takes effect for the next chunk.
+//========================================================================
+void mover_set_limits(uint32_t rate_mb, uint32_t jobs)
+{
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+    if (jobs > MOVE_MAX_JOBS)
+    {
+        jobs = MOVE_MAX_JOBS;
+    }
+
+    atomic_store(&rate_limit, rate_mb);
+    atomic_store(&max_jobs, jobs);
+
+    pthread_mutex_lock(&jobs_lock);
+    pthread_cond_broadcast(&jobs_cond);
+    pthread_mutex_unlock(&jobs_lock);
+}
+
+
+//========================================================================
+// Wait for the turn of a chunk of 'len' bytes: all movers together stay
+// under the rate limit, and none runs while data_write_thread is behind.
+//========================================================================
+static void move_pace(size_t len)
+{
+    uint32_t rate = atomic_load(&rate_limit);
+    double   now, start;
+
+    while (buff_backlog() > MOVE_MAX_BACKLOG)
+    {
+        usleep(1000);
+    }
+
+    if (0 == rate)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pace_lock);
+    now = mono_sec();
+    if (pace_next < now)
+    {
+        pace_next = now;
+    }
+    start      = pace_next;
+    pace_next += (double)len / (rate * 1e6);
+    pthread_mutex_unlock(&pace_lock);
+
+    if (start > now)
+    {
+        usleep((start - now) * 1e6);
+    }
+}
+
+
+//========================================================================
+// Copy 'src' to 'dst' in the kernel, a chunk at a time. 'dst' is only
+// ever a FILE.part, so one left by an interrupted copy is overwritten.
+//========================================================================
+static int copy_file(const char* src, const char* dst)
+{
+    struct stat st;
+    int         in, out;
+    uint64_t    done = 0;
+    ssize_t     n;
+    uint8_t     use_sendfile = 0;
+
+    in = open(src, O_RDONLY);
+    if (in < 0 || 0 != fstat(in, &st))
+    {
+        err("failed to open %s\n", src);
+        if (in >= 0)
+        {
+            close(in);
+        }
+        return -1;
+    }
+    out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+    {
+        err("failed to create %s (%s)\n", dst, strerror(errno));
+        close(in);
+        return -1;
+    }
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    while (done < (uint64_t)st.st_size)
+    {
+        size_t len = st.st_size - done;
+
+        if (len > MOVE_CHUNK)
+        {
+            len = MOVE_CHUNK;
+        }
+        move_pace(len);
+
+        n = -1;
+        if (!use_sendfile)
+        {
+            n = copy_file_range(in, NULL, out, NULL, len, 0);
+            if (n < 0 && (EXDEV == errno || ENOSYS == errno || EINVAL == errno || EOPNOTSUPP == errno))
+            {
+                use_sendfile = 1;
+            }
+        }
+        if (use_sendfile)
+        {
+            n = sendfile(out, in, NULL, len);
+        }
+        if (n <= 0)
+        {
+            err("failed to copy %s to %s (%s)\n", src, dst, n < 0 ? strerror(errno) : "short file");
+            close(in);
+            close(out);
+            unlink(dst);
+            return -1;
+        }
+
+        // the copy is done with, keep it out of the page cache
+        posix_fadvise(in, done, n, POSIX_FADV_DONTNEED);
+        done += n;
+        atomic_fetch_add(&bytes_moved, n);
+    }
+    close(in);
+
+    if (0 != fsync(out) || 0 != close(out))
+    {
+        err("failed to write %s\n", dst);
+        unlink(dst);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+//========================================================================
+// rename() that fails with EEXIST instead of replacing 'dst'. Where the
+// kernel or file system has no RENAME_NOREPLACE, link() and unlink() do
+// the same. Fails with EXDEV across file systems, as rename() does.
+//========================================================================
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE  (1 << 0)
+#endif
+
+static int rename_noreplace(const char* src, const char* dst)
+{
+#ifdef SYS_renameat2
+    if (0 == syscall(SYS_renameat2, AT_FDCWD, src, AT_FDCWD, dst, RENAME_NOREPLACE))
+    {
+        return 0;
+    }
+    if (ENOSYS != errno && EINVAL != errno)
+    {
+        return -1;
+    }
+#endif
+    if (0 != link(src, dst))
+    {
+        return -1;
+    }
+    unlink(src);
+    return 0;
+}
+
+
+//========================================================================
+// Move one file into 'dir'. On success 'path' is updated. A file of the
+// same name already there is never replaced.
+//========================================================================
+static int move_file(char* path, const char* dir)
+{
+    char        dst[MAX_FILENAME_LEN];
+    char        part[MAX_FILENAME_LEN];
+    const char* base = strrchr(path, '/');
+    struct stat st;
+
+    base = base ? base + 1 : path;
+    if ( snprintf(dst,  MAX_FILENAME_LEN, "%s/%s", dir, base) >= MAX_FILENAME_LEN ||
+         snprintf(part, MAX_FILENAME_LEN, "%s.part", dst)     >= MAX_FILENAME_LEN )
+    {
+        err("%s/%s is too long\n", dir, base);
+        return -1;
+    }
+
+    if (0 == rename_noreplace(path, dst))
+    {
+        if (0 == stat(dst, &st))
+        {
+            atomic_fetch_add(&bytes_moved, st.st_size);
+        }
+    }
+    else if (EEXIST == errno)
+    {
+        err("%s already exists, %s not moved\n", dst, path);
+        return -1;
+    }
+    else if (EXDEV != errno)
+    {
+        err("failed to move %s to %s (%s)\n", path, dst, strerror(errno));
+        return -1;
+    }
+    else
+    {
+        // fail early rather than after copying; the rename still checks
+        if (0 == lstat(dst, &st))
+        {
+            err("%s already exists, %s not moved\n", dst, path);
+            return -1;
+        }
+        if (0 != copy_file(path, part))
+        {
+            return -1;
+        }
+        if (0 != rename_noreplace(part, dst))
+        {
+            if (EEXIST == errno)
+            {
+                err("%s already exists, %s not moved\n", dst, path);
+            }
+            else
+            {
+                err("failed to rename %s (%s)\n", part, strerror(errno));
+            }
+            unlink(part);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    strcpy(path, dst);
+    return 0;
+}
+
+
+//========================================================================
+// Segment pipeline stage. Does nothing if the final directory is not set
+// or is the temporary directory itself.
+//========================================================================
+int segment_move(seg_item_t* item)
+{
+    char              dir[MAX_FILENAME_LEN];
+    char              src_dir[MAX_FILENAME_LEN];
+    char            * slash;
+    struct stat       st_dst, st_src;
+    int               ret = 0;
+    const run_cfg_t * run;
+
+    run = run_cfg_acquire();
+    snprintf(dir, MAX_FILENAME_LEN, "%s", run->datafile_dir);
+    run_cfg_release();
+    if (0 == dir[0])
+    {
+        return 0;
+    }
+
+    snprintf(src_dir, MAX_FILENAME_LEN, "%s", item->path);
+    slash = strrchr(src_dir, '/');
+    if (slash)
+    {
+        *slash = 0;
+    }
+    else
+    {
+        strcpy(src_dir, ".");
+    }
+    if (0 != stat(dir, &st_dst) || !S_ISDIR(st_dst.st_mode))
+    {
+        err("data directory %s not found, %s not moved\n", dir, item->path);
+        return -1;
+    }
+    if (0 == stat(src_dir, &st_src) && st_src.st_dev == st_dst.st_dev && st_src.st_ino == st_dst.st_ino)
+    {
+        return 0;
+    }
+
+    //--------------------------------------------------
+    // Wait for a free job.
+    pthread_mutex_lock(&jobs_lock);
+    while (num_jobs >= atomic_load(&max_jobs))
+    {
+        pthread_cond_wait(&jobs_cond, &jobs_lock);
+    }
+    num_jobs++;
+    pthread_mutex_unlock(&jobs_lock);
+
+    // files made alongside first, so the segment shows up last
+    for (uint32_t i=0; i<item->num_side; i++)
+    {
+        if (0 != move_file(item->side[i], dir))
+        {
+            ret = -1;
+        }
+    }
+    if (0 != move_file(item->path, dir))
+    {
+        ret = -1;
+    }
+    else
+    {
+        log("%s moved\n", item->path);
+    }
+
+    pthread_mutex_lock(&jobs_lock);
+    num_jobs--;
+    pthread_cond_signal(&jobs_cond);
+    pthread_mutex_unlock(&jobs_lock);
+
+    return ret;
+}
+
+
+//========================================================================
+void mover_update_stats(double period)
+{
+    static uint64_t last_bytes = 0;
+
+    seg_stage_stats_t stats;
+    uint64_t          bytes = atomic_load(&bytes_moved);
+
+    seg_pipe_stats(SEG_MOVE, &stats);
+    move_pending = stats.pending;
+    move_done    = stats.done;
+    move_failed  = stats.failed + stats.skipped;
+    move_rate    = (period > 0) ? (bytes - last_bytes) / 1e6 / period : 0;
+    last_bytes   = bytes;
+}
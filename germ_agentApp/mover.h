@@ -0,0 +1,42 @@
+#ifndef _MOVER_H_
+#define _MOVER_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+#include "segpipe.h"
+
+//===========================================================
+// Move closed segments from the temporary data directory to
+// the final one (PV_DATAFILE_DIR).
+//
+// The last stage of the segment pipeline. The segment and
+// the files made alongside it are renamed when both
+// directories are on the same filesystem, and otherwise
+// copied in the kernel (copy_file_range, or sendfile where
+// that is not supported) to FILE.part, synced, renamed into
+// place and only then removed from the temporary directory.
+// An existing file in the final directory is never replaced.
+//
+// Copies are paced to a total rate shared by all movers, at
+// most a set number run at a time, and they pause while the
+// packet buffers back up. Set in OUTPUT_CFG_FILE:
+//
+//     move_rate  <MB/s>   total copy rate, 0 for no limit
+//                         (default MOVE_DEFAULT_RATE)
+//     move_jobs  <n>      segments moved at a time, 1 to
+//                         MOVE_MAX_JOBS (default 1)
+//===========================================================
+
+#define MOVE_MAX_JOBS        4
+#define MOVE_DEFAULT_RATE  100      // MB/s
+#define MOVE_CHUNK         (4 << 20)
+
+void mover_set_limits(uint32_t rate_mb, uint32_t jobs);
+int  segment_move(seg_item_t* item);
+
+// Fill the MOVE_* PV variables. 'period' is the time in seconds since
+// the last call, for the rate.
+void mover_update_stats(double period);
+
+#endif
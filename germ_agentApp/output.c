@@ -0,0 +1,139 @@
+/**
+ * File: output.c
+ *
+ * Functionality: Data output options.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Options read from OUTPUT_CFG_FILE, reloaded when the file
+ *               changes and handed to data_write_thread by pointer swap.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "output.h"
+#include "mover.h"
+#include "log.h"
+
+
+_Atomic(output_cfg_t*) output_cfg_pending = ATOMIC_VAR_INIT(NULL);
+
+
+//========================================================================
+static void set_format(void* dst, const char* val)
+{
+    output_cfg_t * cfg = (output_cfg_t*)dst;
+
+    if      (0 == strcmp(val, "raw"))    cfg->format = OUTPUT_RAW;
+    else if (0 == strcmp(val, "clean"))  cfg->format = OUTPUT_CLEAN;
+    else
+    {
+        warn("unknown format %s in %s\n", val, OUTPUT_CFG_FILE);
+    }
+}
+
+
+//========================================================================
+static void add_stripe(void* dst, const char* val)
+{
+    output_cfg_t * cfg = (output_cfg_t*)dst;
+
+    if (cfg->num_stripes < STRIPE_MAX_TARGETS)
+    {
+        snprintf(cfg->stripe[cfg->num_stripes++], MAX_FILENAME_LEN, "%s", val);
+    }
+    else
+    {
+        warn("more than %d stripe targets in %s\n", STRIPE_MAX_TARGETS, OUTPUT_CFG_FILE);
+    }
+}
+
+
+//========================================================================
+// Reload OUTPUT_CFG_FILE if it has changed. Removing the file restores
+// the defaults.
+//========================================================================
+void output_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    output_cfg_t * cfg;
+    output_cfg_t * old;
+    int            status;
+    uint32_t       move_rate = MOVE_DEFAULT_RATE;
+    uint32_t       move_jobs = 1;
+
+    status = cfg_file_changed(OUTPUT_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        return;
+    }
+
+    cfg = calloc(1, sizeof(output_cfg_t));
+    if (NULL == cfg)
+    {
+        return;
+    }
+    cfg->format         = OUTPUT_RAW;
+    cfg->forward_buffer = FWD_DEFAULT_BUFFER;
+
+    cfg_key_t keys[] =
+    {
+        { "format",           CFG_FN,   cfg,                    0, set_format },
+        { "index",            CFG_BIT,  &cfg->stages,           SEG_INDEX     },
+        { "columnar",         CFG_BIT,  &cfg->stages,           SEG_COLUMNAR  },
+        { "compress",         CFG_BIT,  &cfg->stages,           SEG_COMPRESS  },
+        { "move",             CFG_BIT,  &cfg->stages,           SEG_MOVE      },
+        { "move_rate",        CFG_U32,  &move_rate                            },
+        { "move_jobs",        CFG_U32,  &move_jobs                            },
+        { "stripe",           CFG_FN,   cfg,                    0, add_stripe },
+        { "broadcast",        CFG_STR,  cfg->broadcast,         BCAST_MAX_NAME   },
+        { "forward",          CFG_STR,  cfg->forward,           MAX_FILENAME_LEN },
+        { "forward_buffer",   CFG_U32,  &cfg->forward_buffer                  },
+        { "forward_zerocopy", CFG_FLAG, &cfg->forward_zerocopy                },
+    };
+
+    if (CFG_CHANGED == status && 0 != cfg_read(OUTPUT_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0])))
+    {
+        free(cfg);
+        return;
+    }
+
+    info( "%s data output%s%s%s%s from the next frame.\n",
+          (OUTPUT_CLEAN == cfg->format) ? "clean" : "raw",
+          (cfg->stages & SEG_INDEX)    ? ", indexed"           : "",
+          (cfg->stages & SEG_COLUMNAR) ? ", with columnar copy" : "",
+          (cfg->stages & SEG_COMPRESS) ? ", compressed"        : "",
+          (cfg->stages & SEG_MOVE)     ? ", moved"             : "" );
+
+    for (uint32_t i=0; i<cfg->num_stripes; i++)
+    {
+        info("segment %u of every %u to %s\n", i, cfg->num_stripes, cfg->stripe[i]);
+    }
+
+    if (cfg->broadcast[0])
+    {
+        info("packets broadcast to %s from the next frame\n", cfg->broadcast);
+    }
+
+    if (cfg->forward[0])
+    {
+        info( "packets forwarded to %s from the next frame, %u MB buffer%s\n",
+              cfg->forward, cfg->forward_buffer, cfg->forward_zerocopy ? ", zerocopy" : "" );
+    }
+
+    // the mover limits apply straight away
+    mover_set_limits(move_rate, move_jobs);
+
+    old = atomic_exchange(&output_cfg_pending, cfg);
+    free(old);
+}
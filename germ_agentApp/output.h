@@ -0,0 +1,62 @@
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "segpipe.h"
+#include "stripe.h"
+#include "bcast.h"
+#include "forward.h"
+
+//===========================================================
+// Data output options.
+//
+// OUTPUT_CFG_FILE:
+//
+//     format    raw|clean   raw packets to .bin files, or
+//                           event/timestamp pairs only to
+//                           .evt files (default raw)
+//     index     0|1         index of each segment (default 0)
+//     columnar  0|1         columnar copy of each closed
+//                           segment (default 0)
+//     compress  0|1         replace each closed segment with
+//                           a compressed FILE.gsc (default 0)
+//     move      0|1         move each closed segment to the
+//                           final data directory (default 0)
+//     move_rate <MB/s>      see mover.h
+//     move_jobs <n>         see mover.h
+//     stripe    <dir>       a target directory for striped
+//                           segments, one line each, up to
+//                           STRIPE_MAX_TARGETS (see stripe.h)
+//     broadcast <name>      publish packets to shared memory
+//                           /name for local readers (see
+//                           bcast.h)
+//     forward   <addr>      also send packets to host:port
+//                           or a Unix socket (see forward.h)
+//     forward_buffer   <MB>
+//     forward_zerocopy 0|1
+//===========================================================
+
+#define OUTPUT_RAW      0
+#define OUTPUT_CLEAN    1
+
+typedef struct
+{
+    uint8_t   format;
+    uint32_t  stages;       // SEG_* for closed segments
+    uint32_t  num_stripes;  // 0: temporary data directory only
+    char      stripe[STRIPE_MAX_TARGETS][MAX_FILENAME_LEN];
+    char      broadcast[BCAST_MAX_NAME];    // empty: none
+    char      forward[MAX_FILENAME_LEN];    // empty: none
+    uint32_t  forward_buffer;               // MB
+    uint8_t   forward_zerocopy;
+} output_cfg_t;
+
+// New options from output_cfg_poll(), taken by data_write_thread.
+extern _Atomic(output_cfg_t*) output_cfg_pending;
+
+void output_cfg_poll(void);
+
+#endif
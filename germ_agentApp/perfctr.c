@@ -0,0 +1,205 @@
+/**
+ * File: perfctr.c
+ *
+ * Functionality: Hardware counter profiling of the pipeline threads.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : perf_event counters opened per thread with -P, and their
+ *               deltas reported per frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "germ.h"
+#include "perfctr.h"
+#include "log.h"
+
+#define PERF_NUM_EVENTS   5
+#define PERF_EV_CYCLES    0
+#define PERF_EV_INSTR     1
+
+extern uint8_t perf_enabled;
+
+static const struct
+{
+    uint32_t     type;
+    uint64_t     config;
+    const char * name;
+} events[PERF_NUM_EVENTS] =
+{
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles"           },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions"     },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache misses"     },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch misses"    },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context switches" },
+};
+
+typedef struct
+{
+    char      name[32];
+    int       fd[PERF_NUM_EVENTS];          // -1 if not available
+    uint8_t   user_only[PERF_NUM_EVENTS];
+    uint64_t  last[PERF_NUM_EVENTS];
+} perf_thread_t;
+
+static perf_thread_t    threads[PERF_MAX_THREADS];
+static int              num_threads = 0;
+static pthread_mutex_t  perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+//========================================================================
+// Open a counter of the calling thread, on any CPU.
+//========================================================================
+static int open_counter(uint32_t type, uint64_t config, uint8_t* user_only)
+{
+    struct perf_event_attr attr;
+    int                    fd;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size        = sizeof(attr);
+    attr.type        = type;
+    attr.config      = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_hv  = 1;
+
+    *user_only = 0;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0 && (EACCES == errno || EPERM == errno))
+    {
+        attr.exclude_kernel = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        *user_only = (fd >= 0);
+    }
+    return fd;
+}
+
+
+//========================================================================
+// Count so far, scaled up for the time the counter was multiplexed out.
+//========================================================================
+static uint64_t read_counter(int fd)
+{
+    uint64_t v[3];      // value, time enabled, time running
+
+    if (sizeof(v) != read(fd, v, sizeof(v)))
+    {
+        return 0;
+    }
+    if (v[2] && v[2] < v[1])
+    {
+        return (uint64_t)((double)v[0] * v[1] / v[2]);
+    }
+    return v[0];
+}
+
+
+//========================================================================
+// Open the counters of the calling thread, if profiling.
+//========================================================================
+void perf_thread_init(const char* name)
+{
+    perf_thread_t * t;
+    int             num = 0;
+
+    if (!perf_enabled)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&perf_mutex);
+    if (num_threads >= PERF_MAX_THREADS)
+    {
+        pthread_mutex_unlock(&perf_mutex);
+        warn("no counters for %s, %d threads profiled already\n", name, PERF_MAX_THREADS);
+        return;
+    }
+    t = &threads[num_threads];
+    snprintf(t->name, sizeof(t->name), "%s", name);
+
+    for (int i=0; i<PERF_NUM_EVENTS; i++)
+    {
+        t->fd[i]   = open_counter(events[i].type, events[i].config, &t->user_only[i]);
+        t->last[i] = (t->fd[i] >= 0) ? read_counter(t->fd[i]) : 0;
+        num       += (t->fd[i] >= 0);
+    }
+    num_threads++;
+    pthread_mutex_unlock(&perf_mutex);
+
+    if (num < PERF_NUM_EVENTS)
+    {
+        warn("%s: %d of %d counters available\n", name, num, PERF_NUM_EVENTS);
+    }
+    else
+    {
+        info("%s: counters open\n", name);
+    }
+}
+
+
+//========================================================================
+// Log what each profiled thread counted since the last report, in total
+// and per packet.
+//========================================================================
+void perf_report(uint32_t num_packets)
+{
+    perf_thread_t * t;
+    uint64_t        delta[PERF_NUM_EVENTS];
+    char            line[512];
+    int             len;
+
+    if (!perf_enabled)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&perf_mutex);
+    for (int n=0; n<num_threads; n++)
+    {
+        t   = &threads[n];
+        len = snprintf(line, sizeof(line), "perf %s:", t->name);
+
+        for (int i=0; i<PERF_NUM_EVENTS; i++)
+        {
+            if (t->fd[i] < 0)
+            {
+                continue;
+            }
+            delta[i]   = read_counter(t->fd[i]) - t->last[i];
+            t->last[i] += delta[i];
+
+            len += snprintf( line + len, sizeof(line) - len, " %s%s %lu (%.1f/packet),",
+                             events[i].name,
+                             t->user_only[i] ? ":u" : "",
+                             delta[i],
+                             num_packets ? (double)delta[i] / num_packets : 0.0 );
+            if (len >= (int)sizeof(line))
+            {
+                len = sizeof(line) - 1;
+            }
+        }
+
+        if (t->fd[PERF_EV_CYCLES] >= 0 && t->fd[PERF_EV_INSTR] >= 0 && delta[PERF_EV_CYCLES])
+        {
+            snprintf( line + len, sizeof(line) - len, " IPC %.2f",
+                      (double)delta[PERF_EV_INSTR] / delta[PERF_EV_CYCLES] );
+        }
+        else if (len > 0 && ',' == line[len - 1])
+        {
+            line[len - 1] = 0;
+        }
+        info("%s\n", line);
+    }
+    pthread_mutex_unlock(&perf_mutex);
+}
@@ -0,0 +1,33 @@
+#ifndef _PERFCTR_H_
+#define _PERFCTR_H_
+
+#include <stdint.h>
+
+//===========================================================
+// Hardware counter profiling of the pipeline threads.
+//
+// With germ_daemon -P, each pipeline thread opens its own
+// perf_event counters when it starts:
+//
+//     cycles, instructions, cache misses, branch misses,
+//     context switches
+//
+// and data_write_thread logs, at the end of each frame, what
+// each thread counted during it, per frame and per packet,
+// next to the receive timing (rxtime.h). Counters are only
+// read then, by read() on their descriptors, so nothing is
+// done per packet. Without -P nothing is opened at all.
+//
+// Counters the kernel refuses with kernel time included
+// (perf_event_paranoid > 1) are opened for user time only,
+// shown with a ':u'; those it refuses altogether are left
+// out. Counts are scaled up when the kernel had to multiplex
+// them.
+//===========================================================
+
+#define PERF_MAX_THREADS   8
+
+void perf_thread_init(const char* name);
+void perf_report(uint32_t num_packets);
+
+#endif
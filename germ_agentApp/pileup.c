@@ -0,0 +1,214 @@
+/**
+ * File: pileup.c
+ *
+ * Functionality: Pile-up rejection and dead-time estimation.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Per-channel inter-event intervals flag pile-up and add up
+ *               to a paralyzable dead time.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "pileup.h"
+#include "log.h"
+
+
+_Atomic(pileup_cfg_t*) pileup_cfg_pending = ATOMIC_VAR_INIT(NULL);
+
+
+//========================================================================
+pileup_t* pileup_create(const pileup_cfg_t* cfg, uint32_t* pur_mca)
+{
+    pileup_t * p;
+
+    p = calloc(1, sizeof(pileup_t));
+    if (NULL == p)
+    {
+        return NULL;
+    }
+
+    p->cfg     = *cfg;
+    p->pur_mca = pur_mca;
+
+    return p;
+}
+
+
+//========================================================================
+// Start a frame. The pile-up rejected spectra are cleared.
+//========================================================================
+void pileup_start(pileup_t* p)
+{
+    memset(p->pur_mca, 0, NUM_MCA_ROW*NUM_MCA_COL*sizeof(uint32_t));
+    memset(&p->unwrap, 0, sizeof(p->unwrap));
+    memset(p->held, 0, sizeof(p->held));
+    memset(p->dead_ticks, 0, sizeof(p->dead_ticks));
+    memset(p->num_piled, 0, sizeof(p->num_piled));
+    p->started = 0;
+}
+
+
+//========================================================================
+// Check each event against the previous one of its channel. O(1) per
+// event.
+//========================================================================
+void pileup_fill(pileup_t* p, const evt_batch_t* batch)
+{
+    uint64_t  t, dt;
+    uint16_t  ch;
+    uint8_t   piled;
+
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        t  = ts_unwrap(&p->unwrap, batch->ts[i]);
+        ch = batch->addr[i];
+
+        if (!p->started)
+        {
+            p->t_first = t;
+            p->t_last  = t;
+            p->started = 1;
+        }
+        if (t > p->t_last)
+        {
+            p->t_last = t;
+        }
+
+        piled = 0;
+        if (p->held[ch])
+        {
+            // events may come slightly out of order
+            dt = (t > p->held_t[ch]) ? t - p->held_t[ch] : p->held_t[ch] - t;
+            piled = (dt < p->cfg.resolve);
+            p->dead_ticks[ch] += piled ? dt : p->cfg.resolve;
+
+            if (piled | p->held_piled[ch])
+            {
+                p->num_piled[ch]++;
+            }
+            else
+            {
+                p->pur_mca[ch*NUM_MCA_COL + p->held_pd[ch]]++;
+            }
+        }
+
+        p->held[ch]       = 1;
+        p->held_piled[ch] = piled;
+        p->held_pd[ch]    = batch->pd[i];
+        p->held_t[ch]     = t;
+    }
+}
+
+
+//========================================================================
+// End of frame: let the held events go.
+//========================================================================
+void pileup_finish(pileup_t* p)
+{
+    uint64_t total = 0;
+
+    for (int ch=0; ch<NUM_CHANS; ch++)
+    {
+        if (p->held[ch])
+        {
+            if (p->held_piled[ch])
+            {
+                p->num_piled[ch]++;
+            }
+            else
+            {
+                p->pur_mca[ch*NUM_MCA_COL + p->held_pd[ch]]++;
+            }
+            p->held[ch] = 0;
+        }
+        total += p->num_piled[ch];
+    }
+
+    if (total)
+    {
+        info("%lu piled up events rejected\n", total);
+    }
+}
+
+
+//========================================================================
+// Dead fraction of each channel over the frame so far, and the live time
+// out of 'elapsed' seconds.
+//========================================================================
+void pileup_estimate(const pileup_t* p, double elapsed, float* dead_time, float* live_time)
+{
+    double span = p->started ? (double)(p->t_last - p->t_first) : 0.0;
+    double f;
+
+    for (int ch=0; ch<NUM_CHANS; ch++)
+    {
+        f = (span > 0) ? p->dead_ticks[ch] / span : 0.0;
+        if (f > 1.0)
+        {
+            f = 1.0;
+        }
+        dead_time[ch] = f;
+        live_time[ch] = elapsed * (1.0 - f);
+    }
+}
+
+
+//========================================================================
+// Reload PILEUP_CFG_FILE if it has changed. Removing the file, or a zero
+// resolving time, turns pile-up rejection off.
+//========================================================================
+void pileup_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    pileup_cfg_t * cfg;
+    pileup_cfg_t * old;
+    int            status;
+
+    status = cfg_file_changed(PILEUP_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        return;
+    }
+
+    cfg = calloc(1, sizeof(pileup_cfg_t));
+    if (NULL == cfg)
+    {
+        return;
+    }
+
+    cfg_key_t keys[] =
+    {
+        { "resolve", CFG_U64, &cfg->resolve },
+    };
+
+    if (CFG_CHANGED == status && 0 != cfg_read(PILEUP_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0])))
+    {
+        free(cfg);
+        return;
+    }
+
+    if (cfg->resolve)
+    {
+        info( "pile-up resolving time of %lu ticks, effective from the next frame.\n",
+              cfg->resolve );
+    }
+    else
+    {
+        info("pile-up rejection turned off.\n");
+    }
+
+    old = atomic_exchange(&pileup_cfg_pending, cfg);
+    free(old);
+}
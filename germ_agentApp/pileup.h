@@ -0,0 +1,65 @@
+#ifndef _PILEUP_H_
+#define _PILEUP_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Pile-up rejection and dead-time estimation.
+//
+// Two events of a channel closer than the resolving time are
+// both taken as piled up. The last event of each channel is
+// held back until the next one shows whether it piled up, so
+// each event is looked at once, against one neighbour.
+//
+// Events not piled up make the pile-up rejected spectra.
+//
+// Each event is taken to make its channel dead for the
+// resolving time, extended by any event within it
+// (paralyzable). The dead time of a channel is the sum of
+// min(interval, resolving time) over its events; the dead
+// fraction is that over the time spanned by the frame.
+//
+// PILEUP_CFG_FILE:
+//
+//     resolve <ticks>    resolving time in timestamp ticks
+//===========================================================
+
+typedef struct
+{
+    uint64_t  resolve;
+} pileup_cfg_t;
+
+typedef struct
+{
+    pileup_cfg_t  cfg;
+    ts_unwrap_t   unwrap;
+    uint8_t       started;
+    uint64_t      t_first;                 // span of the frame
+    uint64_t      t_last;
+
+    // event held back on each channel
+    uint8_t       held[NUM_CHANS];
+    uint8_t       held_piled[NUM_CHANS];
+    uint16_t      held_pd[NUM_CHANS];
+    uint64_t      held_t[NUM_CHANS];
+
+    uint64_t      dead_ticks[NUM_CHANS];
+    uint32_t      num_piled[NUM_CHANS];
+    uint32_t    * pur_mca;                 // pile-up rejected spectra
+} pileup_t;
+
+// New configuration from pileup_cfg_poll(), taken by the processing thread.
+extern _Atomic(pileup_cfg_t*) pileup_cfg_pending;
+
+void      pileup_cfg_poll(void);
+pileup_t* pileup_create(const pileup_cfg_t* cfg, uint32_t* pur_mca);
+void      pileup_start(pileup_t* p);
+void      pileup_fill(pileup_t* p, const evt_batch_t* batch);
+void      pileup_finish(pileup_t* p);
+void      pileup_estimate(const pileup_t* p, double elapsed, float* dead_time, float* live_time);
+
+#endif
@@ -0,0 +1,301 @@
+/**
+ * File: preopen.c
+ *
+ * Functionality: Segments opened ahead of use.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Helper thread preparing the next segment, so a rollover in
+ *               data_write_thread is a pointer swap.
+ *
+ *   v1.1
+ *     - Date  : Oct 2026
+ *     - Brief : Segments named from, and matched by, run configuration
+ *               snapshots;
+ *               Only new files prepared, emptied when taken, and removed
+ *               when unused for PREOPEN_IDLE_SEC or at exit.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "germ.h"
+#include "preopen.h"
+#include "data_write.h"
+#include "clean.h"
+#include "runcfg.h"
+#include "log.h"
+
+
+typedef struct
+{
+    uint32_t  run_num;
+    uint32_t  segment;
+    uint8_t   format;
+    uint32_t  target;
+    char      dir[MAX_FILENAME_LEN];    // empty for the temporary directory
+    uint32_t  gen;                      // of the run configuration named with
+} preopen_key_t;
+
+static pthread_mutex_t  lock      = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   want_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   idle_cond = PTHREAD_COND_INITIALIZER;
+
+static preopen_key_t    want;           // next to prepare
+static uint8_t          want_new = 0;
+static uint8_t          busy = 0;       // preparing, outside the lock
+static uint8_t          closing = 0;    // exiting, nothing more is kept
+
+static preopen_key_t    have_key;       // prepared
+static stripe_seg_t   * have = NULL;
+static uint64_t         have_base;
+static time_t           have_since;     // CLOCK_REALTIME, for the idle timeout
+
+static preopen_stats_t  stats;
+
+
+//========================================================================
+static void make_key( preopen_key_t      * key,
+                      uint32_t             run_num,
+                      uint32_t             segment,
+                      const output_cfg_t * output )
+{
+    memset(key, 0, sizeof(preopen_key_t));
+    key->run_num = run_num;
+    key->segment = segment;
+    key->format  = output->format;
+    if (output->num_stripes)
+    {
+        key->target = segment % output->num_stripes;
+        snprintf(key->dir, MAX_FILENAME_LEN, "%s", output->stripe[key->target]);
+    }
+}
+
+
+//========================================================================
+static void* preopen_thread(void* arg)
+{
+    preopen_key_t     key;
+    stripe_seg_t    * seg;
+    stripe_seg_t    * old;
+    const run_cfg_t * run;
+    char              path[MAX_FILENAME_LEN];
+    struct stat       st;
+    uint64_t          base;
+    struct timespec   deadline;
+
+    while (1)
+    {
+        pthread_mutex_lock(&lock);
+        while (!want_new)
+        {
+            if (NULL == have)
+            {
+                pthread_cond_wait(&want_cond, &lock);
+                continue;
+            }
+
+            // nothing came for the prepared segment: remove its file
+            deadline.tv_sec  = have_since + PREOPEN_IDLE_SEC;
+            deadline.tv_nsec = 0;
+            if ( ETIMEDOUT == pthread_cond_timedwait(&want_cond, &lock, &deadline)
+                 && have && !want_new && time(NULL) >= have_since + PREOPEN_IDLE_SEC )
+            {
+                old  = have;
+                have = NULL;
+                pthread_mutex_unlock(&lock);
+                log("%s unused for %d s, removed\n", old->path, PREOPEN_IDLE_SEC);
+                stripe_discard(old);
+                pthread_mutex_lock(&lock);
+            }
+        }
+        key      = want;
+        want_new = 0;
+        busy     = 1;
+        old      = have;
+        have     = NULL;
+        pthread_mutex_unlock(&lock);
+
+        if (old)
+        {
+            stripe_discard(old);
+        }
+
+        run = run_cfg_acquire();
+        create_datafile_name( path,
+                              run,
+                              key.dir[0] ? key.dir : NULL,
+                              key.run_num,
+                              key.segment,
+                              (OUTPUT_CLEAN == key.format) ? ".evt" : ".bin" );
+        key.gen = run->gen;
+        run_cfg_release();
+
+        seg = stripe_open(path, key.segment, key.target, OUTPUT_CLEAN != key.format);
+        if (seg && 0 != stripe_preopen(seg))
+        {
+            stripe_discard(seg);
+            seg = NULL;
+        }
+
+        base = sizeof(clean_hdr_t);
+        if (seg && OUTPUT_CLEAN != key.format)
+        {
+            base = (0 == fstat(seg->fd, &st)) ? st.st_size : 0;
+        }
+
+        // a newer request drops this one on the next pass
+        pthread_mutex_lock(&lock);
+        if (closing && seg)
+        {
+            stripe_discard(seg);
+            seg = NULL;
+        }
+        have       = seg;
+        have_key   = key;
+        have_base  = base;
+        have_since = time(NULL);
+        busy       = 0;
+        pthread_cond_broadcast(&idle_cond);
+        pthread_mutex_unlock(&lock);
+    }
+
+    return NULL;
+}
+
+
+//========================================================================
+// At exit, remove the file of a segment prepared but not taken.
+//========================================================================
+static void preopen_exit(void)
+{
+    stripe_seg_t * old;
+
+    pthread_mutex_lock(&lock);
+    closing  = 1;
+    want_new = 0;
+    while (busy)
+    {
+        pthread_cond_wait(&idle_cond, &lock);
+    }
+    old  = have;
+    have = NULL;
+    pthread_mutex_unlock(&lock);
+
+    if (old)
+    {
+        stripe_discard(old);
+    }
+}
+
+
+//========================================================================
+int preopen_init(void)
+{
+    pthread_t tid;
+
+    if (0 != pthread_create(&tid, NULL, preopen_thread, NULL))
+    {
+        err("failed to start the segment pre-opener\n");
+        return -1;
+    }
+    pthread_detach(tid);
+    atexit(preopen_exit);
+
+    return 0;
+}
+
+
+//========================================================================
+// Ask for a segment to be prepared. Replaces any earlier request.
+//========================================================================
+void preopen_request(uint32_t run_num, uint32_t segment, const output_cfg_t* output)
+{
+    preopen_key_t key;
+
+    make_key(&key, run_num, segment, output);
+
+    pthread_mutex_lock(&lock);
+    want     = key;
+    want_new = 1;
+    pthread_cond_signal(&want_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+
+//========================================================================
+stripe_seg_t* preopen_take( uint32_t             run_num,
+                            uint32_t             segment,
+                            const output_cfg_t * output,
+                            const run_cfg_t    * run,
+                            char               * datafile,
+                            uint64_t           * base )
+{
+    preopen_key_t   key;
+    stripe_seg_t  * seg = NULL;
+    stripe_seg_t  * stale = NULL;
+
+    make_key(&key, run_num, segment, output);
+    key.gen = run->gen;
+
+    // A segment being or about to be prepared could be the very file about
+    // to be opened the usual way: let it finish, and cancel a request not
+    // started yet. This only waits if the helper is behind, and then for no
+    // longer than opening the segment here would take.
+    pthread_mutex_lock(&lock);
+    want_new = 0;
+    while (busy)
+    {
+        pthread_cond_wait(&idle_cond, &lock);
+    }
+    if (have && 0 == memcmp(&have_key, &key, sizeof(key)))
+    {
+        seg   = have;
+        *base = have_base;
+        stats.num_taken++;
+    }
+    else
+    {
+        stale = have;
+        stats.num_missed++;
+    }
+    have = NULL;
+    pthread_mutex_unlock(&lock);
+
+    if (stale)
+    {
+        stripe_discard(stale);
+    }
+    if (seg)
+    {
+        // created empty by the helper, but emptied again now that it is
+        // certain to be used
+        if (!seg->append && 0 != ftruncate(seg->fd, 0))
+        {
+            warn("failed to truncate %s (%s)\n", seg->path, strerror(errno));
+        }
+        snprintf(datafile, MAX_FILENAME_LEN, "%s", seg->path);
+    }
+
+    return seg;
+}
+
+
+//========================================================================
+void preopen_get_stats(preopen_stats_t* s)
+{
+    pthread_mutex_lock(&lock);
+    *s = stats;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,55 @@
+#ifndef _PREOPEN_H_
+#define _PREOPEN_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+#include "output.h"
+#include "stripe.h"
+#include "runcfg.h"
+
+//===========================================================
+// Segments opened ahead of use.
+//
+// A helper thread names, creates and opens the segment that
+// data_write_thread will want next: the next segment of the
+// frame while one is being written, and segment 0 of the
+// next frame after the end of a frame. At the rollover the
+// writer only takes the prepared segment.
+//
+// A prepared segment is used only if it was made for the
+// same frame, segment, output format and target, and named
+// from the same run configuration snapshot the writer uses.
+// Otherwise it is dropped and the segment is opened the
+// usual way.
+//
+// Only files that don't exist yet are prepared, and they are
+// removed again when dropped, when not taken within
+// PREOPEN_IDLE_SEC (e.g. after the last frame), and at exit.
+// A segment whose file exists already is opened the usual
+// way.
+//===========================================================
+
+#define PREOPEN_IDLE_SEC   60
+
+typedef struct
+{
+    uint64_t  num_taken;        // prepared segments used
+    uint64_t  num_missed;       // opened the usual way
+} preopen_stats_t;
+
+int  preopen_init(void);
+void preopen_request(uint32_t run_num, uint32_t segment, const output_cfg_t* output);
+
+// The prepared segment if it matches, or NULL. 'datafile' and 'base'
+// are filled in as by open_segment().
+stripe_seg_t* preopen_take( uint32_t             run_num,
+                            uint32_t             segment,
+                            const output_cfg_t * output,
+                            const run_cfg_t    * run,
+                            char               * datafile,
+                            uint64_t           * base );
+
+void preopen_get_stats(preopen_stats_t* stats);
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * File: rate_meter.c
+ *
+ * Functionality: Per-channel count rates over sliding windows.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Windows of 100 ms / 1 s / 10 s maintained incrementally
+ *               on a fixed tick, independent of the event rate.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "germ.h"
+#include "rate_meter.h"
+#include "log.h"
+
+
+// window lengths in ticks
+static const uint32_t rate_win_ticks[RATE_NUM_WIN] = { 100/RATE_TICK_MS,
+                                                       1000/RATE_TICK_MS,
+                                                       10000/RATE_TICK_MS };
+
+//========================================================================
+void rate_meter_init(rate_meter_t* rm)
+{
+    memset(rm, 0, sizeof(rate_meter_t));
+}
+
+
+//========================================================================
+// Close the current tick. O(number of channels), once per RATE_TICK_MS.
+//========================================================================
+void rate_meter_tick(rate_meter_t* rm)
+{
+    uint32_t  out[RATE_NUM_WIN];
+    uint32_t *new_p;
+
+    // slot leaving each window once the new tick is in
+    for (int w=0; w<RATE_NUM_WIN; w++)
+    {
+        out[w] = (rm->head + RATE_HIST_LEN - rate_win_ticks[w]) % RATE_HIST_LEN;
+    }
+
+    new_p = rm->hist[rm->head];
+    for (int ch=0; ch<MAX_NELM; ch++)
+    {
+        // hist[head] still holds the oldest tick when the window
+        // covers the whole ring, so read before overwriting it.
+        for (int w=0; w<RATE_NUM_WIN; w++)
+        {
+            rm->sum[w][ch] += rm->count[ch];
+            rm->sum[w][ch] -= rm->hist[out[w]][ch];
+        }
+        new_p[ch] = rm->count[ch];
+    }
+    memset(rm->count, 0, sizeof(rm->count));
+
+    rm->head = (rm->head + 1) % RATE_HIST_LEN;
+    if (rm->num_ticks < RATE_HIST_LEN)
+    {
+        rm->num_ticks++;
+    }
+}
+
+
+//========================================================================
+// Convert the window sums to counts per second.
+//========================================================================
+void rate_meter_calc( rate_meter_t* rm,
+                      float         rate[RATE_NUM_WIN][MAX_NELM],
+                      double        total_rate[RATE_NUM_WIN] )
+{
+    uint32_t ticks;
+    double   scale;
+
+    for (int w=0; w<RATE_NUM_WIN; w++)
+    {
+        // windows are only partially filled right after start
+        ticks = rate_win_ticks[w];
+        if (rm->num_ticks < ticks)
+        {
+            ticks = rm->num_ticks;
+        }
+
+        total_rate[w] = 0;
+        if (0 == ticks)
+        {
+            memset(rate[w], 0, sizeof(float)*MAX_NELM);
+            continue;
+        }
+
+        scale = 1000.0 / (ticks * RATE_TICK_MS);
+        for (int ch=0; ch<MAX_NELM; ch++)
+        {
+            rate[w][ch]    = rm->sum[w][ch] * scale;
+            total_rate[w] += rm->sum[w][ch];
+        }
+        total_rate[w] *= scale;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef _RATE_METER_H_
+#define _RATE_METER_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Per-channel count rates over sliding windows.
+//
+// Events are counted per channel in the hot path. Every
+// RATE_TICK_MS the counts are pushed into a ring of per-tick
+// counts and the window sums are updated by adding the new
+// tick and subtracting the one that falls out of the window.
+//===========================================================
+
+#define RATE_TICK_MS            100    // base tick of the windows
+#define RATE_HIST_LEN           100    // ticks kept, covers the longest window
+#define RATE_PUB_PERIOD_MS     1000    // cadence of the rate PVs
+
+#define RATE_NUM_WIN              3
+#define RATE_WIN_100MS            0
+#define RATE_WIN_1S               1
+#define RATE_WIN_10S              2
+
+typedef struct
+{
+    uint32_t  count[MAX_NELM];                  // events since last tick
+    uint32_t  hist[RATE_HIST_LEN][MAX_NELM];    // per-tick counts
+    uint64_t  sum[RATE_NUM_WIN][MAX_NELM];      // counts within each window
+    uint32_t  head;                             // next slot in hist
+    uint32_t  num_ticks;                        // ticks since init, saturated
+} rate_meter_t;
+
+void rate_meter_init(rate_meter_t* rm);
+void rate_meter_tick(rate_meter_t* rm);
+void rate_meter_calc( rate_meter_t* rm,
+                      float         rate[RATE_NUM_WIN][MAX_NELM],
+                      double        total_rate[RATE_NUM_WIN] );
+
+//========================================================================
+// Count the events of a batch. O(1) per event.
+//========================================================================
+static inline void rate_meter_count(rate_meter_t* rm, const evt_batch_t* batch)
+{
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        rm->count[batch->addr[i]]++;
+    }
+}
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * File: rawscan.c
+ *
+ * Functionality: Offline scan of raw segment files.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Spectra of raw segments as the analysis notebook computes
+ *               them, with a checked fast path for runs of events.
+ *
+ *   v1.1
+ *     - Date  : Oct 2026
+ *     - Brief : Events as columns, from the same state machine.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "rawscan.h"
+
+
+// event word layout, as in event.h (kept here so this needs no EPICS)
+#define RS_TS_FLAG        0x80000000
+#define RS_SOF_MARKER     0xfeedface
+#define RS_EOF_MARKER     0xdecafbad
+#define RS_CHIP(e)        ((e) >> 27)
+#define RS_ADDR(e)        ((e) >> 22)
+#define RS_TD(e)          (((e) >> 12) & 0x3ff)
+#define RS_PD(e)          ((e) & 0xfff)
+
+// an event word with a valid chip has its top byte below this
+#define RS_CHIP_LIMIT     (RAWSCAN_NUM_CHIPS << 3)
+
+#define RS_GROUP_PAIRS    8
+#define RS_GROUP_BYTES    (RS_GROUP_PAIRS * 8)
+
+
+// where the events go: the spectra, or the columns
+typedef struct
+{
+    uint32_t  * mca;
+    uint32_t  * tdc;
+    uint32_t    inc;
+    uint16_t  * addr;
+    uint16_t  * td;
+    uint16_t  * pd;
+    uint32_t  * ts;
+    uint64_t    num;
+} rs_sink_t;
+
+
+//========================================================================
+static inline uint32_t be_word(const uint8_t* p)
+{
+    uint32_t w;
+
+    memcpy(&w, p, 4);
+    return ntohl(w);
+}
+
+
+//========================================================================
+static inline void put(rs_sink_t* k, const int columns, uint32_t event, uint32_t ts)
+{
+    if (columns)
+    {
+        k->addr[k->num] = RS_ADDR(event);
+        k->td[k->num]   = RS_TD(event);
+        k->pd[k->num]   = RS_PD(event);
+        k->ts[k->num]   = ts;
+        k->num++;
+    }
+    else
+    {
+        k->mca[RS_ADDR(event) * RAWSCAN_MCA_SIZE + RS_PD(event)] += k->inc;
+        k->tdc[RS_ADDR(event) * RAWSCAN_TDC_SIZE + RS_TD(event)] += k->inc;
+    }
+}
+
+
+//========================================================================
+// Whether the 8 pairs at 'p' are all events with a valid chip, i.e. each
+// event word's top byte is below RS_CHIP_LIMIT and each timestamp's has
+// the flag bit. Such pairs are counted the same by the state machine
+// wherever they are, so they can be counted directly.
+//========================================================================
+#if defined(__SSE2__)
+static inline int group_ok(const uint8_t* p)
+{
+    const __m128i limit = _mm_set1_epi8(RS_CHIP_LIMIT - 1);
+    __m128i       v;
+    int           ok = 1;
+
+    // bytes 0 and 8 of each 16 are event top bytes, 4 and 12 timestamp ones
+    for (int k=0; k<RS_GROUP_BYTES; k+=16)
+    {
+        v   = _mm_loadu_si128((const __m128i*)(p + k));
+        ok &= (0x0101 == (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, limit), v)) & 0x0101));
+        ok &= (0x1010 == (_mm_movemask_epi8(v) & 0x1010));
+    }
+    return ok;
+}
+#else
+static inline int group_ok(const uint8_t* p)
+{
+    int ok = 1;
+
+    for (int k=0; k<RS_GROUP_BYTES; k+=8)
+    {
+        ok &= (p[k] < RS_CHIP_LIMIT) & (p[k + 4] >> 7);
+    }
+    return ok;
+}
+#endif
+
+
+//========================================================================
+// Count groups of well formed events from 'p', up to 'num_groups'.
+// Returns the number of groups counted.
+//========================================================================
+static inline uint64_t scan_fast( const uint8_t * p,
+                                  uint64_t        num_groups,
+                                  rs_sink_t     * sink,
+                                  const int       columns )
+{
+    uint64_t n;
+
+    for (n=0; n<num_groups && group_ok(p); n++)
+    {
+        for (int k=0; k<RS_GROUP_BYTES; k+=8)
+        {
+            put(sink, columns, be_word(p + k), be_word(p + k + 4));
+        }
+        p += RS_GROUP_BYTES;
+    }
+    return n;
+}
+
+
+//========================================================================
+// Inlined into both callers with 'columns' a constant, so each gets a
+// loop of its own.
+//========================================================================
+static inline __attribute__((always_inline))
+int scan( const uint8_t   * data,
+          size_t            size,
+          rs_sink_t       * sink,
+          const int         columns,
+          rawscan_stats_t * stats )
+{
+    rawscan_stats_t s;
+    uint64_t        i = 0;      // bytes taken, as 'i' in the notebook
+    uint64_t        n;
+    uint8_t         first = 1;
+    uint32_t        event = 0;
+    uint32_t        word;
+    int             ret = 0;
+
+    memset(&s, 0, sizeof(s));
+
+    while (i < size)
+    {
+        if (first && size - i >= RS_GROUP_BYTES)
+        {
+            n = scan_fast(data + i, (size - i) / RS_GROUP_BYTES, sink, columns);
+            if (n)
+            {
+                i            += n * RS_GROUP_BYTES;
+                s.num_events += n * RS_GROUP_PAIRS;
+                continue;
+            }
+        }
+
+        if (size - i >= 4)
+        {
+            word = be_word(data + i);
+        }
+        else
+        {
+            // a short last word, as int.from_bytes() reads it
+            word = 0;
+            for (uint64_t k=i; k<size; k++)
+            {
+                word = (word << 8) | data[k];
+            }
+        }
+        i += 4;
+
+        if (first)
+        {
+            event = word;
+            first = 0;
+        }
+        else if (!(event & RS_TS_FLAG) && (word & RS_TS_FLAG))
+        {
+            first = 1;
+            if (RS_CHIP(event) >= RAWSCAN_NUM_CHIPS)
+            {
+                s.num_bad    = 1;
+                s.bad_offset = i - 8;
+                s.bad_event  = event;
+                s.bad_ts     = word;
+                ret = -1;
+                break;
+            }
+            put(sink, columns, event, word);
+            s.num_events++;
+        }
+        else if (RS_SOF_MARKER == event && i <= 16)
+        {
+            first = 1;
+            s.num_sof++;
+        }
+        else if (RS_EOF_MARKER == word && i == size)
+        {
+            s.num_eof++;
+            s.num_lost += event;
+            break;
+        }
+        else if ((event & RS_TS_FLAG) && (word & RS_TS_FLAG))
+        {
+            first = 1;
+            s.num_dropped++;
+        }
+        else if (!(event & RS_TS_FLAG) && !(word & RS_TS_FLAG))
+        {
+            event = word;
+            s.num_no_ts++;
+        }
+        else if (0 == word)
+        {
+            s.num_zero++;
+            if ((int64_t)i < (int64_t)size - 8)
+            {
+                first = 1;
+            }
+            else
+            {
+                event = 0;
+            }
+        }
+        else
+        {
+            s.num_ignored++;
+        }
+    }
+
+    if (stats)
+    {
+        rawscan_stats_add(stats, &s);
+    }
+    return ret;
+}
+
+
+//========================================================================
+int rawscan_spectra( const uint8_t   * data,
+                     size_t            size,
+                     uint32_t        * mca,
+                     uint32_t        * tdc,
+                     uint32_t          inc,
+                     rawscan_stats_t * stats )
+{
+    rs_sink_t sink;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.mca = mca;
+    sink.tdc = tdc;
+    sink.inc = inc;
+
+    return scan(data, size, &sink, 0, stats);
+}
+
+
+//========================================================================
+int rawscan_events( const uint8_t   * data,
+                    size_t            size,
+                    uint16_t        * addr,
+                    uint16_t        * td,
+                    uint16_t        * pd,
+                    uint32_t        * ts,
+                    uint64_t        * num,
+                    rawscan_stats_t * stats )
+{
+    rs_sink_t sink;
+    int       ret;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.addr = addr;
+    sink.td   = td;
+    sink.pd   = pd;
+    sink.ts   = ts;
+
+    ret  = scan(data, size, &sink, 1, stats);
+    *num = sink.num;
+    return ret;
+}
+
+
+//========================================================================
+void rawscan_stats_add(rawscan_stats_t* total, const rawscan_stats_t* stats)
+{
+    total->num_events  += stats->num_events;
+    total->num_sof     += stats->num_sof;
+    total->num_eof     += stats->num_eof;
+    total->num_lost    += stats->num_lost;
+    total->num_dropped += stats->num_dropped;
+    total->num_no_ts   += stats->num_no_ts;
+    total->num_zero    += stats->num_zero;
+    total->num_ignored += stats->num_ignored;
+    if (stats->num_bad)
+    {
+        total->num_bad    += stats->num_bad;
+        total->bad_offset  = stats->bad_offset;
+        total->bad_event   = stats->bad_event;
+        total->bad_ts      = stats->bad_ts;
+    }
+}
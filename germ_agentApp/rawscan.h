@@ -0,0 +1,92 @@
+#ifndef _RAWSCAN_H_
+#define _RAWSCAN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//===========================================================
+// Offline scan of raw segment files.
+//
+// rawscan_spectra() accumulates the mca/tdc spectra of one
+// raw segment exactly as calc_spectra() of
+// script/germ-datafile-analysis.ipynb does, so the results
+// of both are bit for bit the same. That function walks the
+// file as big-endian words with a small state machine:
+//
+//   - a word is taken as the event, the next one decides:
+//   - event without, word with the flag bit: an event,
+//     counted in mca[addr][pd] and tdc[addr][td]; a chip
+//     number of NUM_CHIPS or more stops the file (-1);
+//   - event is SOF within the first 16 bytes: SOF and frame
+//     number skipped;
+//   - word is EOF and the last one: end, with the event as
+//     the number of events lost;
+//   - both with the flag bit: both dropped;
+//   - both without: the word becomes the event;
+//   - the event with the flag bit, the word 0: both dropped
+//     before the last 8 bytes, after that the event becomes
+//     0. (The notebook stops with a NameError here, on a
+//     misspelt 'datasize'; this is what it meant to do.)
+//   - otherwise the word is ignored, the event kept.
+//
+// Counts wrap modulo 2^32 and are added as 'inc', so a scan
+// with inc = -1 takes a previous one back out.
+//
+// Runs of well formed events are checked 8 at a time with
+// SSE2 where available, and counted without the state
+// machine; the result is the same.
+//
+// rawscan_events() gives the same events as columns instead.
+//
+// This file and rawscan.c don't depend on EPICS.
+//===========================================================
+
+#define RAWSCAN_NUM_CHIPS      12
+#define RAWSCAN_NUM_CHANS      (RAWSCAN_NUM_CHIPS * 32)
+#define RAWSCAN_MCA_SIZE       4096     // per channel
+#define RAWSCAN_TDC_SIZE       1024
+
+typedef struct
+{
+    uint64_t  num_events;       // counted in the spectra
+    uint64_t  num_sof;          // SOF + frame number skipped
+    uint64_t  num_eof;          // ended on EOF
+    uint64_t  num_lost;         // lost events reported before EOF
+    uint64_t  num_dropped;      // two words with the flag bit
+    uint64_t  num_no_ts;        // event words without a timestamp
+    uint64_t  num_zero;         // 0 after a timestamp
+    uint64_t  num_ignored;      // words ignored after a timestamp
+    uint32_t  num_bad;          // files stopped on an invalid chip
+    uint64_t  bad_offset;       // of its event word, in the last one
+    uint32_t  bad_event;
+    uint32_t  bad_ts;
+} rawscan_stats_t;
+
+// 'mca' is RAWSCAN_NUM_CHANS x RAWSCAN_MCA_SIZE, 'tdc'
+// RAWSCAN_NUM_CHANS x RAWSCAN_TDC_SIZE. 'stats' (may be NULL)
+// is added to. Returns 0, or -1 if stopped on an invalid chip.
+int rawscan_spectra( const uint8_t   * data,
+                     size_t            size,
+                     uint32_t        * mca,
+                     uint32_t        * tdc,
+                     uint32_t          inc,
+                     rawscan_stats_t * stats );
+
+// The events rawscan_spectra() would count, in file order:
+// addr (chip * 32 + channel), td, pd, and the timestamp word
+// as read, flag bit included. Each array holds at least
+// size / 8 entries; '*num' is set to the number of events.
+// Returns as rawscan_spectra(), with the events before an
+// invalid chip kept.
+int rawscan_events( const uint8_t   * data,
+                    size_t            size,
+                    uint16_t        * addr,
+                    uint16_t        * td,
+                    uint16_t        * pd,
+                    uint32_t        * ts,
+                    uint64_t        * num,
+                    rawscan_stats_t * stats );
+
+void rawscan_stats_add(rawscan_stats_t* total, const rawscan_stats_t* stats);
+
+#endif
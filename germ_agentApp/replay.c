@@ -0,0 +1,369 @@
+/**
+ * File: replay.c
+ *
+ * Functionality: Offline replay of raw segments through the live pipeline.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Packets of recorded segments put into the packet buffers in
+ *               place of udp_conn_thread, as fast as possible or at the
+ *               recorded rate, and kept by the flight recorder as
+ *               received ones are, with the time they were put in as
+ *               their receive time;
+ *               Counters opened when profiling;
+ *               Buffer waits traced;
+ *               Never written back to the directory replayed from.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "germ.h"
+#include "event.h"
+#include "replay.h"
+#include "runcfg.h"
+#include "flightrec.h"
+#include "perfctr.h"
+#include "trace.h"
+#include "log.h"
+
+
+extern packet_buff_t packet_buff[NUM_PACKET_BUFF];
+
+extern char   replay_path[MAX_FILENAME_LEN];
+extern double replay_tick_ns;
+
+extern atomic_char exp_mon_thread_ready;
+extern atomic_char udp_conn_thread_ready;
+
+static replay_stats_t stats;
+
+
+//========================================================================
+static inline uint32_t be_word(const uint8_t* p)
+{
+    uint32_t w;
+
+    memcpy(&w, p, 4);
+    return ntohl(w);
+}
+
+
+//========================================================================
+static uint64_t now_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+//========================================================================
+// Length of the packet at 'p', with 'left' bytes to the end of the
+// segment: up to the next packet header, the end, or MAX_PACKET_LENGTH.
+//========================================================================
+static uint32_t packet_length(const uint8_t* p, uint64_t left)
+{
+    uint64_t limit = (left < MAX_PACKET_LENGTH + 8) ? left : MAX_PACKET_LENGTH + 8;
+
+    for (uint64_t n=8; n+8<=limit; n+=8)
+    {
+        // | SOF_MARKER | 0 | is the Start of Frame pair of frame 0
+        if (0 == be_word(p + n + 4) && SOF_MARKER != be_word(p + n))
+        {
+            return n;
+        }
+    }
+
+    if (left <= MAX_PACKET_LENGTH)
+    {
+        return left;
+    }
+    stats.num_cut++;
+    return MAX_PACKET_LENGTH;
+}
+
+
+//========================================================================
+// First timestamp of a packet, or -1 if it has no events.
+//========================================================================
+static int64_t first_ts(const uint8_t* p, uint32_t length)
+{
+    uint32_t event;
+    uint32_t ts;
+
+    for (uint32_t n=8; n+8<=length; n+=8)
+    {
+        event = be_word(p + n);
+        ts    = be_word(p + n + 4);
+        if (!(event & TS_FLAG) && (ts & TS_FLAG))
+        {
+            return ts & TS_MASK;
+        }
+    }
+    return -1;
+}
+
+
+//========================================================================
+// Hold the packet back until it is due at the recorded rate.
+//========================================================================
+static void pace(const uint8_t* p, uint32_t length)
+{
+    static ts_unwrap_t unwrap;
+    static uint64_t    ts0;
+    static uint64_t    t0;
+
+    struct timespec    due;
+    int64_t            ts;
+    uint64_t           t;
+
+    if (length >= 16 && SOF_MARKER == be_word(p + 8))
+    {
+        memset(&unwrap, 0, sizeof(unwrap));
+    }
+
+    ts = first_ts(p, length);
+    if (ts < 0)
+    {
+        return;
+    }
+
+    if (!unwrap.started)
+    {
+        ts0 = ts_unwrap(&unwrap, ts);
+        t0  = now_ns();
+        return;
+    }
+
+    t = t0 + (uint64_t)((ts_unwrap(&unwrap, ts) - ts0) * replay_tick_ns);
+    due.tv_sec  = t / 1000000000;
+    due.tv_nsec = t % 1000000000;
+    while (0 != clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL));
+}
+
+
+//========================================================================
+static void put_packet(uint8_t idx, const uint8_t* p, uint32_t length)
+{
+    packet_buff_t * buff_p = &(packet_buff[idx]);
+    struct timespec t;
+    uint64_t        t0 = trace_begin();
+
+    while (!trylock_buff_write(idx, DATA_WRITTEN | DATA_PROCCED, __func__))
+    {
+        sched_yield();
+    }
+    trace_end(TR_RING_WAIT, t0);
+
+    clock_gettime(CLOCK_REALTIME, &t);
+    memcpy(buff_p->packet, p, length);
+    buff_p->length     = length;
+    buff_p->rx_ns      = t.tv_sec * 1000000000UL + t.tv_nsec;
+    buff_p->rx_latency = 0;
+    flightrec_packet(p, length, buff_p->rx_ns);
+    buff_p->runno  = run_cfg_acquire()->runno;
+    run_cfg_release();
+
+    buff_p->status = 0;
+    unlock_buff(idx, __func__);
+}
+
+
+//========================================================================
+// Put the packets of one segment into the buffers. Returns -1 if the
+// segment doesn't exist.
+//========================================================================
+static int replay_segment(const char* path, uint8_t* write_buff)
+{
+    int             fd;
+    struct stat     st;
+    const uint8_t * data;
+    uint64_t        offset = 0;
+    uint32_t        length;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (0 != fstat(fd, &st) || 0 == st.st_size)
+    {
+        close(fd);
+        stats.num_files++;
+        return 0;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == data)
+    {
+        err("failed to map %s\n", path);
+        return 0;
+    }
+    madvise((void*)data, st.st_size, MADV_SEQUENTIAL);
+
+    info("replaying %s\n", path);
+    while (offset < (uint64_t)st.st_size)
+    {
+        length = packet_length(data + offset, st.st_size - offset);
+        if (replay_tick_ns > 0)
+        {
+            pace(data + offset, length);
+        }
+
+        put_packet(*write_buff, data + offset, length);
+        *write_buff = (*write_buff + 1) & PACKET_BUFF_MASK;
+
+        offset += length;
+        stats.num_packets++;
+    }
+    stats.num_bytes += st.st_size;
+    stats.num_files++;
+
+    munmap((void*)data, st.st_size);
+    return 0;
+}
+
+
+//========================================================================
+static void report(const char* what, uint64_t t0)
+{
+    double sec = (now_ns() - t0) * 1e-9;
+
+    info( "replay %s: %lu files, %lu packets (%lu cut), %.1f MB in %.3f s, "
+          "%.1f MB/s, %.0f packets/s\n",
+          what,
+          stats.num_files,
+          stats.num_packets,
+          stats.num_cut,
+          stats.num_bytes * 1e-6,
+          sec,
+          (sec > 0) ? stats.num_bytes * 1e-6 / sec : 0,
+          (sec > 0) ? stats.num_packets / sec : 0 );
+}
+
+
+//========================================================================
+// Whether 'dir' is the directory replayed from. Segments written there
+// could be the ones being read, raw ones being appended to.
+//========================================================================
+int replay_reads_from(const char* dir)
+{
+    char        src[MAX_FILENAME_LEN];
+    char      * slash;
+    struct stat st_src, st_dir;
+
+    if (0 == replay_path[0] || NULL == dir || 0 == dir[0])
+    {
+        return 0;
+    }
+
+    snprintf(src, sizeof(src), "%s", replay_path);
+    slash = strrchr(src, '/');
+    if (slash)
+    {
+        *slash = 0;
+    }
+    else
+    {
+        strcpy(src, ".");
+    }
+
+    return 0 == stat(src, &st_src) && 0 == stat(dir, &st_dir)
+           && st_src.st_dev == st_dir.st_dev && st_src.st_ino == st_dir.st_ino;
+}
+
+
+//========================================================================
+void* replay_thread(void* arg)
+{
+    struct timespec t1, t2;
+    char            path[MAX_FILENAME_LEN + 32];
+    uint8_t         write_buff = 0;
+    uint64_t        t0;
+    int             busy;
+    const run_cfg_t * run;
+
+    t1.tv_sec  = 0;
+    t1.tv_nsec = 300;
+
+    do
+    {
+        nanosleep(&t1, &t2);
+    } while(0 == atomic_load(&exp_mon_thread_ready));
+
+    log("########## Initializing replay_thread ##########\n");
+
+    atomic_store(&udp_conn_thread_ready, 1);
+
+    run = run_cfg_acquire();
+    if (replay_reads_from(run->tmp_datafile_dir) || replay_reads_from(run->datafile_dir))
+    {
+        err( "not replaying %s into the directory it is in, set other data directories\n",
+             replay_path );
+        run_cfg_release();
+        return NULL;
+    }
+    run_cfg_release();
+
+    if (replay_tick_ns > 0)
+    {
+        info("replaying %s at the recorded rate, %g ns per tick\n", replay_path, replay_tick_ns);
+    }
+    else
+    {
+        info("replaying %s as fast as possible\n", replay_path);
+    }
+
+    perf_thread_init(__func__);
+    trace_thread_init(__func__);
+
+    t0 = now_ns();
+    for (uint32_t segment=0; ; segment++)
+    {
+        snprintf(path, sizeof(path), "%s.%010u.bin", replay_path, segment);
+        if (0 != replay_segment(path, &write_buff))
+        {
+            break;
+        }
+    }
+
+    if (0 == stats.num_files)
+    {
+        err("no segments %s.*.bin to replay\n", replay_path);
+        return NULL;
+    }
+    report("sent", t0);
+
+    // wait for the writer and the spectra to catch up
+    t1.tv_nsec = 1000000;
+    do
+    {
+        nanosleep(&t1, &t2);
+        busy = 0;
+        for (int i=0; i<NUM_PACKET_BUFF; i++)
+        {
+            busy |= (DATA_WRITTEN | DATA_PROCCED) !=
+                    (__atomic_load_n(&packet_buff[i].status, __ATOMIC_RELAXED) & (DATA_WRITTEN | DATA_PROCCED));
+        }
+    } while (busy);
+    report("done", t0);
+
+    return NULL;
+}
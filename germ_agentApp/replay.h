@@ -0,0 +1,57 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+
+//===========================================================
+// Offline replay.
+//
+// With 'germ_daemon -r DIR/FILENAME.RUNNO', replay_thread
+// takes the place of udp_conn_thread: it reads the raw
+// segments FILENAME.RUNNO.segno.bin in order, from segment
+// 0 until one is missing, and puts their packets into the
+// packet buffers as if they had been received. Everything
+// downstream runs unchanged, and writes to the directories,
+// file name and run number currently configured.
+//
+// Those must not include the directory replayed from, where
+// the segments written could be the ones being read: replay
+// refuses to start if the data directories are, and segments
+// are not written there if it comes to that later, as a
+// stripe target or a directory changed meanwhile.
+//
+// Raw segments hold whole packets back to back. A packet
+// starts with the pair | PKT_CNTR | 0 |. Valid event pairs
+// have TS_FLAG set in their second word, and the only other
+// pair with a second word of 0 is | SOF_MARKER | FRAME_NUM |
+// of frame 0. The packets are found again by looking for
+// pairs with a second word of 0 and a first word other than
+// SOF_MARKER; a packet runs to the next one, up to
+// MAX_PACKET_LENGTH.
+//
+// Pacing ('-p'):
+//
+//     0           as fast as the buffers are freed (default)
+//     <ns/tick>   at the recorded rate: each packet is sent
+//                 when its first timestamp is due, at the
+//                 given timestamp period in ns, counted from
+//                 the first packet of each frame
+//
+// When done, the packets, bytes and rate achieved are
+// logged, and again once the buffers have drained.
+//===========================================================
+
+typedef struct
+{
+    uint64_t  num_files;
+    uint64_t  num_packets;
+    uint64_t  num_bytes;
+    uint64_t  num_cut;          // packets cut at MAX_PACKET_LENGTH
+} replay_stats_t;
+
+int   replay_reads_from(const char* dir);
+void* replay_thread(void* arg);
+
+#endif
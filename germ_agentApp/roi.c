@@ -0,0 +1,316 @@
+/**
+ * File: roi.c
+ *
+ * Functionality: Region-of-interest counters.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : ROI table loaded from ROI_CFG_FILE and reloaded when the
+ *               file changes. Per-channel LUTs map (pd, td) to a cell
+ *               counter, cells are summed into ROIs at the end of frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "roi.h"
+#include "log.h"
+
+
+_Atomic(roi_table_t*) roi_table_pending = ATOMIC_VAR_INIT(NULL);
+
+typedef struct
+{
+    uint8_t   chans[NUM_CHANS];
+    uint16_t  pd_lo, pd_hi;
+    uint16_t  td_lo, td_hi;
+} roi_def_t;
+
+
+//========================================================================
+// Read ROI definitions. Returns the number of ROIs or -1 on error.
+//========================================================================
+static int roi_read_cfg(const char* file, roi_def_t* def)
+{
+    FILE *       fp;
+    char         line[512];
+    char         chans[256];
+    unsigned int pd_lo, pd_hi, td_lo, td_hi;
+    int          n, num_roi = 0, line_num = 0;
+
+    fp = fopen(file, "r");
+    if (NULL == fp)
+    {
+        err("failed to open %s\n", file);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_num++;
+        *strchrnul(line, '#') = 0;
+
+        n = sscanf(line, "%255s %u %u %u %u", chans, &pd_lo, &pd_hi, &td_lo, &td_hi);
+        if (n <= 0)
+        {
+            continue;  // blank line or comment
+        }
+        if (3 == n)
+        {
+            td_lo = 0;
+            td_hi = NUM_TDC_COL-1;
+        }
+        else if (5 != n)
+        {
+            err("%s line %d: expect <channels> <pd_lo> <pd_hi> [<td_lo> <td_hi>]\n", file, line_num);
+            goto fail;
+        }
+
+        if ( pd_lo > pd_hi || pd_hi >= NUM_MCA_COL ||
+             td_lo > td_hi || td_hi >= NUM_TDC_COL )
+        {
+            err("%s line %d: invalid pd/td range\n", file, line_num);
+            goto fail;
+        }
+
+        if (num_roi == MAX_ROI)
+        {
+            err("%s: more than %d ROIs\n", file, MAX_ROI);
+            goto fail;
+        }
+
+        if (0 != parse_chan_list(chans, def[num_roi].chans))
+        {
+            err("%s line %d: invalid channel list\n", file, line_num);
+            goto fail;
+        }
+        def[num_roi].pd_lo = pd_lo;
+        def[num_roi].pd_hi = pd_hi;
+        def[num_roi].td_lo = td_lo;
+        def[num_roi].td_hi = td_hi;
+        num_roi++;
+    }
+
+    fclose(fp);
+    return num_roi;
+
+fail:
+    fclose(fp);
+    return -1;
+}
+
+
+//========================================================================
+// Cut an axis into segments where the ROI mask changes.
+// Returns the number of segments.
+//========================================================================
+static uint32_t make_segments( const uint32_t * mask,
+                               uint32_t         len,
+                               uint16_t       * seg,
+                               uint32_t       * seg_mask )
+{
+    uint32_t n = 0;
+
+    seg_mask[0] = mask[0];
+    for (uint32_t b=0; b<len; b++)
+    {
+        if (mask[b] != seg_mask[n])
+        {
+            seg_mask[++n] = mask[b];
+        }
+        seg[b] = n;
+    }
+
+    return n+1;
+}
+
+
+//========================================================================
+// Build the LUTs and cells for a set of ROIs.
+//========================================================================
+static roi_table_t* roi_table_build(const roi_def_t* def, uint32_t num_roi)
+{
+    roi_table_t * t;
+    uint32_t      pd_mask[NUM_MCA_COL], td_mask[NUM_TDC_COL];
+    uint16_t      pd_seg[NUM_MCA_COL],  td_seg[NUM_TDC_COL];
+    uint32_t      pd_seg_mask[NUM_MCA_COL], td_seg_mask[NUM_TDC_COL];
+    uint32_t      num_pd_seg, num_td_seg;
+    uint32_t      base = 0, cap = 4096;
+    uint32_t    * cell_roi;
+
+    t = calloc(1, sizeof(roi_table_t));
+    if (NULL == t)
+    {
+        return NULL;
+    }
+    t->cell_roi = malloc(cap * sizeof(uint32_t));
+    if (NULL == t->cell_roi)
+    {
+        roi_table_free(t);
+        return NULL;
+    }
+
+    for (uint32_t ch=0; ch<NUM_CHANS; ch++)
+    {
+        memset(pd_mask, 0, sizeof(pd_mask));
+        memset(td_mask, 0, sizeof(td_mask));
+        for (uint32_t r=0; r<num_roi; r++)
+        {
+            if (!def[r].chans[ch])
+            {
+                continue;
+            }
+            for (uint32_t b=def[r].pd_lo; b<=def[r].pd_hi; b++)
+            {
+                pd_mask[b] |= 1u << r;
+            }
+            for (uint32_t b=def[r].td_lo; b<=def[r].td_hi; b++)
+            {
+                td_mask[b] |= 1u << r;
+            }
+        }
+
+        num_pd_seg = make_segments(pd_mask, NUM_MCA_COL, pd_seg, pd_seg_mask);
+        num_td_seg = make_segments(td_mask, NUM_TDC_COL, td_seg, td_seg_mask);
+
+        if (base + num_pd_seg*num_td_seg > cap)
+        {
+            while (base + num_pd_seg*num_td_seg > cap)
+            {
+                cap *= 2;
+            }
+            cell_roi = realloc(t->cell_roi, cap * sizeof(uint32_t));
+            if (NULL == cell_roi)
+            {
+                roi_table_free(t);
+                return NULL;
+            }
+            t->cell_roi = cell_roi;
+        }
+
+        // a cell is in a ROI if both its pd and td segments are
+        for (uint32_t p=0; p<num_pd_seg; p++)
+        {
+            for (uint32_t d=0; d<num_td_seg; d++)
+            {
+                t->cell_roi[base + p*num_td_seg + d] = pd_seg_mask[p] & td_seg_mask[d];
+            }
+        }
+
+        for (uint32_t b=0; b<NUM_MCA_COL; b++)
+        {
+            t->pd_lut[ch][b] = base + pd_seg[b]*num_td_seg;
+        }
+        memcpy(t->td_lut[ch], td_seg, sizeof(td_seg));
+
+        base += num_pd_seg*num_td_seg;
+    }
+
+    t->num_roi    = num_roi;
+    t->num_cells  = base;
+    t->cell_count = calloc(base, sizeof(uint32_t));
+    if (NULL == t->cell_count)
+    {
+        roi_table_free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+
+//========================================================================
+void roi_table_free(roi_table_t* t)
+{
+    if (t)
+    {
+        free(t->cell_roi);
+        free(t->cell_count);
+        free(t);
+    }
+}
+
+
+//========================================================================
+void roi_table_clear(roi_table_t* t)
+{
+    memset(t->cell_count, 0, t->num_cells*sizeof(uint32_t));
+}
+
+
+//========================================================================
+// Sum the cells into the ROIs.
+//========================================================================
+void roi_table_latch(roi_table_t* t, uint32_t roi_counts[MAX_ROI])
+{
+    uint32_t n, m;
+
+    memset(roi_counts, 0, MAX_ROI*sizeof(uint32_t));
+
+    for (uint32_t c=0; c<t->num_cells; c++)
+    {
+        n = t->cell_count[c];
+        if (0 == n)
+        {
+            continue;
+        }
+        for (m = t->cell_roi[c]; m; m &= m-1)
+        {
+            roi_counts[__builtin_ctz(m)] += n;
+        }
+    }
+}
+
+
+//========================================================================
+// Reload ROI_CFG_FILE if it has changed, and hand the new table to the
+// processing thread. Removing the file clears the ROIs.
+//========================================================================
+void roi_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+    static roi_def_t       def[MAX_ROI];
+
+    roi_table_t * t;
+    roi_table_t * old;
+    int           num_roi;
+
+    switch (cfg_file_changed(ROI_CFG_FILE, &last_mtime))
+    {
+        case CFG_UNCHANGED:
+            return;
+
+        case CFG_REMOVED:
+            num_roi = 0;
+            info("%s removed. ROIs cleared.\n", ROI_CFG_FILE);
+            break;
+
+        default:
+            num_roi = roi_read_cfg(ROI_CFG_FILE, def);
+            if (num_roi < 0)
+            {
+                err("ROIs in %s ignored.\n", ROI_CFG_FILE);
+                return;
+            }
+    }
+
+    t = roi_table_build(def, num_roi);
+    if (NULL == t)
+    {
+        err("failed to allocate ROI table.\n");
+        return;
+    }
+
+    old = atomic_exchange(&roi_table_pending, t);
+    roi_table_free(old);
+
+    info("%d ROIs loaded (%u cells), effective from the next frame.\n", num_roi, t->num_cells);
+}
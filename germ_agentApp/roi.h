@@ -0,0 +1,62 @@
+#ifndef _ROI_H_
+#define _ROI_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Region-of-interest counters.
+//
+// ROIs are read from ROI_CFG_FILE, one per line:
+//
+//     <channels>  <pd_lo> <pd_hi>  [<td_lo> <td_hi>]
+//
+// where <channels> is "all" or a comma separated list of
+// channels and ranges, e.g. 0-31,64,70-79. Ranges are
+// inclusive. '#' starts a comment.
+//
+// For every channel the pd and td axes are cut into segments
+// at the ROI boundaries, and each (pd segment, td segment)
+// cell belongs to a fixed set of ROIs. An event only
+// increments its cell, found through two per-channel LUTs,
+// so the cost per event doesn't depend on the number of ROIs.
+// Cells are summed into ROIs when the frame ends.
+//===========================================================
+
+#define MAX_ROI           32
+
+typedef struct
+{
+    uint32_t   num_roi;
+    uint32_t   num_cells;
+    uint32_t   pd_lut[NUM_CHANS][NUM_MCA_COL];   // 1st cell of (chan, pd segment)
+    uint16_t   td_lut[NUM_CHANS][NUM_TDC_COL];   // offset of td segment
+    uint32_t  *cell_roi;                         // ROI bit mask of each cell
+    uint32_t  *cell_count;                       // events in each cell
+} roi_table_t;
+
+// New table from roi_cfg_poll(), taken over by the processing thread.
+extern _Atomic(roi_table_t*) roi_table_pending;
+
+void roi_cfg_poll(void);
+void roi_table_free(roi_table_t* t);
+void roi_table_clear(roi_table_t* t);
+void roi_table_latch(roi_table_t* t, uint32_t roi_counts[MAX_ROI]);
+
+//========================================================================
+// Count the events of a batch. One increment per event.
+//========================================================================
+static inline void roi_table_count(roi_table_t* t, const evt_batch_t* batch)
+{
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        uint16_t addr = batch->addr[i];
+        t->cell_count[ t->pd_lut[addr][batch->pd[i]]
+                     + t->td_lut[addr][batch->td[i]] ]++;
+    }
+}
+
+#endif
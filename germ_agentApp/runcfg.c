@@ -0,0 +1,166 @@
+/**
+ * File: runcfg.c
+ *
+ * Functionality: Run configuration snapshots.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Run parameters published as immutable snapshots by pointer
+ *               swap, replacing the mutex protected strings.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "runcfg.h"
+#include "log.h"
+
+
+typedef struct run_cfg_node_s
+{
+    run_cfg_t                 cfg;          // first, handed out as is
+    uint64_t                  retired;      // epoch it was replaced in
+    struct run_cfg_node_s   * next;
+} run_cfg_node_t;
+
+static _Atomic(run_cfg_node_t*) current = NULL;
+
+// A reader notes the epoch it started in, 0 when not reading. A snapshot
+// replaced in epoch e can only be seen by readers that started in e or
+// before.
+static atomic_ulong   epoch = ATOMIC_VAR_INIT(1);
+static atomic_ulong   reader_epoch[RUN_CFG_MAX_READERS];
+static atomic_uint    num_readers = ATOMIC_VAR_INIT(0);
+static __thread int   reader = -1;
+
+static run_cfg_node_t * retired = NULL;     // writer only
+static uint32_t         gen = 0;
+
+
+//========================================================================
+int run_cfg_init(void)
+{
+    run_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    run_cfg_publish(&cfg);
+
+    return (NULL == atomic_load(&current)) ? -1 : 0;
+}
+
+
+//========================================================================
+// Make 'cfg' the current run configuration. The one it replaces is
+// freed when no reader can be using it any more.
+//========================================================================
+void run_cfg_publish(const run_cfg_t* cfg)
+{
+    run_cfg_node_t * node;
+    run_cfg_node_t * old;
+
+    node = malloc(sizeof(run_cfg_node_t));
+    if (NULL == node)
+    {
+        err("no memory for the run configuration\n");
+        return;
+    }
+    node->cfg     = *cfg;
+    node->cfg.gen = ++gen;
+    node->next    = NULL;
+
+    old = atomic_exchange(&current, node);
+    if (old)
+    {
+        old->retired = atomic_fetch_add(&epoch, 1);
+        old->next    = retired;
+        retired      = old;
+    }
+
+    run_cfg_reclaim();
+}
+
+
+//========================================================================
+// Free the replaced snapshots no reader started early enough to see.
+//========================================================================
+void run_cfg_reclaim(void)
+{
+    run_cfg_node_t ** p = &retired;
+    run_cfg_node_t  * node;
+    uint64_t          oldest = UINT64_MAX;
+    uint64_t          e;
+    uint32_t          n;
+
+    n = atomic_load(&num_readers);
+    if (n > RUN_CFG_MAX_READERS)
+    {
+        n = RUN_CFG_MAX_READERS;
+    }
+    for (uint32_t i=0; i<n; i++)
+    {
+        e = atomic_load(&reader_epoch[i]);
+        if (e && e < oldest)
+        {
+            oldest = e;
+        }
+    }
+
+    while (*p)
+    {
+        node = *p;
+        if (node->retired < oldest)
+        {
+            *p = node->next;
+            free(node);
+        }
+        else
+        {
+            p = &node->next;
+        }
+    }
+}
+
+
+//========================================================================
+// The current run configuration, valid until run_cfg_release().
+//========================================================================
+const run_cfg_t* run_cfg_acquire(void)
+{
+    if (reader < 0)
+    {
+        reader = atomic_fetch_add(&num_readers, 1);
+        if (reader >= RUN_CFG_MAX_READERS)
+        {
+            err("more than %d run configuration readers\n", RUN_CFG_MAX_READERS);
+            exit(1);
+        }
+    }
+
+    // noted before the pointer is loaded, so the writer sees this reader
+    // or this reader sees the latest snapshot
+    atomic_store(&reader_epoch[reader], atomic_load(&epoch));
+    return &atomic_load(&current)->cfg;
+}
+
+
+//========================================================================
+void run_cfg_release(void)
+{
+    atomic_store_explicit(&reader_epoch[reader], 0, memory_order_release);
+}
+
+
+//========================================================================
+void run_cfg_copy(run_cfg_t* cfg)
+{
+    *cfg = *run_cfg_acquire();
+    run_cfg_release();
+}
@@ -0,0 +1,51 @@
+#ifndef _RUNCFG_H_
+#define _RUNCFG_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+
+//===========================================================
+// Run configuration snapshots.
+//
+// The run parameters set through PVs (directories, file
+// name, run number, file size) are gathered by
+// exp_mon_thread into one run_cfg_t, never changed once
+// published. A change publishes a new one by swapping a
+// pointer. Readers take the current one without locking:
+//
+//     const run_cfg_t * run = run_cfg_acquire();
+//     ... use run ...
+//     run_cfg_release();
+//
+// or keep a copy with run_cfg_copy(). A thread holds at
+// most one at a time, and briefly. Replaced snapshots are
+// freed by exp_mon_thread once no reader that could still
+// see them is left (epoch based reclamation).
+//
+// run_cfg_init() is called before any thread is started;
+// run_cfg_publish() and run_cfg_reclaim() only by
+// exp_mon_thread.
+//===========================================================
+
+#define RUN_CFG_MAX_READERS   32    // threads ever calling run_cfg_acquire()
+
+typedef struct
+{
+    uint32_t  gen;                              // bumped by each publish
+    char      tmp_datafile_dir[MAX_FILENAME_LEN];
+    char      datafile_dir[MAX_FILENAME_LEN];
+    char      filename[MAX_FILENAME_LEN];
+    uint32_t  runno;
+    uint32_t  filesize;                         // MB per segment
+} run_cfg_t;
+
+int  run_cfg_init(void);
+void run_cfg_publish(const run_cfg_t* cfg);
+void run_cfg_reclaim(void);
+
+const run_cfg_t* run_cfg_acquire(void);
+void run_cfg_release(void);
+void run_cfg_copy(run_cfg_t* cfg);
+
+#endif
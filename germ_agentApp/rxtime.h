@@ -0,0 +1,74 @@
+#ifndef _RXTIME_H_
+#define _RXTIME_H_
+
+#include <stdint.h>
+#include <string.h>
+
+//===========================================================
+// Packet receive timing.
+//
+// The data socket has SO_TIMESTAMPNS set, so each datagram
+// comes with the time the kernel received it. udp_conn_thread
+// keeps it in the packet buffer with the latency from then to
+// recvmsg() returning, i.e. how long the packet waited for us.
+// data_write_thread makes two histograms per frame of them:
+//
+//   latency   kernel receive to userspace, per packet
+//   gap       between kernel receive times of successive
+//             packets of the frame
+//
+// Bursty detector output shows as many short gaps with low
+// latency; packets waiting on our own scheduling show as high
+// latency whatever the gaps.
+//
+// Bins are powers of two in ns: bin 0 holds 0, bin i values
+// in [2^(i-1), 2^i), and the last bin everything from 2^30
+// (about 1 s) up.
+//===========================================================
+
+#define RX_HIST_BINS   32
+
+typedef struct
+{
+    uint32_t  bins[RX_HIST_BINS];
+    uint64_t  num;
+    uint64_t  max;
+} rx_hist_t;
+
+
+static inline void rx_hist_clear(rx_hist_t* h)
+{
+    memset(h, 0, sizeof(rx_hist_t));
+}
+
+
+static inline void rx_hist_add(rx_hist_t* h, uint64_t ns)
+{
+    uint32_t bin = ns ? 64 - __builtin_clzll(ns) : 0;
+
+    h->bins[(bin < RX_HIST_BINS) ? bin : RX_HIST_BINS - 1]++;
+    h->num++;
+    h->max = (ns > h->max) ? ns : h->max;
+}
+
+
+//-----------------------------------------------------------
+// Upper edge, in ns, of the bin holding the q-quantile, or the
+// largest value if less.
+//-----------------------------------------------------------
+static inline uint64_t rx_hist_quantile(const rx_hist_t* h, double q)
+{
+    uint64_t sum = 0;
+
+    for (int i=0; i<RX_HIST_BINS; i++)
+    {
+        sum += h->bins[i];
+        if (sum && sum >= q * h->num)
+        {
+            return (i < RX_HIST_BINS - 1 && (1UL << i) < h->max) ? (1UL << i) : h->max;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * File: segindex.c
+ *
+ * Functionality: Segment index.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Frame starts and per-block packet/timestamp ranges noted
+ *               while writing, saved next to the closed segment.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "germ.h"
+#include "segindex.h"
+#include "log.h"
+
+
+_Static_assert(32 == sizeof(idx_hdr_t),   "index header must be 32 bytes");
+_Static_assert(16 == sizeof(idx_frame_t), "index frame entry must be 16 bytes");
+_Static_assert(40 == sizeof(idx_block_t), "index block entry must be 40 bytes");
+
+
+//========================================================================
+seg_index_t* seg_index_create(uint32_t frame_num, uint32_t segment)
+{
+    seg_index_t * idx;
+
+    idx = calloc(1, sizeof(seg_index_t));
+    if (NULL == idx)
+    {
+        return NULL;
+    }
+
+    idx->hdr.magic      = IDX_MAGIC;
+    idx->hdr.version    = IDX_VERSION;
+    idx->hdr.frame_num  = frame_num;
+    idx->hdr.segment    = segment;
+    idx->hdr.block_size = IDX_BLOCK_SIZE;
+
+    return idx;
+}
+
+
+//========================================================================
+void seg_index_free(seg_index_t* idx)
+{
+    if (NULL == idx)
+    {
+        return;
+    }
+
+    free(idx->frames);
+    free(idx->blocks);
+    free(idx);
+}
+
+
+//========================================================================
+// Make room for one more entry. Returns -1 if out of memory.
+//========================================================================
+static int grow(void** array, uint32_t num, uint32_t* cap, size_t size)
+{
+    void * p;
+
+    if (num < *cap)
+    {
+        return 0;
+    }
+
+    p = realloc(*array, (*cap ? 2 * *cap : 64) * size);
+    if (NULL == p)
+    {
+        return -1;
+    }
+    *array = p;
+    *cap   = *cap ? 2 * *cap : 64;
+
+    return 0;
+}
+
+
+//========================================================================
+// Note a packet written at 'offset'. Only the ends of the packet are
+// looked at for timestamps.
+//========================================================================
+void seg_index_packet( seg_index_t    * idx,
+                       uint64_t         offset,
+                       const uint32_t * packet,
+                       uint16_t         packet_length )
+{
+    uint32_t      counter = ntohl(packet[0]);
+    uint16_t      first   = 2;
+    uint16_t      last    = packet_length;
+    int           i, j;
+    idx_block_t * b;
+
+    if (packet_length >= 4)
+    {
+        if (ntohl(packet[2]) == SOF_MARKER)
+        {
+            first = 4;
+            if (0 == grow((void**)&idx->frames, idx->hdr.num_frames, &idx->frames_cap, sizeof(idx_frame_t)))
+            {
+                idx->frames[idx->hdr.num_frames].offset    = offset;
+                idx->frames[idx->hdr.num_frames].frame_num = ntohl(packet[3]);
+                idx->frames[idx->hdr.num_frames].packet    = counter;
+                idx->hdr.num_frames++;
+            }
+        }
+        if (ntohl(packet[packet_length-1]) == EOF_MARKER)
+        {
+            last -= 2;
+        }
+    }
+
+    //--------------------------------------------------
+    // New block?
+    if ( 0 == idx->hdr.num_blocks ||
+         offset / IDX_BLOCK_SIZE != idx->blocks[idx->hdr.num_blocks-1].offset / IDX_BLOCK_SIZE )
+    {
+        if (0 != grow((void**)&idx->blocks, idx->hdr.num_blocks, &idx->blocks_cap, sizeof(idx_block_t)))
+        {
+            return;
+        }
+        b = &idx->blocks[idx->hdr.num_blocks++];
+        memset(b, 0, sizeof(idx_block_t));
+        b->offset       = offset;
+        b->first_packet = counter;
+        idx->has_ts     = 0;
+    }
+    b = &idx->blocks[idx->hdr.num_blocks-1];
+    b->last_packet = counter;
+    b->num_packets++;
+
+    //--------------------------------------------------
+    // First and last timestamps of the packet
+    for (i=first; i+1<last; i+=2)
+    {
+        if (!(ntohl(packet[i]) & TS_FLAG) && (ntohl(packet[i+1]) & TS_FLAG))
+        {
+            break;
+        }
+    }
+    if (i+1 >= last)
+    {
+        return;  // no events
+    }
+    for (j=first + ((last-first) & ~1) - 2; j>i; j-=2)
+    {
+        if (!(ntohl(packet[j]) & TS_FLAG) && (ntohl(packet[j+1]) & TS_FLAG))
+        {
+            break;
+        }
+    }
+
+    if (!idx->has_ts)
+    {
+        b->first_ts = ts_unwrap(&idx->unwrap, ntohl(packet[i+1]) & TS_MASK);
+        idx->has_ts = 1;
+    }
+    b->last_ts = ts_unwrap(&idx->unwrap, ntohl(packet[j+1]) & TS_MASK);
+}
+
+
+//========================================================================
+int seg_index_write(seg_index_t* idx, const char* file)
+{
+    FILE * fp;
+    int    ok;
+
+    fp = fopen(file, "w");
+    if (NULL == fp)
+    {
+        err("failed to open %s\n", file);
+        return -1;
+    }
+
+    ok = (1 == fwrite(&idx->hdr, sizeof(idx_hdr_t), 1, fp));
+    ok = ok && (idx->hdr.num_frames == fwrite(idx->frames, sizeof(idx_frame_t), idx->hdr.num_frames, fp));
+    ok = ok && (idx->hdr.num_blocks == fwrite(idx->blocks, sizeof(idx_block_t), idx->hdr.num_blocks, fp));
+    ok = (0 == fclose(fp)) && ok;
+
+    if (!ok)
+    {
+        err("failed to write %s\n", file);
+        return -1;
+    }
+
+    return 0;
+}
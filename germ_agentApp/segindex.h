@@ -0,0 +1,85 @@
+#ifndef _SEGINDEX_H_
+#define _SEGINDEX_H_
+
+#include <stdint.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Segment index.
+//
+// While writing a segment, data_write_thread notes where each
+// frame starts and, for every IDX_BLOCK_SIZE bytes of the
+// file, the packets and timestamps in that block. The index
+// is kept in memory and written to filename.runno.segno.idx
+// by the segment pipeline once the segment is closed.
+//
+// Blocks are in file order, with increasing packet counters
+// and, nearly, timestamps, so a packet or a time is found by
+// binary search.
+//
+// File format, in host byte order:
+//
+//     idx_hdr_t
+//     idx_frame_t [num_frames]
+//     idx_block_t [num_blocks]
+//
+// Offsets are in bytes from the start of the segment file.
+// Timestamps are unwrapped within the segment.
+//===========================================================
+
+#define IDX_MAGIC        0x58444947   // "GIDX"
+#define IDX_VERSION      1
+#define IDX_BLOCK_SIZE   (1 << 20)
+
+typedef struct
+{
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  frame_num;
+    uint32_t  segment;
+    uint32_t  block_size;
+    uint32_t  num_frames;
+    uint32_t  num_blocks;
+    uint32_t  reserved;
+} idx_hdr_t;
+
+typedef struct
+{
+    uint64_t  offset;           // of the SOF packet
+    uint32_t  frame_num;
+    uint32_t  packet;           // its packet counter
+} idx_frame_t;
+
+typedef struct
+{
+    uint64_t  offset;           // of the first packet starting in the block
+    uint32_t  first_packet;
+    uint32_t  last_packet;
+    uint32_t  num_packets;
+    uint32_t  reserved;
+    uint64_t  first_ts;         // 0 if no events
+    uint64_t  last_ts;
+} idx_block_t;
+
+typedef struct
+{
+    idx_hdr_t     hdr;
+    idx_frame_t * frames;
+    idx_block_t * blocks;
+    uint32_t      frames_cap;
+    uint32_t      blocks_cap;
+    uint8_t       has_ts;       // in the current block
+    ts_unwrap_t   unwrap;
+} seg_index_t;
+
+seg_index_t* seg_index_create(uint32_t frame_num, uint32_t segment);
+void         seg_index_free(seg_index_t* idx);
+void         seg_index_packet( seg_index_t    * idx,
+                               uint64_t         offset,
+                               const uint32_t * packet,
+                               uint16_t         packet_length );
+int          seg_index_write(seg_index_t* idx, const char* file);
+
+#endif
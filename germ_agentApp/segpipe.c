@@ -0,0 +1,352 @@
+/**
+ * File: segpipe.c
+ *
+ * Functionality: Pipeline for closed segments.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Stages with bounded queues and worker threads, fed by
+ *               data_write_thread without blocking.
+ *
+ *   v1.1
+ *     - Date  : Oct 2026
+ *     - Brief : Compression stage on a pool of niced workers that back off
+ *               while the packet buffers fill up.
+ *
+ *   v1.2
+ *     - Date  : Oct 2026
+ *     - Brief : Move stage to the final data directory; per-stage backlog;
+ *               Run manifest line once done, with the final path.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "germ.h"
+#include "segpipe.h"
+#include "columnar.h"
+#include "output.h"
+#include "clean.h"
+#include "codec.h"
+#include "mover.h"
+#include "stripe.h"
+#include "log.h"
+
+
+// Compression waits while more packet buffers than this are unwritten.
+#define COMPRESS_MAX_BACKLOG   (NUM_PACKET_BUFF / 4)
+
+static int index_write(seg_item_t* item);
+static int segment_compress(seg_item_t* item);
+
+static seg_stage_t stages[] =
+{
+    { .name = "index",    .bit = SEG_INDEX,    .fn = index_write,      .num_workers = 1 },
+    { .name = "columnar", .bit = SEG_COLUMNAR, .fn = columnar_convert, .num_workers = 1 },
+    { .name = "compress", .bit = SEG_COMPRESS, .fn = segment_compress, .num_workers = 2, .nice = 10 },
+    { .name = "move",     .bit = SEG_MOVE,     .fn = segment_move,     .num_workers = MOVE_MAX_JOBS },
+};
+
+#define NUM_STAGES   (sizeof(stages)/sizeof(stages[0]))
+
+
+//========================================================================
+// Done with an item: note the segment in its run manifest as it is left,
+// compressed or moved or neither, then free it.
+//========================================================================
+static void seg_pipe_done(seg_item_t* item)
+{
+    struct stat st;
+    uint8_t     failed = 0;
+
+    if (item->manifest[0])
+    {
+        if (0 != stat(item->path, &st))
+        {
+            err("%s gone, left out of %s\n", item->path, item->manifest);
+            failed = 1;
+        }
+        stripe_manifest_add( item->manifest, item->segment, item->eof,
+                             failed, failed ? 0 : st.st_size, item->path );
+    }
+    seg_item_free(item);
+}
+
+
+//========================================================================
+// Queue an item on the first stage it wants from 'first' on. Done with
+// the item if there are none left.
+//========================================================================
+static void seg_pipe_forward(seg_item_t* item, uint32_t first)
+{
+    seg_stage_t * st;
+
+    for (uint32_t i=first; i<NUM_STAGES; i++)
+    {
+        st = &stages[i];
+        if (!(item->stages & st->bit))
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&st->lock);
+        if (st->count < SEG_QUEUE_LEN)
+        {
+            st->queue[(st->head + st->count) % SEG_QUEUE_LEN] = item;
+            st->count++;
+            pthread_cond_signal(&st->cond);
+            pthread_mutex_unlock(&st->lock);
+            return;
+        }
+        pthread_mutex_unlock(&st->lock);
+
+        atomic_fetch_add(&st->num_skipped, 1);
+        atomic_fetch_sub(&st->num_pending, 1);
+        warn("%s queue full, %s skipped\n", st->name, item->path);
+    }
+
+    seg_pipe_done(item);
+}
+
+
+//========================================================================
+static void* seg_worker(void* arg)
+{
+    seg_stage_t * st = (seg_stage_t*)arg;
+    seg_item_t  * item;
+
+    if (st->nice)
+    {
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), st->nice);
+    }
+
+    while (1)
+    {
+        pthread_mutex_lock(&st->lock);
+        while (0 == st->count)
+        {
+            pthread_cond_wait(&st->cond, &st->lock);
+        }
+        item     = st->queue[st->head];
+        st->head = (st->head + 1) % SEG_QUEUE_LEN;
+        st->count--;
+        pthread_mutex_unlock(&st->lock);
+
+        if (0 == st->fn(item))
+        {
+            atomic_fetch_add(&st->num_done, 1);
+        }
+        else
+        {
+            atomic_fetch_add(&st->num_failed, 1);
+            err("%s failed on %s\n", st->name, item->path);
+        }
+        atomic_fetch_sub(&st->num_pending, 1);
+
+        seg_pipe_forward(item, (st - stages) + 1);
+    }
+
+    return NULL;
+}
+
+
+//========================================================================
+// Write the index built while the segment was written.
+//========================================================================
+static int index_write(seg_item_t* item)
+{
+    char idxfile[MAX_FILENAME_LEN];
+
+    if (NULL == item->index)
+    {
+        return -1;
+    }
+
+    seg_side_name(item, ".idx", idxfile);
+    if (0 != seg_index_write(item->index, idxfile))
+    {
+        return -1;
+    }
+
+    seg_index_free(item->index);
+    item->index = NULL;
+    seg_add_side(item, idxfile);
+
+    return 0;
+}
+
+
+//========================================================================
+// Hold off between blocks while data_write_thread is behind.
+//========================================================================
+static void compress_yield(void)
+{
+    while (buff_backlog() > COMPRESS_MAX_BACKLOG)
+    {
+        usleep(1000);
+    }
+}
+
+
+//========================================================================
+// Replace the segment with FILE.gsc once the compressed copy has been
+// read back and compared. Stages after this one see the new path.
+//========================================================================
+static int segment_compress(seg_item_t* item)
+{
+    char        gscfile[MAX_FILENAME_LEN];
+    gsc_stats_t stats;
+    uint8_t     clean = (OUTPUT_CLEAN == item->format);
+
+    if (snprintf(gscfile, MAX_FILENAME_LEN, "%s%s", item->path, GSC_EXT) >= MAX_FILENAME_LEN)
+    {
+        err("%s%s is too long\n", item->path, GSC_EXT);
+        return -1;
+    }
+
+    if (0 != gsc_compress_file( item->path,
+                                gscfile,
+                                clean ? GSC_ORDER_HOST : GSC_ORDER_NET,
+                                clean ? sizeof(clean_hdr_t) : 0,
+                                compress_yield,
+                                &stats ))
+    {
+        err("failed to compress %s\n", item->path);
+        unlink(gscfile);
+        return -1;
+    }
+    if (0 != gsc_verify_file(gscfile, item->path))
+    {
+        err("%s doesn't match %s, kept the original\n", gscfile, item->path);
+        unlink(gscfile);
+        return -1;
+    }
+
+    unlink(item->path);
+    strcpy(item->path, gscfile);
+
+    log( "%s: ratio %.2f, %.1f MB/s per core\n",
+         gscfile,
+         stats.out_bytes ? (double)stats.in_bytes / stats.out_bytes : 0.0,
+         stats.cpu_sec > 0 ? stats.in_bytes / 1e6 / stats.cpu_sec : 0.0 );
+
+    return 0;
+}
+
+
+//========================================================================
+// Start the workers of all stages.
+//========================================================================
+int seg_pipe_init(void)
+{
+    pthread_t tid;
+
+    for (uint32_t i=0; i<NUM_STAGES; i++)
+    {
+        pthread_mutex_init(&stages[i].lock, NULL);
+        pthread_cond_init(&stages[i].cond, NULL);
+
+        for (uint32_t w=0; w<stages[i].num_workers; w++)
+        {
+            if (0 != pthread_create(&tid, NULL, seg_worker, &stages[i]))
+            {
+                err("failed to start %s worker\n", stages[i].name);
+                return -1;
+            }
+            pthread_detach(tid);
+        }
+    }
+
+    return 0;
+}
+
+
+//========================================================================
+// Hand a closed segment over. The pipeline owns the item from now on.
+//========================================================================
+void seg_pipe_post(seg_item_t* item)
+{
+    for (uint32_t i=0; i<NUM_STAGES; i++)
+    {
+        if (item->stages & stages[i].bit)
+        {
+            atomic_fetch_add(&stages[i].num_pending, 1);
+        }
+    }
+
+    seg_pipe_forward(item, 0);
+}
+
+
+//========================================================================
+void seg_item_free(seg_item_t* item)
+{
+    seg_index_free(item->index);
+    free(item);
+}
+
+
+//========================================================================
+// Name of a file made alongside the segment: the segment file name with
+// its extension replaced.
+//========================================================================
+void seg_side_name(const seg_item_t* item, const char* ext, char* name)
+{
+    char * dot;
+
+    snprintf(name, MAX_FILENAME_LEN, "%s", item->path);
+    dot = strrchr(name, '.');
+    if (NULL == dot || (strrchr(name, '/') && dot < strrchr(name, '/')))
+    {
+        dot = name + strlen(name);
+    }
+    snprintf(dot, MAX_FILENAME_LEN - (dot - name), "%s", ext);
+}
+
+
+//========================================================================
+// Record a file made alongside the segment, for the stages after.
+//========================================================================
+int seg_add_side(seg_item_t* item, const char* path)
+{
+    if (item->num_side == SEG_MAX_SIDE)
+    {
+        return -1;
+    }
+
+    snprintf(item->side[item->num_side++], MAX_FILENAME_LEN, "%s", path);
+    return 0;
+}
+
+
+//========================================================================
+// Counters of the stage 'bit'. Returns -1 if there is no such stage.
+//========================================================================
+int seg_pipe_stats(uint32_t bit, seg_stage_stats_t* stats)
+{
+    for (uint32_t i=0; i<NUM_STAGES; i++)
+    {
+        if (stages[i].bit == bit)
+        {
+            stats->done    = atomic_load(&stages[i].num_done);
+            stats->failed  = atomic_load(&stages[i].num_failed);
+            stats->skipped = atomic_load(&stages[i].num_skipped);
+            stats->pending = atomic_load(&stages[i].num_pending);
+            return 0;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,83 @@
+#ifndef _SEGPIPE_H_
+#define _SEGPIPE_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "germ.h"
+#include "segindex.h"
+#include "event.h"
+
+//===========================================================
+// Pipeline for closed segments.
+//
+// data_write_thread posts each segment it closes. The segment
+// then goes through the stages it asks for, in a fixed order,
+// each stage with its own bounded queue and worker threads.
+//
+// Posting never blocks: when a stage's queue is full, the
+// segment skips that stage, so the pipeline can fall behind
+// but never hold back acquisition.
+//===========================================================
+
+// stages, in the order they run
+#define SEG_INDEX         0x01
+#define SEG_COLUMNAR      0x02
+#define SEG_COMPRESS      0x04
+#define SEG_MOVE          0x08
+
+#define SEG_MAX_SIDE      4      // files made alongside a segment
+#define SEG_QUEUE_LEN    64
+
+typedef struct
+{
+    char          path[MAX_FILENAME_LEN];
+    uint32_t      run_num;
+    uint32_t      segment;
+    uint8_t       format;        // OUTPUT_RAW or OUTPUT_CLEAN
+    uint8_t       eof;           // last segment of the frame
+    uint32_t      stages;        // SEG_* wanted
+    seg_index_t * index;         // built while writing, for SEG_INDEX
+    ts_unwrap_t   unwrap;        // frame timestamps up to the segment
+    char          manifest[MAX_FILENAME_LEN];  // to note the segment in when done, if any
+    uint32_t      num_side;
+    char          side[SEG_MAX_SIDE][MAX_FILENAME_LEN];
+} seg_item_t;
+
+typedef struct
+{
+    const char      * name;
+    uint32_t          bit;
+    int             (*fn)(seg_item_t*);
+    uint32_t          num_workers;
+    int               nice;          // added to the workers' nice value
+
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    seg_item_t      * queue[SEG_QUEUE_LEN];
+    uint32_t          head;
+    uint32_t          count;
+
+    atomic_ulong      num_done;
+    atomic_ulong      num_failed;
+    atomic_ulong      num_skipped;
+    atomic_uint       num_pending;   // posted, not yet done or skipped
+} seg_stage_t;
+
+typedef struct
+{
+    uint64_t  done;
+    uint64_t  failed;
+    uint64_t  skipped;
+    uint32_t  pending;
+} seg_stage_stats_t;
+
+int  seg_pipe_init(void);
+void seg_pipe_post(seg_item_t* item);
+void seg_item_free(seg_item_t* item);
+void seg_side_name(const seg_item_t* item, const char* ext, char* name);
+int  seg_add_side(seg_item_t* item, const char* path);
+int  seg_pipe_stats(uint32_t bit, seg_stage_stats_t* stats);
+
+#endif
@@ -0,0 +1,576 @@
+/**
+ * File: stripe.c
+ *
+ * Functionality: Striped segment writers.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : One writer thread per target directory, fed with blocks
+ *               by data_write_thread; run manifest of completed segments.
+ *
+ *   v1.1
+ *     - Date  : Oct 2026
+ *     - Brief : Segments can be opened ahead of use, and dropped unused;
+ *               End of frame noted in the manifest once all of its
+ *               segments are completed, or their failure if any failed;
+ *               Only new files opened ahead, never existing ones;
+ *               Manifest lines can come from the segment pipeline, with
+ *               where the segment ended up;
+ *               Writers started only for the targets in use.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "stripe.h"
+#include "log.h"
+
+
+struct stripe_blk_s
+{
+    stripe_blk_t  * next;
+    stripe_seg_t  * seg;
+    uint32_t        len;
+    uint8_t         close;          // last block of the segment
+    uint8_t       * data;
+};
+
+typedef struct
+{
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    stripe_blk_t    * head;
+    stripe_blk_t    * tail;
+    atomic_ulong      bytes;
+} stripe_target_t;
+
+static stripe_target_t targets[STRIPE_MAX_TARGETS];
+static atomic_uint     num_writers;     // started, for the first targets
+
+// Frames with segments in the manifest, until all are completed
+typedef struct
+{
+    char      manifest[MAX_FILENAME_LEN];   // empty if the slot is free
+    uint32_t  num_done;
+    uint32_t  num_failed;
+    uint32_t  num_segments;                 // 0 until the last one is closed
+    uint64_t  last_used;
+} stripe_frame_t;
+
+static stripe_frame_t   frames[STRIPE_MAX_FRAMES];
+static uint64_t         frame_clock = 0;
+static pthread_mutex_t  frame_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t  pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   pool_cond = PTHREAD_COND_INITIALIZER;
+static stripe_blk_t   * pool;
+static uint8_t          sync_on_close;
+
+
+//========================================================================
+// Free blocks. Taking one waits if all are in flight: the disks are then
+// slower than the data, and the packet buffers take up the slack.
+//========================================================================
+static stripe_blk_t* blk_get(void)
+{
+    static time_t   last_warn = 0;
+    static uint32_t num_stalls = 0;
+
+    stripe_blk_t * b;
+
+    pthread_mutex_lock(&pool_lock);
+    if (NULL == pool)
+    {
+        num_stalls++;
+        if (time(NULL) != last_warn)
+        {
+            warn("all write blocks in flight, waiting for the disks (%u times)\n", num_stalls);
+            last_warn  = time(NULL);
+            num_stalls = 0;
+        }
+    }
+    while (NULL == pool)
+    {
+        pthread_cond_wait(&pool_cond, &pool_lock);
+    }
+    b    = pool;
+    pool = b->next;
+    pthread_mutex_unlock(&pool_lock);
+
+    b->next  = NULL;
+    b->len   = 0;
+    b->close = 0;
+    return b;
+}
+
+static void blk_put(stripe_blk_t* b)
+{
+    pthread_mutex_lock(&pool_lock);
+    b->next = pool;
+    pool    = b;
+    pthread_cond_signal(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+//========================================================================
+static void blk_queue(stripe_blk_t* b)
+{
+    stripe_target_t * t = &targets[b->seg->target];
+
+    pthread_mutex_lock(&t->lock);
+    if (t->tail)
+    {
+        t->tail->next = b;
+    }
+    else
+    {
+        t->head = b;
+    }
+    t->tail = b;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+
+//========================================================================
+static int write_full(int fd, const uint8_t* buf, size_t len)
+{
+    ssize_t n;
+
+    while (len)
+    {
+        n = write(fd, buf, len);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+
+//========================================================================
+// Append a line to a run manifest. Each line goes out in one append, so
+// writers of different targets don't interleave.
+//========================================================================
+static void manifest_line(const char* manifest, const char* line, int len)
+{
+    int fd;
+
+    fd = open(manifest, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        err("failed to open %s\n", manifest);
+        return;
+    }
+    if (0 != write_full(fd, (const uint8_t*)line, len))
+    {
+        err("failed to write %s\n", manifest);
+    }
+    close(fd);
+}
+
+
+//========================================================================
+// Count a closed segment against its frame. Once the last segment has
+// been closed and all of the frame's segments are done, whichever writer
+// finishes last notes the end of the frame, or that it is incomplete.
+//========================================================================
+static void manifest_done( const char * manifest,
+                           uint32_t     segment,
+                           uint8_t      eof,
+                           uint8_t      failed )
+{
+    stripe_frame_t * f = NULL;
+    stripe_frame_t * lru = &frames[0];
+    char             line[64];
+
+    pthread_mutex_lock(&frame_lock);
+    for (int i=0; i<STRIPE_MAX_FRAMES && NULL == f; i++)
+    {
+        if (0 == strcmp(frames[i].manifest, manifest))
+        {
+            f = &frames[i];
+        }
+        else if (frames[i].last_used < lru->last_used)
+        {
+            lru = &frames[i];
+        }
+    }
+    if (NULL == f)
+    {
+        f = lru;
+        if (f->manifest[0])
+        {
+            warn("%s left without an end line, too many frames in flight\n", f->manifest);
+        }
+        memset(f, 0, sizeof(stripe_frame_t));
+        snprintf(f->manifest, MAX_FILENAME_LEN, "%s", manifest);
+    }
+    f->last_used = ++frame_clock;
+
+    f->num_done   += !failed;
+    f->num_failed += failed;
+    if (eof)
+    {
+        f->num_segments = segment + 1;
+    }
+
+    if (f->num_segments && f->num_done + f->num_failed >= f->num_segments)
+    {
+        if (f->num_failed)
+        {
+            snprintf(line, sizeof(line), "failed %u of %u\n", f->num_failed, f->num_segments);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "end %u\n", f->num_segments);
+        }
+        manifest_line(f->manifest, line, strlen(line));
+        memset(f, 0, sizeof(stripe_frame_t));
+    }
+    pthread_mutex_unlock(&frame_lock);
+}
+
+
+//========================================================================
+// Note a segment in its run manifest: a line with where it is now if it
+// was completed, and the end of the frame when due. Called by the writer
+// when the segment is closed, or by the segment pipeline once it is done
+// with it, for segments it compresses or moves.
+//========================================================================
+void stripe_manifest_add( const char * manifest,
+                          uint32_t     segment,
+                          uint8_t      eof,
+                          uint8_t      failed,
+                          uint64_t     bytes,
+                          const char * path )
+{
+    char line[MAX_FILENAME_LEN + 64];
+    int  len;
+
+    if (NULL == manifest || 0 == manifest[0])
+    {
+        return;
+    }
+
+    if (!failed)
+    {
+        len = snprintf(line, sizeof(line), "%u %lu %s\n", segment, bytes, path);
+        manifest_line(manifest, line, len);
+    }
+    manifest_done(manifest, segment, eof, failed);
+}
+
+
+//========================================================================
+// Write the blocks of one target, in order.
+//========================================================================
+static void* stripe_writer(void* arg)
+{
+    stripe_target_t * t = (stripe_target_t*)arg;
+    stripe_blk_t    * b;
+    stripe_seg_t    * seg;
+
+    while (1)
+    {
+        pthread_mutex_lock(&t->lock);
+        while (NULL == t->head)
+        {
+            pthread_cond_wait(&t->cond, &t->lock);
+        }
+        b       = t->head;
+        t->head = b->next;
+        if (NULL == t->head)
+        {
+            t->tail = NULL;
+        }
+        pthread_mutex_unlock(&t->lock);
+
+        seg = b->seg;
+        if (seg->fd < 0 && !seg->failed)
+        {
+            seg->fd = open( seg->path,
+                            O_WRONLY | O_CREAT | (seg->append ? O_APPEND : O_TRUNC),
+                            0644 );
+            if (seg->fd < 0)
+            {
+                err("failed to open %s (%s)\n", seg->path, strerror(errno));
+                seg->failed = 1;
+            }
+        }
+
+        if (seg->fd >= 0 && b->len)
+        {
+            if (0 != write_full(seg->fd, b->data, b->len))
+            {
+                err("failed to write %s (%s)\n", seg->path, strerror(errno));
+                seg->failed = 1;
+                close(seg->fd);
+                seg->fd = -1;
+            }
+            else
+            {
+                seg->bytes += b->len;
+                atomic_fetch_add(&t->bytes, b->len);
+            }
+        }
+
+        if (b->close)
+        {
+            if (seg->fd >= 0)
+            {
+                if (seg->hdr_len && pwrite(seg->fd, seg->hdr, seg->hdr_len, 0) != (ssize_t)seg->hdr_len)
+                {
+                    err("failed to write the header of %s\n", seg->path);
+                    seg->failed = 1;
+                }
+                if (sync_on_close)
+                {
+                    fdatasync(seg->fd);
+                }
+                if (0 != close(seg->fd))
+                {
+                    seg->failed = 1;
+                }
+            }
+            stripe_manifest_add(seg->manifest, seg->segment, seg->eof, seg->failed, seg->bytes, seg->path);
+            if (seg->done)
+            {
+                seg->done(seg->arg, seg->failed ? -1 : 0);
+            }
+            free(seg);
+        }
+
+        blk_put(b);
+    }
+
+    return NULL;
+}
+
+
+//========================================================================
+// Allocate the blocks and start the writer of the first target, which
+// is also that of the temporary data directory. With 'sync', each
+// segment is flushed to disk before it is closed.
+//========================================================================
+int stripe_init(uint8_t sync)
+{
+    stripe_blk_t * b;
+
+    sync_on_close = sync;
+
+    for (int i=0; i<STRIPE_MAX_TARGETS; i++)
+    {
+        pthread_mutex_init(&targets[i].lock, NULL);
+        pthread_cond_init(&targets[i].cond, NULL);
+    }
+
+    for (int i=0; i<STRIPE_NUM_BLOCKS; i++)
+    {
+        b = calloc(1, sizeof(stripe_blk_t));
+        if (b)
+        {
+            b->data = malloc(STRIPE_BLOCK_SIZE);
+        }
+        if (NULL == b || NULL == b->data)
+        {
+            err("no memory for write blocks\n");
+            free(b);
+            return -1;
+        }
+        blk_put(b);
+    }
+
+    return stripe_start(1);
+}
+
+
+//========================================================================
+// Have writers for the first 'num_targets' targets, starting those not
+// running yet. Writers are never stopped; fewer targets just leave some
+// idle.
+//========================================================================
+int stripe_start(uint32_t num_targets)
+{
+    pthread_t tid;
+    uint32_t  n = atomic_load(&num_writers);
+
+    if (num_targets > STRIPE_MAX_TARGETS)
+    {
+        num_targets = STRIPE_MAX_TARGETS;
+    }
+    for ( ; n<num_targets; n++)
+    {
+        if (0 != pthread_create(&tid, NULL, stripe_writer, &targets[n]))
+        {
+            err("failed to start writer %u\n", n);
+            return -1;
+        }
+        pthread_detach(tid);
+        atomic_store(&num_writers, n + 1);
+    }
+
+    return 0;
+}
+
+
+//========================================================================
+// Start a segment on 'target'. The file itself is opened by the writer.
+// A target without a writer of its own shares that of another.
+//========================================================================
+stripe_seg_t* stripe_open( const char * path,
+                           uint32_t     segment,
+                           uint32_t     target,
+                           uint8_t      append )
+{
+    stripe_seg_t * seg;
+    uint32_t       n;
+
+    seg = calloc(1, sizeof(stripe_seg_t));
+    if (NULL == seg)
+    {
+        return NULL;
+    }
+
+    snprintf(seg->path, MAX_FILENAME_LEN, "%s", path);
+    seg->segment = segment;
+    n            = atomic_load(&num_writers);
+    seg->target  = n ? target % n : 0;      // any running writer will do
+    seg->append  = append;
+    seg->fd      = -1;
+    seg->cur     = blk_get();
+    seg->cur->seg = seg;
+
+    return seg;
+}
+
+
+//========================================================================
+// Create the file of a segment now, on the calling thread, instead of
+// leaving it to the writer. For segments made ahead of use, which may
+// never be used: a file that exists already is left alone, to be opened
+// the usual way if it is wanted, and nothing is ever truncated here.
+//========================================================================
+int stripe_preopen(stripe_seg_t* seg)
+{
+    seg->fd = open( seg->path,
+                    O_WRONLY | O_CREAT | O_EXCL | (seg->append ? O_APPEND : 0),
+                    0644 );
+    if (seg->fd < 0)
+    {
+        if (EEXIST != errno)
+        {
+            err("failed to open %s (%s)\n", seg->path, strerror(errno));
+        }
+        return -1;
+    }
+
+    seg->created = 1;
+    return 0;
+}
+
+
+//========================================================================
+// Drop a segment nothing has been written to. A file it created is
+// removed again.
+//========================================================================
+void stripe_discard(stripe_seg_t* seg)
+{
+    if (seg->fd >= 0)
+    {
+        close(seg->fd);
+        if (seg->created)
+        {
+            unlink(seg->path);
+        }
+    }
+    blk_put(seg->cur);
+    free(seg);
+}
+
+
+//========================================================================
+void stripe_write(stripe_seg_t* seg, const void* data, size_t len)
+{
+    const uint8_t * p = (const uint8_t*)data;
+    size_t          n;
+
+    while (len)
+    {
+        n = STRIPE_BLOCK_SIZE - seg->cur->len;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(seg->cur->data + seg->cur->len, p, n);
+        seg->cur->len += n;
+        p   += n;
+        len -= n;
+
+        if (STRIPE_BLOCK_SIZE == seg->cur->len)
+        {
+            blk_queue(seg->cur);
+            seg->cur      = blk_get();
+            seg->cur->seg = seg;
+        }
+    }
+}
+
+
+//========================================================================
+// Finish a segment. 'hdr' (may be NULL) goes to the start of the file,
+// 'manifest' (may be NULL) gets a line for it, and 'done' is called from
+// the writer once the file is closed. The segment is freed after that.
+//========================================================================
+void stripe_close( stripe_seg_t * seg,
+                   const void   * hdr,
+                   uint32_t       hdr_len,
+                   const char   * manifest,
+                   uint8_t        eof,
+                   void         (*done)(void* arg, int status),
+                   void         * arg )
+{
+    if (hdr && hdr_len <= sizeof(seg->hdr))
+    {
+        memcpy(seg->hdr, hdr, hdr_len);
+        seg->hdr_len = hdr_len;
+    }
+    if (manifest)
+    {
+        snprintf(seg->manifest, MAX_FILENAME_LEN, "%s", manifest);
+    }
+    seg->eof  = eof;
+    seg->done = done;
+    seg->arg  = arg;
+
+    seg->cur->close = 1;
+    blk_queue(seg->cur);
+}
+
+
+//========================================================================
+uint64_t stripe_bytes_written(uint32_t target)
+{
+    return atomic_load(&targets[target % STRIPE_MAX_TARGETS].bytes);
+}
@@ -0,0 +1,108 @@
+#ifndef _STRIPE_H_
+#define _STRIPE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "germ.h"
+
+//===========================================================
+// Striped segment writers.
+//
+// Segments are written by a pool of writer threads, one per
+// target directory. Segment k of a frame goes to target
+// k % num_targets, so successive segments are written to
+// different disks at the same time.
+//
+// data_write_thread only copies its output into blocks and
+// queues them. The target's writer opens the file, writes
+// the blocks and, on close, the segment header. It then
+// notes the segment in the run manifest and calls back.
+//
+// Targets are set with 'stripe' lines in OUTPUT_CFG_FILE.
+// Without them, the only target is the temporary data
+// directory. Writers are started as targets are set, and
+// kept when they are dropped.
+//
+// Run manifest, filename.runno.manifest in the temporary
+// data directory, a line per segment as it is completed:
+//
+//     <segno> <bytes> <path>
+//
+// with the file as it is left: a segment that goes through
+// the segment pipeline is noted once the pipeline is done
+// with it, with the path and size after compression and
+// moving, and the one it was written with otherwise.
+//
+// and, once every segment of the frame is done, either
+//
+//     end <number of segments>
+//
+// when all of them were completed, or
+//
+//     failed <number failed> of <number of segments>
+//
+// when some could not be written, and have no line. Segment
+// lines may come out of order, since targets finish
+// independently. Sort by segno to reassemble the frame; the
+// end line always comes after them.
+//
+// Up to STRIPE_MAX_FRAMES frames can have segments being
+// written at once; beyond that the oldest is given up and
+// gets no end line.
+//===========================================================
+
+#define STRIPE_MAX_TARGETS     8
+#define STRIPE_BLOCK_SIZE      (1 << 20)
+#define STRIPE_NUM_BLOCKS      64       // in flight, over all targets
+#define STRIPE_MAX_FRAMES      16       // with segments in flight
+
+typedef struct stripe_blk_s  stripe_blk_t;
+
+typedef struct
+{
+    char            path[MAX_FILENAME_LEN];
+    char            manifest[MAX_FILENAME_LEN];
+    uint32_t        segment;
+    uint32_t        target;
+    uint8_t         append;         // raw segments are appended to
+    uint8_t         eof;            // last segment of the frame
+    uint8_t         failed;
+    uint8_t         created;        // file made by stripe_preopen()
+    int             fd;
+    uint64_t        bytes;
+    uint8_t         hdr[64];        // written at offset 0 on close
+    uint32_t        hdr_len;
+    void          (*done)(void* arg, int status);
+    void          * arg;
+    stripe_blk_t  * cur;            // being filled
+} stripe_seg_t;
+
+int  stripe_init(uint8_t sync);
+int  stripe_start(uint32_t num_targets);
+
+stripe_seg_t* stripe_open( const char * path,
+                           uint32_t     segment,
+                           uint32_t     target,
+                           uint8_t      append );
+int  stripe_preopen(stripe_seg_t* seg);
+void stripe_discard(stripe_seg_t* seg);
+void stripe_write(stripe_seg_t* seg, const void* data, size_t len);
+void stripe_close( stripe_seg_t * seg,
+                   const void   * hdr,
+                   uint32_t       hdr_len,
+                   const char   * manifest,
+                   uint8_t        eof,
+                   void         (*done)(void* arg, int status),
+                   void         * arg );
+
+void stripe_manifest_add( const char * manifest,
+                          uint32_t     segment,
+                          uint8_t      eof,
+                          uint8_t      failed,
+                          uint64_t     bytes,
+                          const char * path );
+
+uint64_t stripe_bytes_written(uint32_t target);
+
+#endif
@@ -0,0 +1,357 @@
+/**
+ * File: trace.c
+ *
+ * Functionality: Timeline of the pipeline threads.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Spans kept per thread with TSC timestamps, and exported on
+ *               request in Chrome Trace Event format.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+
+#include "germ.h"
+#include "trace.h"
+#include "log.h"
+
+typedef struct
+{
+    uint64_t  t0;               // ticks
+    uint64_t  dur  : 56;        // ticks
+    uint64_t  what : 8;
+} tr_span_t;
+
+typedef struct
+{
+    char                  name[32];
+    pid_t                 tid;
+    _Atomic(tr_span_t*)   spans;    // NULL until tracing is first turned on
+    uint64_t              mask;     // set before spans
+    _Atomic uint64_t      head;     // next span number, owning thread only
+} tr_thread_t;
+
+typedef struct
+{
+    uint32_t  buffer;
+    uint32_t  window;
+    char      dir[MAX_FILENAME_LEN];
+} tr_cfg_t;
+
+_Atomic uint8_t trace_on = ATOMIC_VAR_INIT(0);
+
+static const char * kinds[TR_NUM_KINDS] =
+{
+    "recv", "ring wait", "write", "segment rollover", "CA put", "spectrum publish"
+};
+
+static tr_thread_t       threads[TR_MAX_THREADS];
+static int               num_threads = 0;
+static pthread_mutex_t   tr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread tr_thread_t * self = NULL;
+
+// exp_mon_thread only
+static tr_cfg_t  cfg = { TR_DEFAULT_BUFFER, TR_DEFAULT_WINDOW, "." };
+static uint64_t  num_spans = 0;    // per thread, 0 until tracing is first turned on
+static uint64_t  cal_ticks;        // when it was
+static uint64_t  cal_ns;
+
+
+//========================================================================
+static uint64_t mono_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000UL + t.tv_nsec;
+}
+
+
+//========================================================================
+// Record a span of the calling thread. Nothing is recorded for threads
+// that have no buffer.
+//========================================================================
+void trace_span(uint16_t what, uint64_t t0, uint64_t t1)
+{
+    tr_thread_t * t = self;
+    tr_span_t   * spans;
+    uint64_t      n;
+
+    if (NULL == t)
+    {
+        return;
+    }
+    spans = atomic_load_explicit(&t->spans, memory_order_acquire);
+    if (NULL == spans)
+    {
+        return;
+    }
+
+    // the exporter tells overwritten spans by the head read after copying
+    n = atomic_load_explicit(&t->head, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    spans[n & t->mask].t0   = t0;
+    spans[n & t->mask].dur  = t1 - t0;
+    spans[n & t->mask].what = what;
+
+    atomic_store_explicit(&t->head, n + 1, memory_order_release);
+}
+
+
+//========================================================================
+// Register the calling thread, to get a buffer when tracing is on.
+//========================================================================
+void trace_thread_init(const char* name)
+{
+    pthread_mutex_lock(&tr_mutex);
+    if (num_threads >= TR_MAX_THREADS)
+    {
+        pthread_mutex_unlock(&tr_mutex);
+        warn("%s not traced, %d threads traced already\n", name, TR_MAX_THREADS);
+        return;
+    }
+    self = &threads[num_threads++];
+    snprintf(self->name, sizeof(self->name), "%s", name);
+    self->tid = syscall(SYS_gettid);
+    pthread_mutex_unlock(&tr_mutex);
+}
+
+
+//========================================================================
+// Give a buffer to the threads that have none, which are those started
+// since tracing was turned on.
+//========================================================================
+static void alloc_buffers(void)
+{
+    tr_span_t * spans;
+
+    pthread_mutex_lock(&tr_mutex);
+    for (int i=0; i<num_threads; i++)
+    {
+        if (atomic_load_explicit(&threads[i].spans, memory_order_relaxed))
+        {
+            continue;
+        }
+        spans = malloc(num_spans * sizeof(tr_span_t));
+        if (NULL == spans)
+        {
+            err("no memory to trace %s\n", threads[i].name);
+            continue;
+        }
+        memset(spans, 0, num_spans * sizeof(tr_span_t));   // no page faults when tracing
+
+        threads[i].mask = num_spans - 1;
+        atomic_store_explicit(&threads[i].spans, spans, memory_order_release);
+    }
+    pthread_mutex_unlock(&tr_mutex);
+}
+
+
+//========================================================================
+// Read TRACE_CFG_FILE, defaults for what it doesn't have.
+//========================================================================
+static void read_cfg(tr_cfg_t* c)
+{
+    cfg_key_t keys[] =
+    {
+        { "buffer", CFG_U32, &c->buffer                   },
+        { "window", CFG_U32, &c->window                   },
+        { "dir",    CFG_STR, c->dir,   MAX_FILENAME_LEN   },
+    };
+
+    c->buffer = TR_DEFAULT_BUFFER;
+    c->window = TR_DEFAULT_WINDOW;
+    strcpy(c->dir, ".");
+
+    cfg_read(TRACE_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0]));
+
+    if (c->buffer < 1024)
+    {
+        warn("trace buffer of %u spans too small, using 1024\n", c->buffer);
+        c->buffer = 1024;
+    }
+}
+
+
+//========================================================================
+// Write the spans of the last window seconds. Each thread's buffer is
+// copied first, as the thread keeps writing it; spans overwritten while
+// copying are counted and left out.
+//========================================================================
+static void export(void)
+{
+    tr_thread_t * t;
+    tr_span_t   * spans;
+    tr_span_t   * copy;
+    uint64_t      now_ticks, now_ns, since;
+    uint64_t      h, first, n;
+    uint64_t      num = 0, num_torn = 0;
+    double        ns_per_tick;
+    char          path[MAX_FILENAME_LEN + 64];
+    char          stamp[32];
+    time_t        sec = time(NULL);
+    struct tm     tm;
+    pid_t         pid = getpid();
+    int           nthreads;
+    FILE        * fp;
+
+    if (0 == num_spans)
+    {
+        warn("nothing traced to export\n");
+        return;
+    }
+
+    // calibrate against the whole time since tracing was turned on
+    now_ticks = trace_clock();
+    now_ns    = mono_ns();
+    if (now_ns - cal_ns < 10000000UL)
+    {
+        usleep(10000);
+        now_ticks = trace_clock();
+        now_ns    = mono_ns();
+    }
+    ns_per_tick = (double)(now_ns - cal_ns) / (now_ticks - cal_ticks);
+    since       = now_ticks - (uint64_t)(cfg.window * 1e9 / ns_per_tick);
+    since       = (since < now_ticks) ? since : 0;
+
+    copy = malloc(num_spans * sizeof(tr_span_t));
+    if (NULL == copy)
+    {
+        err("no memory to export the trace\n");
+        return;
+    }
+
+    localtime_r(&sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    snprintf(path, sizeof(path), "%s/trace.%s.json", cfg.dir, stamp);
+    fp = fopen(path, "w");
+    if (NULL == fp)
+    {
+        err("failed to create %s: %s\n", path, strerror(errno));
+        free(copy);
+        return;
+    }
+
+    pthread_mutex_lock(&tr_mutex);
+    nthreads = num_threads;
+    pthread_mutex_unlock(&tr_mutex);
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    fprintf( fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                 "\"args\":{\"name\":\"germ_daemon\"}}", pid, pid );
+
+    for (int i=0; i<nthreads; i++)
+    {
+        t     = &threads[i];
+        spans = atomic_load_explicit(&t->spans, memory_order_acquire);
+        if (NULL == spans)
+        {
+            continue;
+        }
+        fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                     "\"args\":{\"name\":\"%s\"}}", pid, t->tid, t->name );
+
+        h     = atomic_load_explicit(&t->head, memory_order_acquire);
+        first = (h > num_spans) ? h - num_spans : 0;
+        for (n=first; n<h; n++)
+        {
+            copy[n - first] = spans[n & t->mask];
+        }
+        atomic_thread_fence(memory_order_acquire);
+        h = atomic_load_explicit(&t->head, memory_order_relaxed);
+
+        for (n=first; n<first+num_spans && n<h; n++)
+        {
+            if (n + num_spans <= h)
+            {
+                num_torn++;
+                continue;
+            }
+            if (copy[n - first].t0 < since || copy[n - first].what >= TR_NUM_KINDS)
+            {
+                continue;
+            }
+            fprintf( fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                     kinds[copy[n - first].what],
+                     (cal_ns + ((int64_t)(copy[n - first].t0 - cal_ticks)) * ns_per_tick) * 1e-3,
+                     copy[n - first].dur * ns_per_tick * 1e-3,
+                     pid, t->tid );
+            num++;
+        }
+    }
+
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    fclose(fp);
+    free(copy);
+
+    info( "%lu spans of the last %u s exported to %s (%.3f ns/tick, %lu overwritten meanwhile)\n",
+          num, cfg.window, path, ns_per_tick, num_torn );
+}
+
+
+//========================================================================
+// Turn tracing on or off as TRACE_CFG_FILE comes and goes, and export
+// when TRACE_DUMP_FILE shows up. Called by exp_mon_thread.
+//========================================================================
+void trace_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    tr_cfg_t c;
+    int      status;
+
+    status = cfg_file_changed(TRACE_CFG_FILE, &last_mtime);
+    if (CFG_CHANGED == status)
+    {
+        read_cfg(&c);
+        if (0 == num_spans)
+        {
+            // a power of two, so the ring index is a mask
+            for (num_spans=1024; num_spans<c.buffer; num_spans<<=1);
+            cal_ticks = trace_clock();
+            cal_ns    = mono_ns();
+        }
+        else if (c.buffer != cfg.buffer)
+        {
+            warn("trace buffer of %u spans effective from the next start.\n", c.buffer);
+            c.buffer = cfg.buffer;
+        }
+        cfg = c;
+        info( "tracing with %lu spans per thread, exporting %u s to %s.\n",
+              num_spans, cfg.window, cfg.dir );
+    }
+    else if (CFG_REMOVED == status)
+    {
+        atomic_store(&trace_on, 0);
+        info("tracing stopped.\n");
+    }
+
+    if (CFG_CHANGED == status || atomic_load(&trace_on))
+    {
+        alloc_buffers();
+        atomic_store(&trace_on, 1);
+    }
+
+    if (0 == access(TRACE_DUMP_FILE, F_OK))
+    {
+        export();
+        if (0 != unlink(TRACE_DUMP_FILE))
+        {
+            err("failed to remove %s: %s\n", TRACE_DUMP_FILE, strerror(errno));
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//===========================================================
+// Timeline of the pipeline threads.
+//
+// Each pipeline thread records spans of what it is doing
+//
+//     recv, ring wait, write, segment rollover, CA put,
+//     spectrum publish
+//
+// into a buffer of its own: a span is its start and duration
+// in TSC ticks (CLOCK_MONOTONIC ns where there is no TSC) and
+// what it was, 16 bytes, stored without locks or system calls.
+// Buffers are rings, so they hold the latest spans only.
+//
+// Tracing is on while TRACE_CFG_FILE exists, with
+//
+//     buffer  <spans per thread>    read when first turned on
+//     window  <s>                   exported before the request
+//     dir     <path>                of the exported files
+//
+// Creating TRACE_DUMP_FILE has exp_mon_thread export the last
+// window seconds of every thread to
+//
+//     dir/trace.YYYYmmdd-HHMMSS.json
+//
+// in Chrome Trace Event format (chrome://tracing, Perfetto),
+// then remove it. Buffers are kept when tracing is turned off,
+// so what led up to it can still be exported.
+//
+// Off, a span costs one relaxed load. Ticks are converted to
+// time against CLOCK_MONOTONIC over the whole time traced,
+// which assumes an invariant TSC, as on any recent x86.
+//===========================================================
+
+#define TR_RECV            0
+#define TR_RING_WAIT       1
+#define TR_WRITE           2
+#define TR_ROLLOVER        3
+#define TR_CA_PUT          4
+#define TR_SPECTRA         5
+#define TR_NUM_KINDS       6
+
+#define TR_MAX_THREADS     8
+#define TR_DEFAULT_BUFFER  262144
+#define TR_DEFAULT_WINDOW  10
+
+extern _Atomic uint8_t trace_on;
+
+void trace_thread_init(const char* name);
+void trace_cfg_poll(void);
+void trace_span(uint16_t what, uint64_t t0, uint64_t t1);
+
+
+static inline uint64_t trace_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000UL + t.tv_nsec;
+#endif
+}
+
+
+//-----------------------------------------------------------
+// Start of a span, 0 when not tracing.
+//-----------------------------------------------------------
+static inline uint64_t trace_begin(void)
+{
+    return atomic_load_explicit(&trace_on, memory_order_relaxed) ? trace_clock() : 0;
+}
+
+
+static inline void trace_end(uint16_t what, uint64_t t0)
+{
+    if (t0)
+    {
+        trace_span(what, t0, trace_clock());
+    }
+}
+
+#endif
@@ -0,0 +1,376 @@
+/**
+ * File: tslice.c
+ *
+ * Functionality: Time-sliced spectra.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * Revisions:
+ *
+ *   v1.0
+ *     - Date  : Oct 2026
+ *     - Brief : Ring of sparse per-slice spectra keyed on the event
+ *               timestamp, completed slices saved to filename.runno.tslice;
+ *               Open slices completed at the end of a frame even when
+ *               there is no file, so they don't leak into the next;
+ *               Slices completed by their used slots only.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "tslice.h"
+#include "log.h"
+
+
+_Atomic(tslice_cfg_t*) tslice_cfg_pending = ATOMIC_VAR_INIT(NULL);
+
+#define TSLICE_KEY(addr, pd)   (((uint32_t)(addr) << PD_WIDTH) | (pd))
+
+
+//========================================================================
+tslice_t* tslice_create(const tslice_cfg_t* cfg, uint32_t* stream_mca, uint32_t* stream_index)
+{
+    tslice_t * ts;
+    uint32_t   bits = 1;
+
+    ts = calloc(1, sizeof(tslice_t));
+    if (NULL == ts)
+    {
+        return NULL;
+    }
+
+    ts->cfg = *cfg;
+    while ((1u << bits) < cfg->num_bins)
+    {
+        bits++;
+    }
+    ts->cfg.num_bins   = 1u << bits;
+    ts->hash_shift     = 32 - bits;
+    ts->max_entries    = ts->cfg.num_bins - (ts->cfg.num_bins >> 2);
+    ts->stream_mca     = stream_mca;
+    ts->stream_index   = stream_index;
+
+    ts->slice = calloc(cfg->num_slices, sizeof(tslice_slice_t));
+    ts->buff  = malloc(2 * ts->cfg.num_bins * sizeof(uint32_t));
+    if (NULL == ts->slice || NULL == ts->buff)
+    {
+        tslice_free(ts);
+        return NULL;
+    }
+
+    for (uint32_t i=0; i<cfg->num_slices; i++)
+    {
+        ts->slice[i].key   = calloc(ts->cfg.num_bins, sizeof(uint32_t));
+        ts->slice[i].count = malloc(ts->cfg.num_bins * sizeof(uint32_t));
+        ts->slice[i].used  = malloc(ts->max_entries * sizeof(uint32_t));
+        if (NULL == ts->slice[i].key || NULL == ts->slice[i].count || NULL == ts->slice[i].used)
+        {
+            tslice_free(ts);
+            return NULL;
+        }
+    }
+
+    return ts;
+}
+
+
+//========================================================================
+void tslice_free(tslice_t* ts)
+{
+    if (NULL == ts)
+    {
+        return;
+    }
+
+    if (ts->fp)
+    {
+        fclose(ts->fp);
+    }
+    if (ts->slice)
+    {
+        for (uint32_t i=0; i<ts->cfg.num_slices; i++)
+        {
+            free(ts->slice[i].key);
+            free(ts->slice[i].count);
+            free(ts->slice[i].used);
+        }
+    }
+    free(ts->slice);
+    free(ts->buff);
+    free(ts);
+}
+
+
+//========================================================================
+// Write a slice out if it has anything, and empty it. Only the slots in
+// use are visited, so a sparse slice costs little however many bins.
+//========================================================================
+static void tslice_complete(tslice_t* ts, tslice_slice_t* s)
+{
+    uint32_t n = 0;
+    uint32_t h;
+    uint32_t hdr[2];
+
+    if (0 == s->num_entries && 0 == s->num_overflow)
+    {
+        return;
+    }
+
+    for (uint32_t i=0; i<s->num_entries; i++)
+    {
+        h = s->used[i];
+        ts->buff[n++] = s->key[h] - 1;
+        ts->buff[n++] = s->count[h];
+        s->key[h]     = 0;
+    }
+
+    if (ts->fp)
+    {
+        hdr[0] = s->num_entries;
+        hdr[1] = s->num_overflow;
+        fwrite(&s->index, sizeof(uint64_t), 1, ts->fp);
+        fwrite(hdr, sizeof(hdr), 1, ts->fp);
+        fwrite(ts->buff, sizeof(uint32_t), n, ts->fp);
+        ts->num_written++;
+    }
+
+    if (s->num_overflow)
+    {
+        warn("slice %lu: %u events over the %u-bin limit\n",
+             s->index, s->num_overflow, ts->cfg.num_bins);
+    }
+
+    if (ts->cfg.stream)
+    {
+        memset(ts->stream_mca, 0, NUM_MCA_COL*sizeof(uint32_t));
+        for (uint32_t i=0; i<n; i+=2)
+        {
+            ts->stream_mca[ts->buff[i] & FIELD_MASK(PD_WIDTH)] += ts->buff[i+1];
+        }
+        *ts->stream_index = s->index;
+        ts->stream_new    = 1;
+    }
+
+    s->num_entries  = 0;
+    s->num_overflow = 0;
+}
+
+
+//========================================================================
+// Start a frame. Slices are written to file, if it can be opened.
+//========================================================================
+int tslice_start(tslice_t* ts, const char* file, uint32_t frame_num)
+{
+    uint32_t hdr[3] = { TSLICE_MAGIC, TSLICE_VERSION, frame_num };
+
+    tslice_finish(ts);
+
+    ts->started   = 0;
+    ts->first     = 0;
+    ts->num_late  = 0;
+    ts->num_written = 0;
+    memset(&ts->unwrap, 0, sizeof(ts->unwrap));
+    for (uint32_t i=0; i<ts->cfg.num_slices; i++)
+    {
+        ts->slice[i].index = i;
+    }
+
+    ts->fp = fopen(file, "w");
+    if (NULL == ts->fp)
+    {
+        err("failed to open time slice file %s\n", file);
+        return -1;
+    }
+    fwrite(hdr, sizeof(hdr), 1, ts->fp);
+    fwrite(&ts->cfg.width, sizeof(uint64_t), 1, ts->fp);
+
+    return 0;
+}
+
+
+//========================================================================
+// Bin the events of a batch. O(1) per event unless slices complete.
+//========================================================================
+void tslice_fill(tslice_t* ts, const evt_batch_t* batch)
+{
+    uint64_t         t, k, j, new_first;
+    uint32_t         key, h, mask = ts->cfg.num_bins - 1;
+    tslice_slice_t * s;
+
+    for (uint32_t i=0; i<batch->num_events; i++)
+    {
+        t = ts_unwrap(&ts->unwrap, batch->ts[i]);
+        if (!ts->started)
+        {
+            // first event of the frame defines time 0
+            ts->t0        = t;
+            ts->cur_start = t;
+            ts->cur_end   = t + ts->cfg.width;
+            ts->cur_index = 0;
+            ts->started   = 1;
+        }
+
+        //-------------------------------------------------
+        // Events are nearly in order, so mostly in the last slice hit.
+        if (t >= ts->cur_start && t < ts->cur_end)
+        {
+            k = ts->cur_index;
+        }
+        else
+        {
+            if (t < ts->t0)
+            {
+                ts->num_late++;
+                continue;
+            }
+            k = (t - ts->t0) / ts->cfg.width;
+            ts->cur_index = k;
+            ts->cur_start = ts->t0 + k*ts->cfg.width;
+            ts->cur_end   = ts->cur_start + ts->cfg.width;
+        }
+
+        if (k < ts->first)
+        {
+            ts->num_late++;
+            continue;
+        }
+
+        if (k >= ts->first + ts->cfg.num_slices)
+        {
+            // complete the slices that fall out of the ring
+            new_first = k - ts->cfg.num_slices + 1;
+            for (j=ts->first; j<new_first && j<ts->first+ts->cfg.num_slices; j++)
+            {
+                tslice_complete(ts, &ts->slice[j % ts->cfg.num_slices]);
+            }
+            j = ts->first + ts->cfg.num_slices;
+            for (j = (j > new_first) ? j : new_first; j<=k; j++)
+            {
+                ts->slice[j % ts->cfg.num_slices].index = j;
+            }
+            ts->first = new_first;
+        }
+
+        //-------------------------------------------------
+        s   = &ts->slice[k % ts->cfg.num_slices];
+        key = TSLICE_KEY(batch->addr[i], batch->pd[i]) + 1;
+        h   = (key * 2654435761u) >> ts->hash_shift;
+        while (s->key[h] && s->key[h] != key)
+        {
+            h = (h + 1) & mask;
+        }
+
+        if (s->key[h])
+        {
+            s->count[h]++;
+        }
+        else if (s->num_entries < ts->max_entries)
+        {
+            s->key[h]   = key;
+            s->count[h] = 1;
+            s->used[s->num_entries++] = h;
+        }
+        else
+        {
+            s->num_overflow++;
+        }
+    }
+}
+
+
+//========================================================================
+// Complete all open slices, streaming them if wanted, and close the file
+// if there is one. Completed slices are empty, so calling this again
+// does nothing.
+//========================================================================
+void tslice_finish(tslice_t* ts)
+{
+    for (uint64_t j=ts->first; j<ts->first+ts->cfg.num_slices; j++)
+    {
+        tslice_complete(ts, &ts->slice[j % ts->cfg.num_slices]);
+    }
+
+    if (ts->fp)
+    {
+        fclose(ts->fp);
+        ts->fp = NULL;
+        info("%lu time slices written\n", ts->num_written);
+    }
+
+    if (ts->num_late)
+    {
+        warn("%lu events too late for the open time slices\n", ts->num_late);
+        ts->num_late = 0;
+    }
+}
+
+
+//========================================================================
+// Reload TSLICE_CFG_FILE if it has changed. Removing the file, or a zero
+// width, turns time slicing off.
+//========================================================================
+void tslice_cfg_poll(void)
+{
+    static struct timespec last_mtime = {0, 0};
+
+    tslice_cfg_t * cfg;
+    tslice_cfg_t * old;
+    int            status;
+
+    status = cfg_file_changed(TSLICE_CFG_FILE, &last_mtime);
+    if (CFG_UNCHANGED == status)
+    {
+        return;
+    }
+
+    cfg = calloc(1, sizeof(tslice_cfg_t));
+    if (NULL == cfg)
+    {
+        return;
+    }
+    cfg->num_slices = 16;
+    cfg->num_bins   = 16384;
+
+    cfg_key_t keys[] =
+    {
+        { "width",  CFG_U64,  &cfg->width      },
+        { "slices", CFG_U32,  &cfg->num_slices },
+        { "bins",   CFG_U32,  &cfg->num_bins   },
+        { "stream", CFG_FLAG, &cfg->stream     },
+    };
+
+    if (CFG_CHANGED == status)
+    {
+        if (0 != cfg_read(TSLICE_CFG_FILE, keys, sizeof(keys)/sizeof(keys[0])))
+        {
+            free(cfg);
+            return;
+        }
+
+        if ( 0 == cfg->num_slices || cfg->num_slices > 4096 ||
+             0 == cfg->num_bins   || cfg->num_bins > (1u << 24) )
+        {
+            err("invalid slices/bins in %s. Ignored.\n", TSLICE_CFG_FILE);
+            free(cfg);
+            return;
+        }
+    }
+
+    if (cfg->width)
+    {
+        info( "time slices of %lu ticks (%u open, %u bins each), effective from the next frame.\n",
+              cfg->width, cfg->num_slices, cfg->num_bins );
+    }
+    else
+    {
+        info("time slicing turned off.\n");
+    }
+
+    old = atomic_exchange(&tslice_cfg_pending, cfg);
+    free(old);
+}
@@ -0,0 +1,97 @@
+#ifndef _TSLICE_H_
+#define _TSLICE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "germ.h"
+#include "event.h"
+
+//===========================================================
+// Time-sliced spectra.
+//
+// Events are binned by time since the first event of the
+// frame into slices of a fixed width. A ring of slices is
+// kept open to absorb events arriving out of order; when a
+// newer slice needs the slot, the oldest one is written to
+// filename.runno.tslice and reused.
+//
+// A slice is a hash table of (channel, pd) -> count with a
+// fixed capacity, so memory stays bounded whatever the width.
+// Events that don't fit are only counted as overflow.
+//
+// TSLICE_CFG_FILE:
+//
+//     width   <ticks>    slice width in timestamp ticks
+//     slices  <n>        slices kept open (default 16)
+//     bins    <n>        (channel, pd) bins per slice,
+//                        rounded up to a power of 2 (default 16384)
+//     stream  0|1        publish each completed slice (default 0)
+//
+// File format, in host byte order:
+//
+//     header: uint32 "GTSL", version, frame number,
+//             uint64 width
+//     per non-empty slice:
+//         uint64 slice index, uint32 number of bins,
+//         uint32 overflow count,
+//         then per bin, in order of first event:
+//             uint32 (channel << 12 | pd), uint32 count
+//===========================================================
+
+#define TSLICE_MAGIC      0x4c535447   // "GTSL"
+#define TSLICE_VERSION    1
+
+typedef struct
+{
+    uint64_t  width;
+    uint32_t  num_slices;
+    uint32_t  num_bins;
+    uint8_t   stream;
+} tslice_cfg_t;
+
+typedef struct
+{
+    uint64_t   index;           // slice number within the frame
+    uint32_t   num_entries;
+    uint32_t   num_overflow;
+    uint32_t * key;             // (channel << 12 | pd) + 1, 0 if empty
+    uint32_t * count;
+    uint32_t * used;            // slots of the entries, in order of arrival
+} tslice_slice_t;
+
+typedef struct
+{
+    tslice_cfg_t     cfg;
+    uint32_t         hash_shift;
+    uint32_t         max_entries;    // load limit of the hash table
+    tslice_slice_t * slice;          // ring, slice k at k % num_slices
+    uint8_t          started;        // t0 set by the first event
+    uint64_t         first;          // oldest open slice
+    uint64_t         cur_start;      // time range of the last slice hit
+    uint64_t         cur_end;
+    uint64_t         cur_index;
+    uint64_t         t0;
+    ts_unwrap_t      unwrap;
+    uint64_t         num_late;
+    uint64_t         num_written;
+    uint32_t       * buff;           // staging for file writes
+    FILE           * fp;
+
+    uint32_t       * stream_mca;     // sum over channels of the last slice
+    uint32_t       * stream_index;
+    uint8_t          stream_new;
+} tslice_t;
+
+// New configuration from tslice_cfg_poll(), taken by the processing thread.
+extern _Atomic(tslice_cfg_t*) tslice_cfg_pending;
+
+void      tslice_cfg_poll(void);
+tslice_t* tslice_create(const tslice_cfg_t* cfg, uint32_t* stream_mca, uint32_t* stream_index);
+void      tslice_free(tslice_t* ts);
+int       tslice_start(tslice_t* ts, const char* file, uint32_t frame_num);
+void      tslice_fill(tslice_t* ts, const evt_batch_t* batch);
+void      tslice_finish(tslice_t* ts);
+
+#endif
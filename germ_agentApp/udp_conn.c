@@ -8,6 +8,16 @@
  * 
  * Revisions:
  *
+ *   v1.2
+ *     - Date  : Oct 2026
+ *     - Brief : Run number taken from the run configuration snapshot;
+ *               Packets kept by the flight recorder, which is triggered
+ *               when the packet buffers are full;
+ *               Kernel receive timestamps (SO_TIMESTAMPNS) and latency
+ *               kept with each packet, instead of gettimeofday() twice;
+ *               Counters opened when profiling;
+ *               Receives and buffer waits traced.
+ *
  *   v1.1
  *     - Author: Ji Li
  *     - Date  : Oct 2023
@@ -42,6 +52,10 @@
 
 #include "germ.h"
 #include "udp_conn.h"
+#include "runcfg.h"
+#include "flightrec.h"
+#include "perfctr.h"
+#include "trace.h"
 #include "log.h"
 
 
@@ -49,8 +63,8 @@
 extern packet_buff_t packet_buff[NUM_PACKET_BUFF];
 
 /* arrays for energy and time spectra */
-extern uint16_t mca[NUM_MCA_ROW][NUM_MCA_COL];
-extern uint16_t tdc[NUM_TDC_ROW][NUM_TDC_COL];
+extern uint32_t mca[NUM_MCA_ROW][NUM_MCA_COL];
+extern uint32_t tdc[NUM_TDC_ROW][NUM_TDC_COL];
 
 extern pv_obj_t  pv[NUM_PVS];
 
@@ -64,9 +78,6 @@ const char  *GIGE_ERROR_STRING[] = { "",
 
 extern uint32_t reg1_val;
 
-extern char     filename[MAX_FILENAME_LEN];
-extern uint32_t runno;
-extern uint32_t filesize;
 
 extern atomic_char exp_mon_thread_ready;
 extern atomic_char udp_conn_thread_ready;
@@ -359,6 +370,12 @@ gige_data_t *gige_data_init(uint16_t reb_id, char *iface)
     if (setsockopt(ret->sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(int)) == -1) {
         err("Error setting socket opts: %s\n", strerror(errno));
     }
+
+    // kernel receive time of each datagram, see rxtime.h
+    int on = 1;
+    if (setsockopt(ret->sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(int)) == -1) {
+        warn("no kernel receive timestamps: %s\n", strerror(errno));
+    }
     
     // Bind to Register RX Port
     ret->si_recv.sin_port = htons(GIGE_DATA_RX_PORT);
@@ -383,26 +400,49 @@ void gige_data_close(gige_reg_t *dat)
 
 int8_t gige_data_recv(gige_data_t *dat, packet_buff_t* buff_p)
 {
-    struct sockaddr_in cliaddr;
-    struct timeval tv_begin, tv_end;
-    socklen_t len;
-    
-    gettimeofday(&tv_begin, NULL);
-    buff_p->length = recvfrom( dat->sock, buff_p->packet, MAX_PACKET_LENGTH, 0,
-                               (struct sockaddr *)&cliaddr, &len);
-                
-    if ( buff_p->length < 0 )
+    struct iovec     iov = { buff_p->packet, MAX_PACKET_LENGTH };
+    struct msghdr    msg;
+    struct cmsghdr * cmsg;
+    char             ctrl[CMSG_SPACE(sizeof(struct timespec))];
+    struct timespec  ts;
+    uint64_t         user_ns, kernel_ns;
+    ssize_t          n;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    n = recvmsg(dat->sock, &msg, 0);
+    if ( n < 0 )
     {
         perror(__func__);
-                return -1;
+        return -1;
     }
 
-    gettimeofday(&tv_end, NULL);
+    // one clock read per packet, against the kernel receive time
+    clock_gettime(CLOCK_REALTIME, &ts);
+    user_ns = ts.tv_sec * 1000000000UL + ts.tv_nsec;
+
+    buff_p->length     = n;
+    buff_p->rx_ns      = user_ns;
+    buff_p->rx_latency = 0;
+    for (cmsg=CMSG_FIRSTHDR(&msg); cmsg; cmsg=CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (SOL_SOCKET == cmsg->cmsg_level && SCM_TIMESTAMPNS == cmsg->cmsg_type)
+        {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            kernel_ns          = ts.tv_sec * 1000000000UL + ts.tv_nsec;
+            buff_p->rx_ns      = kernel_ns;
+            buff_p->rx_latency = (user_ns > kernel_ns) ? user_ns - kernel_ns : 0;
+        }
+    }
     log( "received %u bytes\n",
          buff_p->length );
 
-    buff_p->runno = runno;
-    tv_begin = tv_end;
+    buff_p->runno = run_cfg_acquire()->runno;
+    run_cfg_release();
 
     return 0;
 }
@@ -430,6 +470,7 @@ void* udp_conn_thread(void* arg)
 
     packet_buff_t * buff_p;
     unsigned char   write_buff = 0;
+    uint64_t        t0;
 
     struct timespec t1, t2;
 
@@ -483,15 +524,28 @@ void* udp_conn_thread(void* arg)
 
     info("ready to receive Data...\n");
 
+    perf_thread_init(__func__);
+    trace_thread_init(__func__);
+
     while (1)
     { 
         buff_p = &(packet_buff[write_buff]);
 
         log("write to buff[%d]\n", write_buff);
-        lock_buff_write(write_buff, DATA_WRITTEN, __func__);
+        if ( (__atomic_load_n(&buff_p->status, __ATOMIC_RELAXED) & (DATA_WRITTEN | DATA_PROCCED))
+             != (DATA_WRITTEN | DATA_PROCCED) )
+        {
+            flightrec_trigger(FR_TRIG_OVERFLOW, "packet buffers full");
+        }
+        t0 = trace_begin();
+        lock_buff_write(write_buff, DATA_WRITTEN | DATA_PROCCED, __func__);
+        trace_end(TR_RING_WAIT, t0);
 
+        t0 = trace_begin();
         while(gige_data_recv(dat, buff_p) ); // loop until receive is successful
-        
+        trace_end(TR_RECV, t0);
+        flightrec_packet(buff_p->packet, buff_p->length, buff_p->rx_ns);
+
         buff_p->status = 0;
         unlock_buff(write_buff, __func__);
         log("buff[%d] released\n", write_buff);
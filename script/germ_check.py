@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Check the segment codec and germ_analyze against a run's raw segments.
+
+    germ_check.py [--bin DIR] [-j threads] DIR FILENAME RUNNO
+
+for the segments DIR/FILENAME.RUNNO.segno.bin, made for instance with
+germ_synth.py:
+
+  - codec: 'germ_codec -b' on all of them (compress, decompress and
+    compare, with ratio and MB/s), then each one compressed with
+    'germ_codec -c' and restored with 'germ_codec -d' in a scratch
+    directory, and compared byte for byte with the original here.
+
+  - analysis: the spectra of 'germ_analyze' and 'germ_analyze -x'
+    compared bin for bin with those of calc_spectra(), taken as it is
+    from germ-datafile-analysis.ipynb next to this script: called on
+    each file in turn, keeping the counts of files it gives up on, and
+    leaving those files out, as the notebook's process pool does.
+
+The tools are looked for in --bin, then PATH. Exits with 1 if anything
+differs.
+"""
+
+import argparse
+import filecmp
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+NOTEBOOK = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        "germ-datafile-analysis.ipynb")
+NOTEBOOK_DEFS = ("CHIP_START_BIT =", "def parse_event(",
+                 "def list_files_in_directory(", "def calc_spectra(")
+
+
+def tool(args, name):
+    path = shutil.which(name, path=args.bin) if args.bin else None
+    path = path or shutil.which(name)
+    if path is None:
+        sys.exit("%s not found, give its directory with --bin" % name)
+    return path
+
+
+def notebook():
+    """The notebook's definitions calc_spectra() needs, run as they are."""
+    ns = {"os": os, "re": __import__("re"), "np": np}
+    with open(NOTEBOOK) as fp:
+        cells = json.load(fp)["cells"]
+    for cell in cells:
+        src = "".join(cell["source"])
+        if "code" == cell["cell_type"] and any(d in src for d in NOTEBOOK_DEFS):
+            exec(src, ns)
+    return ns
+
+
+def check_codec(args, files):
+    codec = tool(args, "germ_codec")
+    ok = 0 == subprocess.call([codec, "-b"] + files)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for f in files:
+            copy = os.path.join(tmp, os.path.basename(f))
+            shutil.copyfile(f, copy)
+            if 0 != subprocess.call([codec, "-c", copy], stdout=subprocess.DEVNULL):
+                ok = False
+                continue
+            os.unlink(copy)
+            if 0 != subprocess.call([codec, "-d", copy + ".gsc"], stdout=subprocess.DEVNULL):
+                ok = False
+                continue
+            if not filecmp.cmp(f, copy, shallow=False):
+                print("%s: restored file differs" % f)
+                ok = False
+
+    print("codec: %s" % ("round trip lossless" if ok else "FAILED"))
+    return ok
+
+
+def read_dat(path, rows):
+    with open(path) as fp:
+        words = fp.read().split()
+    if "data" != words[0] or int(words[1]) != len(words) - 2:
+        sys.exit("%s: not in the notebook's format" % path)
+    return np.array(words[2:], dtype=np.int64).reshape(rows, -1)
+
+
+def compare(what, got, ref):
+    if np.array_equal(got, ref):
+        return True
+    diff = np.argwhere(got != ref)
+    a, b = diff[0]
+    print("%s: %d bins differ, first at channel %d bin %d: %d, notebook %d"
+          % (what, len(diff), a, b, got[a][b], ref[a][b]))
+    return False
+
+
+def check_analyze(args):
+    nb = notebook()
+    run = "%010d" % args.runno
+    shape_mca = (nb["NUM_CHANS"], nb["MCA_SIZE"])
+    shape_tdc = (nb["NUM_CHANS"], nb["TDC_SIZE"])
+
+    ref = {"": [np.zeros(shape_mca, np.int64), np.zeros(shape_tdc, np.int64)],
+           "-x": [np.zeros(shape_mca, np.int64), np.zeros(shape_tdc, np.int64)]}
+    for name in sorted(nb["list_files_in_directory"](args.dir, args.filename, run)):
+        mca = np.zeros(shape_mca, np.int64)
+        tdc = np.zeros(shape_tdc, np.int64)
+        ret = nb["calc_spectra"](os.path.join(args.dir, name), mca, tdc)
+        for opt in ref:
+            if 0 == ret or "" == opt:
+                ref[opt][0] += mca
+                ref[opt][1] += tdc
+
+    analyze = tool(args, "germ_analyze")
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        for opt in ref:
+            prefix = os.path.join(tmp, "run" + opt)
+            cmd = [analyze, "-o", prefix] + ([opt] if opt else [])
+            if args.threads:
+                cmd += ["-j", str(args.threads)]
+            if 0 != subprocess.call(cmd + [args.dir, args.filename, str(args.runno)],
+                                    stdout=subprocess.DEVNULL):
+                print("%s failed" % " ".join(cmd))
+                ok = False
+                continue
+            same = compare(prefix + ".mca.dat", read_dat(prefix + ".mca.dat", shape_mca[0]), ref[opt][0])
+            same &= compare(prefix + ".tdc.dat", read_dat(prefix + ".tdc.dat", shape_tdc[0]), ref[opt][1])
+            print("%s: %s, %d events"
+                  % (" ".join(["germ_analyze", opt]).strip(),
+                     "same as calc_spectra()" if same else "DIFFERS", ref[opt][0].sum()))
+            ok &= same
+
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bin", help="directory of germ_codec and germ_analyze")
+    ap.add_argument("-j", "--threads", type=int, default=0,
+                    help="germ_analyze threads (default one per CPU)")
+    ap.add_argument("dir")
+    ap.add_argument("filename")
+    ap.add_argument("runno", type=int)
+    args = ap.parse_args()
+
+    files = sorted(os.path.join(args.dir, f) for f in os.listdir(args.dir)
+                   if f.startswith("%s.%010d." % (args.filename, args.runno))
+                   and f.endswith(".bin"))
+    if not files:
+        sys.exit("no segments %s/%s.%010d.*.bin" % (args.dir, args.filename, args.runno))
+
+    ok = check_codec(args, files)
+    ok &= check_analyze(args)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
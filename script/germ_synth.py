@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Synthetic raw segments of a run, for checking the tools that read them.
+
+    germ_synth.py [-s seed] [-n segments] [-p packets] [-e pairs]
+                  [--lost N] [--noise] [--bad SEGNO] DIR FILENAME RUNNO
+
+writes DIR/FILENAME.RUNNO.segno.bin (RUNNO and segno as 10 digits), one
+frame over 'segments' files of 'packets' packets each, as the daemon
+writes raw output: packets back to back, big-endian 32-bit words.
+
+    | PKT_CNTR   | 0          |     starts every packet
+    | 0xFEEDFACE | FRAME_NUM  |     second pair of the first packet
+    | EVENT      | TIMESTAMP  |     up to 'pairs' per packet
+    | NUM_LOST   | 0xDECAFBAD |     last pair of the last packet
+
+Events are spread over all 384 channels, with timestamps increasing and
+wrapping within their 31 bits. With --noise some timestamps and events
+are left out, as when words are lost on the way, so readers go through
+their recovery paths too. --bad puts an event with an invalid chip
+number into one segment.
+
+The same seed gives the same files.
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+SOF = 0xFEEDFACE
+EOF = 0xDECAFBAD
+TS_FLAG = 0x80000000
+TS_MASK = 0x7FFFFFFF
+
+NUM_CHIPS = 12
+NUM_CHIP_CHANS = 32
+MAX_PAIRS = 2048 // 8 - 3     # MAX_PACKET_LENGTH, less header, SOF and EOF
+
+
+def event_word(chip, chan, td, pd):
+    return (chip << 27) | (chan << 22) | (td << 12) | pd
+
+
+def packet(rng, args, counter, ts, first, last):
+    """One packet as a list of words, and the timestamp it ends at."""
+    words = [counter, 0]
+    if first:
+        words += [SOF, args.frame]
+
+    for k in range(rng.randint(1, args.pairs)):
+        ts = (ts + rng.randint(1, 400)) & TS_MASK
+        chip = rng.randrange(NUM_CHIPS)
+        chan = rng.randrange(NUM_CHIP_CHANS)
+        # a peak per chip over a flat background
+        pd = min(4095, max(0, int(rng.gauss(300 + 250 * chip, 40)))) \
+            if rng.random() < 0.7 else rng.randrange(4096)
+        td = rng.randrange(1024)
+        evt = event_word(chip, chan, td, pd)
+
+        if args.noise and rng.random() < 0.01:
+            words += [evt]                  # timestamp lost
+        elif args.noise and rng.random() < 0.01 and k > 0:
+            # event lost: a lone timestamp, followed by a whole pair
+            words += [ts | TS_FLAG, evt, ts | TS_FLAG]
+        else:
+            words += [evt, ts | TS_FLAG]
+
+    if last:
+        words += [args.lost, EOF]
+    return words, ts
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("-s", "--seed", type=int, default=1)
+    ap.add_argument("-n", "--segments", type=int, default=4)
+    ap.add_argument("-p", "--packets", type=int, default=200,
+                    help="packets per segment (default 200)")
+    ap.add_argument("-e", "--pairs", type=int, default=200,
+                    help="at most this many event pairs per packet (default 200)")
+    ap.add_argument("-f", "--frame", type=int, default=1, help="frame number")
+    ap.add_argument("--lost", type=int, default=0,
+                    help="events lost, reported at End of Frame")
+    ap.add_argument("--noise", action="store_true",
+                    help="leave out some timestamps and events")
+    ap.add_argument("--bad", type=int, default=-1, metavar="SEGNO",
+                    help="put an invalid chip number into this segment")
+    ap.add_argument("dir")
+    ap.add_argument("filename")
+    ap.add_argument("runno", type=int)
+    args = ap.parse_args()
+
+    if not 1 <= args.pairs <= MAX_PAIRS:
+        sys.exit("pairs per packet must be 1 to %d" % MAX_PAIRS)
+
+    rng = random.Random(args.seed)
+    counter = 0
+    ts = rng.randrange(TS_MASK)
+    for seg in range(args.segments):
+        words = []
+        for p in range(args.packets):
+            first = (0 == seg and 0 == p)
+            last = (args.segments - 1 == seg and args.packets - 1 == p)
+            w, ts = packet(rng, args, counter, ts, first, last)
+            if seg == args.bad and args.packets // 2 == p:
+                w[2:2] = [event_word(NUM_CHIPS + 1, 3, 10, 100), TS_FLAG]
+            words += w
+            counter += 1
+
+        path = os.path.join(args.dir, "%s.%010d.%010d.bin" % (args.filename, args.runno, seg))
+        with open(path, "wb") as fp:
+            fp.write(struct.pack(">%dI" % len(words), *words))
+        print("%s: %d bytes" % (path, 4 * len(words)))
+
+
+if __name__ == "__main__":
+    main()
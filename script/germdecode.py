@@ -0,0 +1,133 @@
+"""
+ctypes bindings of libgermdecode (germ_agentApp/germdecode.h).
+
+    import germdecode as gd
+    mca, tdc = gd.new_spectra()
+    stats = gd.spectra(path, mca, tdc)
+    addr, td, pd, ts, stats = gd.events(path)
+
+Buffers are numpy arrays; files are memory-mapped. The library is looked
+for in GERMDECODE_LIB, then the usual places (LD_LIBRARY_PATH, ldconfig).
+"""
+
+import ctypes
+import mmap
+import os
+
+import numpy as np
+
+ABI_VERSION = 1
+NUM_CHANS = 384
+MCA_SIZE = 4096
+TDC_SIZE = 1024
+
+
+class Stats(ctypes.Structure):
+    _fields_ = [("num_events", ctypes.c_uint64),
+                ("num_sof", ctypes.c_uint64),
+                ("num_eof", ctypes.c_uint64),
+                ("num_lost", ctypes.c_uint64),
+                ("num_dropped", ctypes.c_uint64),
+                ("num_no_ts", ctypes.c_uint64),
+                ("num_zero", ctypes.c_uint64),
+                ("num_ignored", ctypes.c_uint64),
+                ("num_bad", ctypes.c_uint64),
+                ("bad_offset", ctypes.c_uint64),
+                ("bad_event", ctypes.c_uint32),
+                ("bad_ts", ctypes.c_uint32),
+                ("reserved", ctypes.c_uint64 * 5)]
+
+    def as_dict(self):
+        return {name: getattr(self, name) for name, _ in self._fields_
+                if name != "reserved"}
+
+
+def _load():
+    lib = ctypes.CDLL(os.environ.get("GERMDECODE_LIB", "libgermdecode.so"))
+    lib.gd_abi_version.restype = ctypes.c_uint32
+    if lib.gd_abi_version() != ABI_VERSION:
+        raise ImportError("libgermdecode ABI %d, expected %d"
+                          % (lib.gd_abi_version(), ABI_VERSION))
+
+    buf = ctypes.c_void_p
+    u64 = ctypes.c_uint64
+    stats = ctypes.POINTER(Stats)
+    lib.gd_max_events.restype = u64
+    lib.gd_max_events.argtypes = [u64]
+    lib.gd_spectra.restype = ctypes.c_int32
+    lib.gd_spectra.argtypes = [buf, u64, buf, buf, stats]
+    lib.gd_events.restype = u64
+    lib.gd_events.argtypes = [buf, u64, buf, buf, buf, buf, stats]
+    lib.gd_accumulate.restype = u64
+    lib.gd_accumulate.argtypes = [buf, buf, buf, u64, buf, buf]
+    return lib
+
+
+_lib = _load()
+
+
+def _ptr(a, dtype, shape=None):
+    if not isinstance(a, np.ndarray) or a.dtype != dtype \
+            or not a.flags["C_CONTIGUOUS"] or (shape and a.shape != shape):
+        raise ValueError("expected a C-contiguous %s array%s"
+                         % (np.dtype(dtype).name, " of %s" % (shape,) if shape else ""))
+    return a.ctypes.data
+
+
+def _data(src):
+    """(numpy uint8 view, keep-alive) of a path, bytes or array."""
+    if isinstance(src, (str, os.PathLike)):
+        with open(src, "rb") as f:
+            if os.fstat(f.fileno()).st_size == 0:
+                return np.zeros(0, np.uint8), None
+            m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        return np.frombuffer(m, np.uint8), m
+    return np.frombuffer(src, np.uint8), src
+
+
+def new_spectra():
+    return (np.zeros((NUM_CHANS, MCA_SIZE), np.uint32),
+            np.zeros((NUM_CHANS, TDC_SIZE), np.uint32))
+
+
+def spectra(src, mca, tdc):
+    """Add the spectra of a raw segment to mca and tdc, as calc_spectra()
+    of germ-datafile-analysis.ipynb does. Returns the Stats; num_bad is
+    set if the segment stopped on an invalid chip."""
+    data, keep = _data(src)
+    stats = Stats()
+    _lib.gd_spectra(data.ctypes.data, data.size,
+                    _ptr(mca, np.uint32, (NUM_CHANS, MCA_SIZE)),
+                    _ptr(tdc, np.uint32, (NUM_CHANS, TDC_SIZE)),
+                    ctypes.byref(stats))
+    del keep
+    return stats
+
+
+def events(src):
+    """The events of a raw segment as arrays addr, td, pd, ts (the
+    timestamp word, flag bit included), and the Stats."""
+    data, keep = _data(src)
+    n = _lib.gd_max_events(data.size)
+    addr = np.empty(n, np.uint16)
+    td = np.empty(n, np.uint16)
+    pd = np.empty(n, np.uint16)
+    ts = np.empty(n, np.uint32)
+    stats = Stats()
+    n = _lib.gd_events(data.ctypes.data, data.size, addr.ctypes.data,
+                       td.ctypes.data, pd.ctypes.data, ts.ctypes.data,
+                       ctypes.byref(stats))
+    del keep
+    return addr[:n], td[:n], pd[:n], ts[:n], stats
+
+
+def accumulate(addr, td, pd, mca, tdc):
+    """Add events in columns (e.g. selected from events()) to mca and tdc.
+    Returns the number added; events out of range are skipped."""
+    n = len(addr)
+    if len(td) != n or len(pd) != n:
+        raise ValueError("columns of different lengths")
+    return _lib.gd_accumulate(_ptr(addr, np.uint16), _ptr(td, np.uint16),
+                              _ptr(pd, np.uint16), n,
+                              _ptr(mca, np.uint32, (NUM_CHANS, MCA_SIZE)),
+                              _ptr(tdc, np.uint32, (NUM_CHANS, TDC_SIZE)))